@@ -0,0 +1,99 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <string.h>
+
+#include "adaptive_sampler.h"
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: adaptive_sampler_init
+ *********************************************************/
+// -1 with bounds out of order
+int adaptive_sampler_init(struct adaptive_sampler *sampler, double setpoint, int64_t min_period,
+                          int64_t max_period)
+{
+    if (min_period <= 0 || max_period < min_period)
+    {
+        return (-1);
+    }
+    memset(sampler, 0, sizeof(struct adaptive_sampler));
+    sampler->setpoint = setpoint;
+    sampler->min_period = min_period;
+    sampler->max_period = max_period;
+    sampler->period = min_period;
+    sampler->last = -1;
+    return (0);
+}
+
+/**********************************************************
+ *  Function: adaptive_sampler_crossing
+ *********************************************************/
+// time the temperature takes to reach the setpoint (ns): below it rising
+// at rise_rate, above it falling at fall_rate (C/sec, INT64_MAX if it
+// moves away or stays)
+int64_t adaptive_sampler_crossing(const struct adaptive_sampler *sampler, double temperature,
+                                  double rise_rate, double fall_rate)
+{
+    double distance = temperature - sampler->setpoint;
+    double rate = (distance < 0.0) ? rise_rate : fall_rate;
+    double seconds;
+
+    if (distance == 0.0)
+    {
+        return (0);
+    }
+    if (rate <= 0.0)
+    {
+        return (INT64_MAX);
+    }
+    seconds = ((distance < 0.0) ? -distance : distance) / rate;
+    if (seconds >= (double)(INT64_MAX / NS_PER_S))
+    {
+        return (INT64_MAX);
+    }
+    return ((int64_t)(seconds * (double)NS_PER_S));
+}
+
+/**********************************************************
+ *  Function: adaptive_sampler_update
+ *********************************************************/
+// a reading taken by the release given, with the fastest rates the state
+// known allows: the next one is due before the temperature can cross,
+// within the bounds
+void adaptive_sampler_update(struct adaptive_sampler *sampler, double temperature, double rise_rate,
+                             double fall_rate, int64_t release)
+{
+    int64_t crossing = adaptive_sampler_crossing(sampler, temperature, rise_rate, fall_rate);
+
+    if (crossing < sampler->min_period)
+    {
+        crossing = sampler->min_period;
+    }
+    if (crossing > sampler->max_period)
+    {
+        crossing = sampler->max_period;
+    }
+    sampler->period = crossing;
+    sampler->last = release;
+}
+
+/**********************************************************
+ *  Function: adaptive_sampler_due
+ *********************************************************/
+// boolean to state if the release reads: the last release before the
+// reading is due does, so no release after a crossing is skipped
+int adaptive_sampler_due(struct adaptive_sampler *sampler, int64_t release)
+{
+    if (sampler->last < 0 || release + sampler->min_period > sampler->last + sampler->period)
+    {
+        sampler->reads++;
+        return (1);
+    }
+    sampler->skips++;
+    return (0);
+}
@@ -0,0 +1,59 @@
+#ifndef ADAPTIVE_SAMPLER_H
+#define ADAPTIVE_SAMPLER_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdint.h>
+
+#include "clock.h"
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// period of a reading of the temperature taken from how soon it could
+// cross the setpoint of the control at the rates of the state known: while
+// it cannot, every reading gives the same heater, so the releases of the
+// task until then read nothing; max_period bounds the time a change of
+// that state goes unseen
+struct adaptive_sampler
+{
+    double setpoint;     // temperature the heater switches at (C)
+    int64_t min_period;  // time between releases of the task (ns)
+    int64_t max_period;  // longest time without a reading (ns)
+    int64_t period;      // time from the last reading to the next (ns)
+    int64_t last;        // release of the last reading (ns, -1 for none)
+    unsigned long reads; // releases that read
+    unsigned long skips; // releases that did not
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: adaptive_sampler_init
+ *********************************************************/
+int adaptive_sampler_init(struct adaptive_sampler *sampler, double setpoint, int64_t min_period,
+                          int64_t max_period);
+
+/**********************************************************
+ *  Function: adaptive_sampler_crossing
+ *********************************************************/
+int64_t adaptive_sampler_crossing(const struct adaptive_sampler *sampler, double temperature,
+                                  double rise_rate, double fall_rate);
+
+/**********************************************************
+ *  Function: adaptive_sampler_update
+ *********************************************************/
+void adaptive_sampler_update(struct adaptive_sampler *sampler, double temperature, double rise_rate,
+                             double fall_rate, int64_t release);
+
+/**********************************************************
+ *  Function: adaptive_sampler_due
+ *********************************************************/
+int adaptive_sampler_due(struct adaptive_sampler *sampler, int64_t release);
+
+#endif
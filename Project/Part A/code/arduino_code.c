@@ -3,18 +3,18 @@
  *********************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 #include "math.h"
 
 #include "arduino_code.h"
+#include "clock.h"
 
 /**********************************************************
  *  CONSTANTS
  *********************************************************/
 
-#define NS_PER_S 1000000000
-
 #define SHIP_SPECIFC_HEAT 0.9
 #define SHIP_MASS 10.0         // Kg
 #define HEATER_POWER 150.0     // J/sec
@@ -23,35 +23,60 @@
 
 #define ORBIT_POINTS_SIZE 20
 #define ORBIT_TIME 300.0 // sec
+#define ORBIT_TIME_NS (300LL * NS_PER_S)
+
+// parts of the state a BATCH_CMD can execute
+#define BATCH_PARTS (BATCH_SET_HEAT | BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS)
+// optional parts of the protocol this firmware has
+#define SLAVE_FEATURES (FEATURE_BATCH | FEATURE_WINDOW | FEATURE_PUSH)
+// readings a SUBSCRIBE_CMD can push
+#define PUSH_PARTS (BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS)
+// rates of the UART agreed in a HELLO_CMD, slowest (the one at startup) first
+#define HELLO_RATES_SIZE 8
 
 /**********************************************************
  *  PUBLIC STATUS (GLOBAL VARIABLES)
  **********************************************************/
 
+// address of the slave on the link (enum address)
+unsigned char node_addr = DEFAULT_ADDR;
 // boolean with the status of the heater
 int heater_on = 0;
 // boolean with the status of the sunlight
 int sunlight_on = 0;
 // Save the actual temperature of the ship
 double temperature = 0.0;
-// save the last time temperature was computed
-double time_temperature = 0.0;
-// inital time of the orbit
-double init_time_orbit = 0.0;
+// save the last time temperature was computed (ns)
+int64_t time_temperature = 0;
+// inital time of the orbit (ns)
+int64_t init_time_orbit = 0;
 // actual position of the ship
 struct position position;
 
 // last command message received
-struct cmd_msg last_cmd_msg = {NO_CMD, 0};
+struct cmd_msg last_cmd_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
 // next response message to be send
-struct res_msg next_res_msg = {NO_CMD, 0};
+struct res_msg next_res_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
+// boolean to state if the next response message is ready to be send
+int response_ready = 0;
+
+// readings pushed without a request
+struct subscription subscription;
+// last time the readings were pushed (ns)
+int64_t push_time = 0;
+// readings of the last push
+struct batch_data pushed;
 
 /**********************************************************
  *  PRIVATE STATUS (STATIC GLOBAL VARIABLES)
  **********************************************************/
 
-// position data for the orbit
-static struct position orbit_points[ORBIT_POINTS_SIZE] = {
+// rates of the UART agreed in a HELLO_CMD (bits/sec)
+static const uint32_t hello_rates[HELLO_RATES_SIZE] = {
+    9600, 19200, 38400, 57600, 115200, 250000, 500000, 1000000};
+
+// position data for the orbit (read only, shared by all the contexts)
+static const struct position orbit_points[ORBIT_POINTS_SIZE] = {
     {3000.00, 0, 12000.0},
     {2853.169548885460, 1854.101966249680, 11412.678195541800},
     {2427.050983124840, 3526.711513754840, 9708.203932499370},
@@ -82,14 +107,49 @@ static struct position orbit_points[ORBIT_POINTS_SIZE] = {
  *********************************************************/
 double getClock()
 {
-    struct timespec tp;
-    double reloj;
+    return ((double)clock_now_ns()) / ((double)NS_PER_S);
+}
 
-    clock_gettime(CLOCK_REALTIME, &tp);
-    reloj = ((double)tp.tv_sec) +
-            ((double)tp.tv_nsec) / ((double)NS_PER_S);
+/**********************************************************
+ *  Function: load_globals
+ *********************************************************/
+static void load_globals(struct sat_ctx *ctx)
+{
+    // copy the default instance into a context
+    ctx->addr = node_addr;
+    ctx->heater_on = heater_on;
+    ctx->sunlight_on = sunlight_on;
+    ctx->temperature = temperature;
+    ctx->time_temperature = time_temperature;
+    ctx->init_time_orbit = init_time_orbit;
+    ctx->position = position;
+    ctx->last_cmd_msg = last_cmd_msg;
+    ctx->next_res_msg = next_res_msg;
+    ctx->response_ready = response_ready;
+    ctx->subscription = subscription;
+    ctx->push_time = push_time;
+    ctx->pushed = pushed;
+}
 
-    return (reloj);
+/**********************************************************
+ *  Function: store_globals
+ *********************************************************/
+static void store_globals(const struct sat_ctx *ctx)
+{
+    // copy a context back into the default instance
+    node_addr = ctx->addr;
+    heater_on = ctx->heater_on;
+    sunlight_on = ctx->sunlight_on;
+    temperature = ctx->temperature;
+    time_temperature = ctx->time_temperature;
+    init_time_orbit = ctx->init_time_orbit;
+    position = ctx->position;
+    last_cmd_msg = ctx->last_cmd_msg;
+    next_res_msg = ctx->next_res_msg;
+    response_ready = ctx->response_ready;
+    subscription = ctx->subscription;
+    push_time = ctx->push_time;
+    pushed = ctx->pushed;
 }
 
 //---------------------------------------------------------------------------
@@ -97,22 +157,34 @@ double getClock()
 //---------------------------------------------------------------------------
 
 /**********************************************************
- *  Function: get_temperature
+ *  Function: sat_ctx_init
  *********************************************************/
-void get_temperature()
+void sat_ctx_init(struct sat_ctx *ctx)
+{
+    memset(ctx, 0, sizeof(struct sat_ctx));
+    ctx->addr = DEFAULT_ADDR;
+    ctx->last_cmd_msg.cmd = NO_CMD;
+    ctx->next_res_msg.cmd = NO_CMD;
+}
+
+/**********************************************************
+ *  Function: get_temperature_ctx
+ *********************************************************/
+void get_temperature_ctx(struct sat_ctx *ctx)
 {
     // Calculate the elapsed time since the last temperature update
-    double current_time = getClock();
-    double elapsed_time = current_time - time_temperature;
+    // (difference taken in ns so no precision is lost)
+    int64_t current_time = clock_now_ns();
+    double elapsed_time = ((double)(current_time - ctx->time_temperature)) / ((double)NS_PER_S);
 
     // Calculate the total power gained or lost by the satellite
     double total_power = HEAT_POWER_LOSS;
 
-    if (heater_on == 1)
+    if (ctx->heater_on == 1)
     {
         total_power += HEATER_POWER;
     }
-    if (sunlight_on == 1)
+    if (ctx->sunlight_on == 1)
     {
         total_power += SUNLIGHT_POWER;
     }
@@ -121,21 +193,21 @@ void get_temperature()
     double energy_transferred = total_power * elapsed_time;
 
     // Update the temperature using the energy transfer formula
-    temperature += energy_transferred / (SHIP_SPECIFC_HEAT * SHIP_MASS);
+    ctx->temperature += energy_transferred / (SHIP_SPECIFC_HEAT * SHIP_MASS);
 
     // Update the last temperature update time
-    time_temperature = current_time;
+    ctx->time_temperature = current_time;
 }
 
 /**********************************************************
- *  Function: get_position
+ *  Function: get_position_ctx
  *********************************************************/
-void get_position()
+void get_position_ctx(struct sat_ctx *ctx)
 {
     // Calculate the time elapsed since the last orbit started (relative time)
-    // fmod is used to get the division module of the result and the time for a single orbit
-    double current_time = getClock();
-    double relative_time = fmod(current_time - init_time_orbit, ORBIT_TIME);
+    // the module with the time for a single orbit is taken in ns so no precision is lost
+    int64_t current_time = clock_now_ns();
+    double relative_time = ((double)((current_time - ctx->init_time_orbit) % ORBIT_TIME_NS)) / ((double)NS_PER_S);
 
     // Calculate the indices of the two consecutive positions in the orbit_points array
     int previous_position_index = (int)((relative_time * ORBIT_POINTS_SIZE) / ORBIT_TIME);
@@ -145,71 +217,339 @@ void get_position()
     double offset_ratio = (relative_time / (ORBIT_TIME / ORBIT_POINTS_SIZE)) - previous_position_index;
 
     // Update each position coordinate
-    position.x = orbit_points[previous_position_index].x * (1 - offset_ratio) +
-                 orbit_points[next_position_index].x * offset_ratio;
-    position.y = orbit_points[previous_position_index].y * (1 - offset_ratio) +
-                 orbit_points[next_position_index].y * offset_ratio;
-    position.z = orbit_points[previous_position_index].z * (1 - offset_ratio) +
-                 orbit_points[next_position_index].z * offset_ratio;
+    ctx->position.x = orbit_points[previous_position_index].x * (1 - offset_ratio) +
+                      orbit_points[next_position_index].x * offset_ratio;
+    ctx->position.y = orbit_points[previous_position_index].y * (1 - offset_ratio) +
+                      orbit_points[next_position_index].y * offset_ratio;
+    ctx->position.z = orbit_points[previous_position_index].z * (1 - offset_ratio) +
+                      orbit_points[next_position_index].z * offset_ratio;
 }
 
 /**********************************************************
- *  Function: exec_cmd_msg
+ *  Function: exec_cmd_msg_ctx
  *********************************************************/
-void exec_cmd_msg()
+void exec_cmd_msg_ctx(struct sat_ctx *ctx)
 {
-    // Initialize the response message with default values
-    last_cmd_msg.cmd = last_cmd_msg.cmd;
-    next_res_msg.status = 0; // Default status is failure (0)
+    // a NACK prepared by comm_server goes out as it is
+    if (ctx->next_res_msg.status == STATUS_NACK)
+    {
+        return;
+    }
 
-    switch (last_cmd_msg.cmd)
+    // Initialize the response message with default values, addressed as
+    // the request: the answer to a broadcast is never sent
+    ctx->next_res_msg.addr = ctx->last_cmd_msg.addr;
+    ctx->next_res_msg.seq = ctx->last_cmd_msg.seq;
+    ctx->next_res_msg.status = 0; // Default status is failure (0)
+
+    switch (ctx->last_cmd_msg.cmd)
     {
     case SET_HEAT_CMD:
         // Update the heater status based on the command
-        if (last_cmd_msg.set_heater == 1)
+        if (ctx->last_cmd_msg.set_heater == 1)
         {
-            heater_on = 1;
+            ctx->heater_on = 1;
         }
-        else if (last_cmd_msg.set_heater == 0)
+        else if (ctx->last_cmd_msg.set_heater == 0)
         {
-            heater_on = 0;
+            ctx->heater_on = 0;
         }
-        next_res_msg.cmd = SET_HEAT_CMD;
+        ctx->next_res_msg.cmd = SET_HEAT_CMD;
         // Set the status in the response message to indicate success
-        next_res_msg.status = 1;
+        ctx->next_res_msg.status = 1;
         break;
 
     case READ_SUN_CMD:
-        next_res_msg.cmd = READ_SUN_CMD;
+        ctx->next_res_msg.cmd = READ_SUN_CMD;
         // Set the status in the response message to indicate success
-        next_res_msg.status = 1;
+        ctx->next_res_msg.status = 1;
         // Set the sunlight_on value in the response message
-        next_res_msg.sunlight_on = sunlight_on;
+        ctx->next_res_msg.data.sunlight_on = ctx->sunlight_on;
         break;
 
     case READ_TEMP_CMD:
         // Get the current temperature and update it in the response message
-        get_temperature();
-        next_res_msg.cmd = READ_TEMP_CMD;
+        get_temperature_ctx(ctx);
+        ctx->next_res_msg.cmd = READ_TEMP_CMD;
         // Set the status in the response message to indicate success
-        next_res_msg.status = 1;
-        next_res_msg.temperature = temperature;
+        ctx->next_res_msg.status = 1;
+        ctx->next_res_msg.data.temperature = ctx->temperature;
         break;
 
     case READ_POS_CMD:
         // Get the current position and update it in the response message
-        get_position();
-        next_res_msg.cmd = READ_POS_CMD;
+        get_position_ctx(ctx);
+        ctx->next_res_msg.cmd = READ_POS_CMD;
         // Set the status in the response message to indicate success
-        next_res_msg.status = 1;
-        next_res_msg.position = position;
+        ctx->next_res_msg.status = 1;
+        ctx->next_res_msg.data.position = ctx->position;
+        break;
+
+    case BATCH_CMD:
+        // Execute every part of the state requested in a single answer
+        ctx->next_res_msg.cmd = BATCH_CMD;
+        ctx->next_res_msg.data.batch.batch = ctx->last_cmd_msg.batch & BATCH_PARTS;
+        if (ctx->last_cmd_msg.batch & BATCH_SET_HEAT)
+        {
+            // Update the heater status as SET_HEAT_CMD
+            if (ctx->last_cmd_msg.set_heater == 1)
+            {
+                ctx->heater_on = 1;
+            }
+            else if (ctx->last_cmd_msg.set_heater == 0)
+            {
+                ctx->heater_on = 0;
+            }
+        }
+        if (ctx->last_cmd_msg.batch & BATCH_READ_TEMP)
+        {
+            get_temperature_ctx(ctx);
+        }
+        if (ctx->last_cmd_msg.batch & BATCH_READ_POS)
+        {
+            get_position_ctx(ctx);
+        }
+        ctx->next_res_msg.data.batch.heater_on = ctx->heater_on;
+        ctx->next_res_msg.data.batch.sunlight_on = ctx->sunlight_on;
+        ctx->next_res_msg.data.batch.temperature = ctx->temperature;
+        ctx->next_res_msg.data.batch.position = ctx->position;
+        // Set the status in the response message to indicate success
+        ctx->next_res_msg.status = 1;
+        break;
+
+    case HELLO_CMD:
+        // Agree on the features of both ends and on the fastest rate of the
+        // UART not above the one asked; a master of another version gets none
+        ctx->next_res_msg.cmd = HELLO_CMD;
+        ctx->next_res_msg.data.hello.version = PROTOCOL_VERSION;
+        ctx->next_res_msg.data.hello.features = 0;
+        ctx->next_res_msg.data.hello.baud = hello_rates[0];
+        if (ctx->last_cmd_msg.data.hello.version == PROTOCOL_VERSION)
+        {
+            ctx->next_res_msg.data.hello.features = ctx->last_cmd_msg.data.hello.features & SLAVE_FEATURES;
+            for (int i = 1; i < HELLO_RATES_SIZE; i++)
+            {
+                if (hello_rates[i] <= ctx->last_cmd_msg.data.hello.baud)
+                {
+                    ctx->next_res_msg.data.hello.baud = hello_rates[i];
+                }
+            }
+        }
+        // Set the status in the response message to indicate success
+        ctx->next_res_msg.status = 1;
+        break;
+
+    case SUBSCRIBE_CMD:
+        // Keep the readings to push, the first push goes out at once
+        ctx->subscription = ctx->last_cmd_msg.data.subscription;
+        ctx->subscription.parts &= PUSH_PARTS;
+        ctx->push_time = 0;
+        ctx->next_res_msg.cmd = SUBSCRIBE_CMD;
+        // Set the status in the response message to indicate success
+        ctx->next_res_msg.status = 1;
         break;
 
     default:
         // This section is for NO_CMD or unknown commands
-        next_res_msg.cmd = NO_CMD;
-        last_cmd_msg.cmd = NO_CMD;
-        response_ready = true;
+        ctx->next_res_msg.cmd = NO_CMD;
+        ctx->last_cmd_msg.cmd = NO_CMD;
+        ctx->response_ready = 1;
         break;
     }
-}
\ No newline at end of file
+}
+
+/**********************************************************
+ *  Function: push_telemetry_ctx
+ *********************************************************/
+// fills msg and returns 1 when the subscription asks for a push: its period
+// has elapsed, the sunlight has changed or the temperature has moved more
+// than its delta since the last push
+int push_telemetry_ctx(struct sat_ctx *ctx, struct res_msg *msg)
+{
+    const struct subscription *sub = &ctx->subscription;
+    int64_t current_time = clock_now_ns();
+    int due = 0;
+
+    if (sub->parts == 0)
+    {
+        return (0);
+    }
+    if (ctx->push_time == 0 ||
+        (sub->period > 0 && current_time - ctx->push_time >= (int64_t)sub->period * NS_PER_MS))
+    {
+        due = 1;
+    }
+    if ((sub->parts & BATCH_READ_SUN) && ctx->sunlight_on != ctx->pushed.sunlight_on)
+    {
+        due = 1;
+    }
+    if ((sub->parts & BATCH_READ_TEMP) && sub->delta > 0 &&
+        fabs(ctx->temperature - ctx->pushed.temperature) > sub->delta)
+    {
+        due = 1;
+    }
+    if (!due)
+    {
+        return (0);
+    }
+
+    memset(msg, 0, sizeof(struct res_msg));
+    msg->addr = ctx->addr;
+    msg->cmd = TELEMETRY_CMD;
+    msg->status = 1;
+    msg->data.batch.batch = sub->parts;
+    msg->data.batch.heater_on = ctx->heater_on;
+    msg->data.batch.sunlight_on = ctx->sunlight_on;
+    msg->data.batch.temperature = ctx->temperature;
+    msg->data.batch.position = ctx->position;
+    ctx->pushed = msg->data.batch;
+    ctx->push_time = current_time;
+    return (1);
+}
+
+/**********************************************************
+ *  Function: cmd_queue_init
+ *********************************************************/
+void cmd_queue_init(struct cmd_queue *queue)
+{
+    memset(queue, 0, sizeof(struct cmd_queue));
+    queue->addressed = 1;
+    queue->confirmed = 1;
+}
+
+/**********************************************************
+ *  Function: cmd_queue_byte_ctx
+ *********************************************************/
+// one byte read from the UART: a frame for the slave is queued with its
+// answer prepared (a NACK if it came wrong), the caller stops reading with
+// CMD_QUEUE_SIZE of them
+void cmd_queue_byte_ctx(const struct sat_ctx *ctx, struct cmd_queue *queue, unsigned char car)
+{
+    int ret = frame_parse_byte(&queue->parser, car);
+    struct cmd_msg *cmd = &queue->cmds[queue->count];
+    struct res_msg *res = &queue->res[queue->count];
+
+    if (ret == FRAME_INCOMPLETE)
+    {
+        return;
+    }
+    // the address is the first byte of the message: a frame for another
+    // slave is dropped without decoding it
+    if (ret == FRAME_COMPLETE && queue->parser.message[0] != ctx->addr &&
+        queue->parser.message[0] != BROADCAST_ADDR)
+    {
+        queue->addressed = 0;
+        return;
+    }
+    // the wrong frames of a master talking to another slave are not NACKed
+    if (ret == FRAME_WRONG && !queue->addressed)
+    {
+        return;
+    }
+    memset(res, 0, sizeof(struct res_msg));
+    // check parity error or wrong message
+    if (ret == FRAME_WRONG || decode_cmd_msg(queue->parser.message, queue->parser.size, cmd) < 0)
+    {
+        // set error answer
+        memset(cmd, 0, sizeof(struct cmd_msg));
+        res->addr = ctx->addr;
+        res->cmd = NO_CMD;
+        res->status = STATUS_NACK;
+    }
+    else
+    {
+        // the master talks at this rate
+        queue->confirmed = 1;
+        queue->addressed = (cmd->addr == ctx->addr);
+    }
+    queue->count++;
+}
+
+/**********************************************************
+ *  Function: cmd_queue_exec_ctx
+ *********************************************************/
+// answers the queued commands one after the other, the answers are sent
+// by the next loop
+void cmd_queue_exec_ctx(struct sat_ctx *ctx, struct cmd_queue *queue)
+{
+    for (int i = 0; i < queue->count; i++)
+    {
+        ctx->last_cmd_msg = queue->cmds[i];
+        ctx->next_res_msg = queue->res[i];
+        exec_cmd_msg_ctx(ctx);
+        queue->res[i] = ctx->next_res_msg;
+    }
+    memset(&ctx->last_cmd_msg, 0, sizeof(struct cmd_msg));
+    memset(&ctx->next_res_msg, 0, sizeof(struct res_msg));
+}
+
+/**********************************************************
+ *  Function: cmd_queue_answer
+ *********************************************************/
+// frame of the answer i, returns its size (0 for a broadcast, executed
+// but never answered); rate is set to the one agreed in a HELLO_CMD
+// answered, which the UART takes once the answer is sent
+int cmd_queue_answer(const struct cmd_queue *queue, int i, unsigned char *frame, uint32_t *rate)
+{
+    const struct res_msg *res = &queue->res[i];
+
+    if (res->addr == BROADCAST_ADDR)
+    {
+        return (0);
+    }
+    if (res->cmd == HELLO_CMD && res->status == STATUS_DONE)
+    {
+        *rate = res->data.hello.baud;
+    }
+    return (frame_close(frame, encode_res_msg(res, frame + 1)));
+}
+
+/**********************************************************
+ *  Function: get_temperature
+ *********************************************************/
+void get_temperature()
+{
+    struct sat_ctx ctx;
+
+    load_globals(&ctx);
+    get_temperature_ctx(&ctx);
+    store_globals(&ctx);
+}
+
+/**********************************************************
+ *  Function: get_position
+ *********************************************************/
+void get_position()
+{
+    struct sat_ctx ctx;
+
+    load_globals(&ctx);
+    get_position_ctx(&ctx);
+    store_globals(&ctx);
+}
+
+/**********************************************************
+ *  Function: exec_cmd_msg
+ *********************************************************/
+void exec_cmd_msg()
+{
+    struct sat_ctx ctx;
+
+    load_globals(&ctx);
+    exec_cmd_msg_ctx(&ctx);
+    store_globals(&ctx);
+}
+
+/**********************************************************
+ *  Function: push_telemetry
+ *********************************************************/
+int push_telemetry(struct res_msg *msg)
+{
+    struct sat_ctx ctx;
+    int pushed_now;
+
+    load_globals(&ctx);
+    pushed_now = push_telemetry_ctx(&ctx, msg);
+    store_globals(&ctx);
+    return (pushed_now);
+}
@@ -3,63 +3,67 @@
  *********************************************************/
 
 #include <stdio.h>
+#include <stdint.h>
+
+#include "protocol.h"
 
 /**********************************************************
- *  TYPES
+ *  CONSTANTS
  *********************************************************/
 
-// structture of a position on the orbit
-struct position
-{
-    float x;
-    float y;
-    float z;
-};
+// commands the comm_server of a slave answers in one loop
+#define CMD_QUEUE_SIZE 8
 
-// list of commands to be send
-enum command
-{
-    NO_CMD = 0,
-    SET_HEAT_CMD = 1,
-    READ_SUN_CMD = 2,
-    READ_TEMP_CMD = 3,
-    READ_POS_CMD = 4
-};
+/**********************************************************
+ *  TYPES
+ *********************************************************/
 
-// structure of command message
-struct cmd_msg
+// status of one satellite, so several of them can run in the same process
+struct sat_ctx
 {
-    short int cmd;        // command to execute
-    short int set_heater; // boolean to set or unset the heater
+    unsigned char addr;               // address of the slave on the link (enum address)
+    int heater_on;                    // boolean with the status of the heater
+    int sunlight_on;                  // boolean with the status of the sunlight
+    double temperature;               // actual temperature of the ship
+    int64_t time_temperature;         // last time temperature was computed (ns)
+    int64_t init_time_orbit;          // inital time of the orbit (ns)
+    struct position position;         // actual position of the ship
+    struct cmd_msg last_cmd_msg;      // last command message received
+    struct res_msg next_res_msg;      // next response message to be send
+    int response_ready;               // boolean to state if the response is ready
+    struct subscription subscription; // readings pushed without a request
+    int64_t push_time;                // last time the readings were pushed (ns)
+    struct batch_data pushed;         // readings of the last push
 };
 
-// structure of response message
-struct res_msg
+// comm_server of a slave: commands received since its last loop and their
+// answers, in the order of the requests
+struct cmd_queue
 {
-    short int cmd;    // command to respond to
-    short int status; // boolean to state if execution went well
-    union
-    {
-        short int sunlight_on;    // boolean to state if sunlight is on
-        float temperature;        // value of the temperature
-        struct position position; // value of the position
-    } data;
+    struct frame_parser parser;          // receiver of the frame being read
+    struct cmd_msg cmds[CMD_QUEUE_SIZE]; // commands received
+    struct res_msg res[CMD_QUEUE_SIZE];  // their answers (a NACK for a wrong frame)
+    int count;                           // commands queued
+    int addressed;                       // boolean: the last good frame was for this slave
+    int confirmed;                       // boolean: a good frame came at the rate of the UART
 };
 
 /**********************************************************
  *  PUBLIC STATUS (GLOBAL VARIABLES)
  **********************************************************/
 
+// address of the slave on the link (enum address)
+extern unsigned char node_addr;
 // boolean with the status of the heater
 extern int heater_on;
 // boolean with the status of the sunlight
 extern int sunlight_on;
 // Save the actual temperature of the ship
 extern double temperature;
-// save the last time temperature was computed
-extern double time_temperature;
-// inital time of the orbit
-extern double init_time_orbit;
+// save the last time temperature was computed (ns)
+extern int64_t time_temperature;
+// inital time of the orbit (ns)
+extern int64_t init_time_orbit;
 // actual position of the ship
 extern struct position position;
 
@@ -67,6 +71,15 @@ extern struct position position;
 extern struct cmd_msg last_cmd_msg;
 // next response message to be send
 extern struct res_msg next_res_msg;
+// boolean to state if the next response message is ready to be send
+extern int response_ready;
+
+// readings pushed without a request
+extern struct subscription subscription;
+// last time the readings were pushed (ns)
+extern int64_t push_time;
+// readings of the last push
+extern struct batch_data pushed;
 
 //---------------------------------------------------------------------------
 //                           AUXILIAR FUNCTIONS
@@ -80,6 +93,53 @@ double getClock();
 //---------------------------------------------------------------------------
 //                           MAIN FUNCTIONS
 //---------------------------------------------------------------------------
+// The functions without context work on the global variables above, the
+// default instance. The _ctx variants only touch the given context.
+
+/**********************************************************
+ *  Function: sat_ctx_init
+ *********************************************************/
+void sat_ctx_init(struct sat_ctx *ctx);
+
+/**********************************************************
+ *  Function: get_temperature_ctx
+ *********************************************************/
+void get_temperature_ctx(struct sat_ctx *ctx);
+
+/**********************************************************
+ *  Function: get_position_ctx
+ *********************************************************/
+void get_position_ctx(struct sat_ctx *ctx);
+
+/**********************************************************
+ *  Function: exec_cmd_msg_ctx
+ *********************************************************/
+void exec_cmd_msg_ctx(struct sat_ctx *ctx);
+
+/**********************************************************
+ *  Function: push_telemetry_ctx
+ *********************************************************/
+int push_telemetry_ctx(struct sat_ctx *ctx, struct res_msg *msg);
+
+/**********************************************************
+ *  Function: cmd_queue_init
+ *********************************************************/
+void cmd_queue_init(struct cmd_queue *queue);
+
+/**********************************************************
+ *  Function: cmd_queue_byte_ctx
+ *********************************************************/
+void cmd_queue_byte_ctx(const struct sat_ctx *ctx, struct cmd_queue *queue, unsigned char car);
+
+/**********************************************************
+ *  Function: cmd_queue_exec_ctx
+ *********************************************************/
+void cmd_queue_exec_ctx(struct sat_ctx *ctx, struct cmd_queue *queue);
+
+/**********************************************************
+ *  Function: cmd_queue_answer
+ *********************************************************/
+int cmd_queue_answer(const struct cmd_queue *queue, int i, unsigned char *frame, uint32_t *rate);
 
 /**********************************************************
  *  Function: get_temperature
@@ -95,3 +155,8 @@ void get_position();
  *  Function: exec_cmd_msg
  *********************************************************/
 void exec_cmd_msg();
+
+/**********************************************************
+ *  Function: push_telemetry
+ *********************************************************/
+int push_telemetry(struct res_msg *msg);
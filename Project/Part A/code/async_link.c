@@ -0,0 +1,313 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+
+#include "async_link.h"
+#include "clock.h"
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: finish_request
+ *********************************************************/
+// takes the request out before its callback, which may send another one
+static void finish_request(struct async_link *link, int index, int result, const struct res_msg *res)
+{
+    struct async_request request = link->pending[index];
+
+    link->count--;
+    memmove(&link->pending[index], &link->pending[index + 1],
+            (link->count - index) * sizeof(struct async_request));
+    request.callback(request.arg, result, res);
+}
+
+/**********************************************************
+ *  Function: send_request
+ *********************************************************/
+// the whole frame, delimiter included, goes out in a single write
+static int send_request(int fd, const struct cmd_msg *msg)
+{
+    unsigned char frame[FRAME_MAX_SIZE];
+    int size = frame_close(frame, encode_cmd_msg(msg, frame + 1));
+
+    return (link_write_all(fd, frame, size));
+}
+
+/**********************************************************
+ *  Function: nack_request
+ *********************************************************/
+// the slave got the request wrong: it goes again, last of the requests
+// sent, up to ASYNC_MAX_RESENDS times; then it ends with ASYNC_NACK
+static int nack_request(struct async_link *link, int index)
+{
+    struct async_request request = link->pending[index];
+
+    if (request.resends == ASYNC_MAX_RESENDS)
+    {
+        finish_request(link, index, ASYNC_NACK, NULL);
+        return (1);
+    }
+    if (send_request(link->reader.fd, &request.msg) < 0)
+    {
+        finish_request(link, index, ASYNC_CLOSED, NULL);
+        return (1);
+    }
+    request.resends++;
+    memmove(&link->pending[index], &link->pending[index + 1],
+            (link->count - index - 1) * sizeof(struct async_request));
+    link->pending[link->count - 1] = request;
+    return (0);
+}
+
+/**********************************************************
+ *  Function: receive_answers
+ *********************************************************/
+// applies every answer already received and calls back its request,
+// returns the callbacks called
+static int receive_answers(struct async_link *link)
+{
+    struct res_msg res;
+    int called = 0;
+    int ret;
+
+    while ((ret = link_poll_frame(&link->reader)) != LINK_READ_TIMEOUT)
+    {
+        if (ret == LINK_READ_CLOSED)
+        {
+            while (link->count > 0)
+            {
+                finish_request(link, 0, ASYNC_CLOSED, NULL);
+                called++;
+            }
+            return (called);
+        }
+
+        // a wrong frame is dropped, its request ends by timeout
+        if (ret == LINK_READ_WRONG || decode_res_msg(link->reader.parser.message, ret, &res) < 0)
+        {
+            continue;
+        }
+
+        // a NACK stands for the oldest request to its slave, the answers
+        // come in order
+        if (res.status == STATUS_NACK)
+        {
+            for (int i = 0; i < link->count; i++)
+            {
+                if (link->pending[i].msg.addr == res.addr)
+                {
+                    called += nack_request(link, i);
+                    break;
+                }
+            }
+            continue;
+        }
+
+        // the readings pushed answer no request
+        if (res.cmd == TELEMETRY_CMD)
+        {
+            link->ctx.last_res_msg = res;
+            recv_res_msg_ctx(&link->ctx);
+            continue;
+        }
+
+        // an answer is applied as its request was sent, whatever was sent
+        // after it; one of a request ended already is dropped
+        for (int i = 0; i < link->count; i++)
+        {
+            if (link->pending[i].msg.addr == res.addr && link->pending[i].msg.seq == res.seq)
+            {
+                struct cmd_msg next = link->ctx.next_cmd_msg;
+
+                link->ctx.next_cmd_msg = link->pending[i].msg;
+                link->ctx.last_res_msg = res;
+                recv_res_msg_ctx(&link->ctx);
+                link->ctx.next_cmd_msg = next;
+                finish_request(link, i, ASYNC_DONE, &res);
+                called++;
+                break;
+            }
+        }
+    }
+    return (called);
+}
+
+/**********************************************************
+ *  Function: expire_requests
+ *********************************************************/
+static int expire_requests(struct async_link *link, int64_t now)
+{
+    int called = 0;
+
+    for (int i = 0; i < link->count;)
+    {
+        if (link->pending[i].deadline <= now)
+        {
+            finish_request(link, i, ASYNC_TIMEOUT, NULL);
+            called++;
+        }
+        else
+        {
+            i++;
+        }
+    }
+    return (called);
+}
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: async_link_init
+ *********************************************************/
+void async_link_init(struct async_link *link, int fd, int64_t timeout)
+{
+    memset(link, 0, sizeof(struct async_link));
+    link_reader_init(&link->reader, fd);
+    ctrl_ctx_init(&link->ctx);
+    link->timeout = timeout;
+}
+
+/**********************************************************
+ *  Function: execute_cmd_async
+ *********************************************************/
+// sends the command and returns at once, the callback is called from the
+// event loop with the answer (the state in link->ctx is updated first);
+// -1 with ASYNC_MAX_PENDING commands waiting or the link closed
+int execute_cmd_async(struct async_link *link, enum command cmd, command_callback callback, void *arg)
+{
+    struct async_request *request;
+    unsigned char addr;
+
+    if (link->count == ASYNC_MAX_PENDING)
+    {
+        return (-1);
+    }
+    // every command goes to the slave of link->ctx.next_cmd_msg.addr
+    addr = link->ctx.next_cmd_msg.addr;
+    memset(&link->ctx.next_cmd_msg, 0, sizeof(struct cmd_msg));
+    link->ctx.next_cmd_msg.addr = addr;
+    send_cmd_msg_ctx(&link->ctx, cmd);
+    link->ctx.next_cmd_msg.seq = link->next_seq;
+    if (cmd == BATCH_CMD)
+    {
+        link->ctx.next_cmd_msg.batch = BATCH_SET_HEAT | BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS;
+    }
+
+    if (send_request(link->reader.fd, &link->ctx.next_cmd_msg) < 0)
+    {
+        return (-1);
+    }
+    link->next_seq++;
+
+    request = &link->pending[link->count++];
+    request->msg = link->ctx.next_cmd_msg;
+    request->resends = 0;
+    request->deadline = clock_now_ns() + link->timeout;
+    request->callback = callback;
+    request->arg = arg;
+    return (0);
+}
+
+/**********************************************************
+ *  Function: event_loop_init
+ *********************************************************/
+void event_loop_init(struct event_loop *loop)
+{
+    memset(loop, 0, sizeof(struct event_loop));
+}
+
+/**********************************************************
+ *  Function: event_loop_add
+ *********************************************************/
+int event_loop_add(struct event_loop *loop, struct async_link *link)
+{
+    if (loop->count == EVENT_LOOP_MAX_LINKS)
+    {
+        return (-1);
+    }
+    loop->links[loop->count++] = link;
+    return (0);
+}
+
+/**********************************************************
+ *  Function: event_loop_pending
+ *********************************************************/
+// commands waiting for an answer on every link
+int event_loop_pending(const struct event_loop *loop)
+{
+    int pending = 0;
+
+    for (int i = 0; i < loop->count; i++)
+    {
+        pending += loop->links[i]->count;
+    }
+    return (pending);
+}
+
+/**********************************************************
+ *  Function: event_loop_run_once
+ *********************************************************/
+// waits for answers on every link at once, up to the deadline or the
+// first request to expire, and calls back the commands ended; returns
+// how many
+int event_loop_run_once(struct event_loop *loop, int64_t deadline)
+{
+    struct pollfd pfds[EVENT_LOOP_MAX_LINKS];
+    int64_t wake = deadline;
+    int64_t now;
+    int timeout;
+    int called = 0;
+
+    for (int i = 0; i < loop->count; i++)
+    {
+        struct async_link *link = loop->links[i];
+
+        pfds[i].fd = link->reader.fd;
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
+        for (int r = 0; r < link->count; r++)
+        {
+            wake = (link->pending[r].deadline < wake) ? link->pending[r].deadline : wake;
+        }
+    }
+
+    timeout = (int)((wake - clock_now_ns() + NS_PER_MS - 1) / NS_PER_MS);
+    if (poll(pfds, loop->count, (timeout < 0) ? 0 : timeout) < 0 && errno != EINTR)
+    {
+        return (-1);
+    }
+
+    now = clock_now_ns();
+    for (int i = 0; i < loop->count; i++)
+    {
+        called += receive_answers(loop->links[i]);
+        called += expire_requests(loop->links[i], now);
+    }
+    return (called);
+}
+
+/**********************************************************
+ *  Function: event_loop_run
+ *********************************************************/
+// runs until every command sent, and the ones sent from the callbacks,
+// has ended
+void event_loop_run(struct event_loop *loop)
+{
+    while (event_loop_pending(loop) > 0)
+    {
+        int64_t deadline = clock_now_ns() + NS_PER_S;
+
+        if (event_loop_run_once(loop, deadline) < 0)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef ASYNC_LINK_H
+#define ASYNC_LINK_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdint.h>
+
+#include "ctrl_ctx.h"
+#include "link_io.h"
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define ASYNC_MAX_PENDING 8     // commands waiting for an answer on a link
+#define ASYNC_MAX_RESENDS 2     // times a command is sent again after a NACK
+#define EVENT_LOOP_MAX_LINKS 16 // links driven by a loop
+
+// results given to the callbacks
+#define ASYNC_DONE 0                    // answered, the answer is given
+#define ASYNC_TIMEOUT LINK_READ_TIMEOUT // no answer in time
+#define ASYNC_CLOSED LINK_READ_CLOSED   // link closed before the answer
+#define ASYNC_NACK LINK_READ_WRONG      // NACKed every time it was sent
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// called from the event loop once a command ends, res is NULL without
+// an answer
+typedef void (*command_callback)(void *arg, int result, const struct res_msg *res);
+
+// command sent and waiting for its answer
+struct async_request
+{
+    struct cmd_msg msg;        // request as sent, sent again after a NACK
+    int resends;               // times it was sent again
+    int64_t deadline;          // time to give up waiting (ns)
+    command_callback callback; // called once it ends
+    void *arg;                 // argument of the callback
+};
+
+// link to a slave with commands sent and not answered yet
+struct async_link
+{
+    struct link_reader reader;                       // answers received
+    struct ctrl_ctx ctx;                             // state of the satellite on this link
+    int64_t timeout;                                 // time to wait for every answer (ns)
+    unsigned char next_seq;                          // sequence number of the next request
+    struct async_request pending[ASYNC_MAX_PENDING]; // commands sent, oldest first
+    int count;                                       // commands sent
+};
+
+// links served by a single thread
+struct event_loop
+{
+    struct async_link *links[EVENT_LOOP_MAX_LINKS];
+    int count;
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: async_link_init
+ *********************************************************/
+void async_link_init(struct async_link *link, int fd, int64_t timeout);
+
+/**********************************************************
+ *  Function: execute_cmd_async
+ *********************************************************/
+int execute_cmd_async(struct async_link *link, enum command cmd, command_callback callback, void *arg);
+
+/**********************************************************
+ *  Function: event_loop_init
+ *********************************************************/
+void event_loop_init(struct event_loop *loop);
+
+/**********************************************************
+ *  Function: event_loop_add
+ *********************************************************/
+int event_loop_add(struct event_loop *loop, struct async_link *link);
+
+/**********************************************************
+ *  Function: event_loop_pending
+ *********************************************************/
+int event_loop_pending(const struct event_loop *loop);
+
+/**********************************************************
+ *  Function: event_loop_run_once
+ *********************************************************/
+int event_loop_run_once(struct event_loop *loop, int64_t deadline);
+
+/**********************************************************
+ *  Function: event_loop_run
+ *********************************************************/
+void event_loop_run(struct event_loop *loop);
+
+#endif
@@ -0,0 +1,69 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <string.h>
+
+#include "binlog.h"
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: binlog_init
+ *********************************************************/
+void binlog_init(struct binlog_ring *ring)
+{
+    memset(ring, 0, sizeof(struct binlog_ring));
+}
+
+/**********************************************************
+ *  Function: binlog_write
+ *********************************************************/
+// copies the values without formatting them, nor locking or waiting: with
+// the ring full the record is dropped and counted (returns 0)
+int binlog_write(struct binlog_ring *ring, int64_t time, int format, double a, double b, double c, double d)
+{
+    uint32_t head = ring->head;
+    struct binlog_record *record;
+
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == BINLOG_RING_SIZE)
+    {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return (0);
+    }
+    record = &ring->records[head & (BINLOG_RING_SIZE - 1)];
+    record->time = time;
+    record->format = format;
+    record->args[0] = a;
+    record->args[1] = b;
+    record->args[2] = c;
+    record->args[3] = d;
+
+    // the drain sees the record whole once it sees the new head
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return (1);
+}
+
+/**********************************************************
+ *  Function: binlog_drain
+ *********************************************************/
+// formats the records logged up to now in one batch, from the thread of
+// the drain only; returns how many
+int binlog_drain(struct binlog_ring *ring, const binlog_formatter *formatters, FILE *file)
+{
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    for (uint32_t i = tail; i != head; i++)
+    {
+        const struct binlog_record *record = &ring->records[i & (BINLOG_RING_SIZE - 1)];
+
+        formatters[record->format](file, record);
+    }
+
+    // the slots formatted can be written again
+    __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+    return (int)(head - tail);
+}
@@ -0,0 +1,63 @@
+#ifndef BINLOG_H
+#define BINLOG_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+// records of a ring (a power of two) and values of a record
+#define BINLOG_RING_SIZE 256
+#define BINLOG_ARGS 4
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// raw values of a log line: formatted later by the drain with the
+// formatter of its format ID
+struct binlog_record
+{
+    int64_t time;              // when it was logged (ns)
+    int format;                // index of its formatter
+    double args[BINLOG_ARGS];  // values to format
+};
+
+// records of a single thread to a single drain, without locks
+struct binlog_ring
+{
+    struct binlog_record records[BINLOG_RING_SIZE];
+    uint32_t head;    // records written, by the thread that logs
+    uint32_t tail;    // records formatted, by the drain
+    uint32_t dropped; // records lost with the ring full
+};
+
+// writes a record as text
+typedef void (*binlog_formatter)(FILE *file, const struct binlog_record *record);
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: binlog_init
+ *********************************************************/
+void binlog_init(struct binlog_ring *ring);
+
+/**********************************************************
+ *  Function: binlog_write
+ *********************************************************/
+int binlog_write(struct binlog_ring *ring, int64_t time, int format, double a, double b, double c, double d);
+
+/**********************************************************
+ *  Function: binlog_drain
+ *********************************************************/
+int binlog_drain(struct binlog_ring *ring, const binlog_formatter *formatters, FILE *file);
+
+#endif
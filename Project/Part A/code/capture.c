@@ -0,0 +1,270 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "capture.h"
+#include "clock.h"
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define CAPTURE_MAGIC "SCAP"
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 16
+
+/**********************************************************
+ *  PRIVATE STATUS (STATIC GLOBAL VARIABLES)
+ **********************************************************/
+
+// file of the capture in progress (NULL if none)
+static FILE *capture_file = NULL;
+// time of the last record written (ns)
+static int64_t capture_time = 0;
+// frames come from several threads (one per link)
+static pthread_mutex_t capture_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: put_int64
+ *********************************************************/
+static void put_int64(unsigned char *buffer, int64_t value)
+{
+    // little endian, whatever the host
+    for (int i = 0; i < 8; i++)
+    {
+        buffer[i] = (unsigned char)(((uint64_t)value) >> (8 * i));
+    }
+}
+
+/**********************************************************
+ *  Function: get_int64
+ *********************************************************/
+static int64_t get_int64(const unsigned char *buffer)
+{
+    uint64_t value = 0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        value |= ((uint64_t)buffer[i]) << (8 * i);
+    }
+    return ((int64_t)value);
+}
+
+/**********************************************************
+ *  Function: put_varint
+ *********************************************************/
+static int put_varint(unsigned char *buffer, uint64_t value)
+{
+    int size = 0;
+
+    // 7 bits per byte, the high bit set if more bytes follow
+    do
+    {
+        buffer[size] = (unsigned char)(value & 0x7F);
+        value >>= 7;
+        if (value != 0)
+        {
+            buffer[size] |= 0x80;
+        }
+        size++;
+    } while (value != 0);
+
+    return (size);
+}
+
+/**********************************************************
+ *  Function: get_varint
+ *********************************************************/
+static int get_varint(FILE *file, uint64_t *value)
+{
+    int shift = 0;
+    int car;
+
+    *value = 0;
+    do
+    {
+        car = fgetc(file);
+        if (car == EOF || shift > 63)
+        {
+            return (-1);
+        }
+        *value |= ((uint64_t)(car & 0x7F)) << shift;
+        shift += 7;
+    } while (car & 0x80);
+
+    return (0);
+}
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: capture_start
+ *********************************************************/
+int capture_start(const char *path)
+{
+    unsigned char header[CAPTURE_HEADER_SIZE];
+    FILE *file;
+
+    file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return (-1);
+    }
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, CAPTURE_MAGIC, 4);
+    header[4] = CAPTURE_VERSION;
+
+    pthread_mutex_lock(&capture_lock);
+    capture_time = clock_now_ns();
+    put_int64(header + 8, capture_time);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header))
+    {
+        pthread_mutex_unlock(&capture_lock);
+        fclose(file);
+        return (-1);
+    }
+    if (capture_file != NULL)
+    {
+        fclose(capture_file);
+    }
+    capture_file = file;
+    pthread_mutex_unlock(&capture_lock);
+
+    return (0);
+}
+
+/**********************************************************
+ *  Function: capture_stop
+ *********************************************************/
+void capture_stop(void)
+{
+    pthread_mutex_lock(&capture_lock);
+    if (capture_file != NULL)
+    {
+        fclose(capture_file);
+        capture_file = NULL;
+    }
+    pthread_mutex_unlock(&capture_lock);
+}
+
+/**********************************************************
+ *  Function: capture_frame
+ *********************************************************/
+void capture_frame(int direction, int link, const void *data, int size)
+{
+    unsigned char record[10 + 2 + CAPTURE_MAX_FRAME];
+    int length;
+    int64_t now;
+
+    // nothing to do if there is no capture in progress
+    if (capture_file == NULL || size < 0 || size > CAPTURE_MAX_FRAME ||
+        link < 0 || link > CAPTURE_MAX_LINK)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&capture_lock);
+    if (capture_file != NULL)
+    {
+        // the time is taken under the lock so records are in order
+        now = clock_now_ns();
+        length = put_varint(record, (uint64_t)(now - capture_time));
+        record[length++] = (unsigned char)((direction & 1) | (link << 1));
+        record[length++] = (unsigned char)size;
+        memcpy(record + length, data, size);
+        length += size;
+
+        fwrite(record, 1, length, capture_file);
+        capture_time = now;
+    }
+    pthread_mutex_unlock(&capture_lock);
+}
+
+/**********************************************************
+ *  Function: capture_reader_open
+ *********************************************************/
+int capture_reader_open(struct capture_reader *reader, const char *path)
+{
+    unsigned char header[CAPTURE_HEADER_SIZE];
+
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL)
+    {
+        return (-1);
+    }
+
+    // check this is a capture we understand
+    if (fread(header, 1, sizeof(header), reader->file) != sizeof(header) ||
+        memcmp(header, CAPTURE_MAGIC, 4) != 0 || header[4] != CAPTURE_VERSION)
+    {
+        fclose(reader->file);
+        reader->file = NULL;
+        return (-1);
+    }
+    reader->time = get_int64(header + 8);
+
+    return (0);
+}
+
+/**********************************************************
+ *  Function: capture_reader_next
+ *********************************************************/
+// returns 1 with a record, 0 at the end of the capture, -1 if damaged
+int capture_reader_next(struct capture_reader *reader, struct capture_record *record)
+{
+    uint64_t delta;
+    int flags;
+    int size;
+    int car;
+
+    // end of the capture
+    car = fgetc(reader->file);
+    if (car == EOF)
+    {
+        return (0);
+    }
+    ungetc(car, reader->file);
+
+    if (get_varint(reader->file, &delta) < 0)
+    {
+        return (-1);
+    }
+    flags = fgetc(reader->file);
+    size = fgetc(reader->file);
+    if (flags == EOF || size == EOF ||
+        fread(record->data, 1, size, reader->file) != (size_t)size)
+    {
+        return (-1);
+    }
+
+    reader->time += (int64_t)delta;
+    record->time = reader->time;
+    record->direction = flags & 1;
+    record->link = flags >> 1;
+    record->size = size;
+
+    return (1);
+}
+
+/**********************************************************
+ *  Function: capture_reader_close
+ *********************************************************/
+void capture_reader_close(struct capture_reader *reader)
+{
+    if (reader->file != NULL)
+    {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+}
@@ -0,0 +1,77 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+// direction of a frame
+#define CAPTURE_TO_SLAVE 0  // sent by the master
+#define CAPTURE_TO_MASTER 1 // sent by the slave
+
+#define CAPTURE_MAX_LINK 127
+#define CAPTURE_MAX_FRAME 255
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// One frame of a capture. On disk a capture is a 16 byte header
+// ("SCAP", version, 3 reserved bytes, start time as int64 little endian)
+// followed by one record per frame:
+//   time since the previous record (ns, LEB128 varint)
+//   flags: bit 0 direction, bits 1-7 link
+//   frame size (1 byte) and the bytes of the frame as seen on the wire
+struct capture_record
+{
+    int64_t time;  // monotonic (or virtual) time of the frame (ns)
+    int direction; // CAPTURE_TO_SLAVE or CAPTURE_TO_MASTER
+    int link;      // link the frame went through
+    int size;      // bytes of the frame
+    unsigned char data[CAPTURE_MAX_FRAME];
+};
+
+// capture file opened for reading
+struct capture_reader
+{
+    FILE *file;
+    int64_t time; // time of the last record read (ns)
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: capture_start
+ *********************************************************/
+int capture_start(const char *path);
+
+/**********************************************************
+ *  Function: capture_stop
+ *********************************************************/
+void capture_stop(void);
+
+/**********************************************************
+ *  Function: capture_frame
+ *********************************************************/
+void capture_frame(int direction, int link, const void *data, int size);
+
+/**********************************************************
+ *  Function: capture_reader_open
+ *********************************************************/
+int capture_reader_open(struct capture_reader *reader, const char *path);
+
+/**********************************************************
+ *  Function: capture_reader_next
+ *********************************************************/
+int capture_reader_next(struct capture_reader *reader, struct capture_record *record);
+
+/**********************************************************
+ *  Function: capture_reader_close
+ *********************************************************/
+void capture_reader_close(struct capture_reader *reader);
@@ -0,0 +1,152 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "clock.h"
+
+/**********************************************************
+ *  PUBLIC STATUS (GLOBAL VARIABLES)
+ **********************************************************/
+
+// source of time used instead of the monotonic clock if set
+clock_source_t clock_source = NULL;
+
+/**********************************************************
+ *  PRIVATE STATUS (STATIC GLOBAL VARIABLES)
+ **********************************************************/
+
+// current time of the virtual source
+static int64_t virtual_time = 0;
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: virtual_source
+ *********************************************************/
+static int64_t virtual_source(void)
+{
+    return (virtual_time);
+}
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: clock_monotonic_ns
+ *********************************************************/
+int64_t clock_monotonic_ns(void)
+{
+    struct timespec tp;
+
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (((int64_t)tp.tv_sec) * NS_PER_S + (int64_t)tp.tv_nsec);
+}
+
+/**********************************************************
+ *  Function: clock_thread_cpu_ns
+ *********************************************************/
+// CPU time used by the calling thread, never virtual
+int64_t clock_thread_cpu_ns(void)
+{
+    struct timespec tp;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tp);
+    return (((int64_t)tp.tv_sec) * NS_PER_S + (int64_t)tp.tv_nsec);
+}
+
+/**********************************************************
+ *  Function: clock_set_source
+ *********************************************************/
+void clock_set_source(clock_source_t source)
+{
+    clock_source = source;
+}
+
+/**********************************************************
+ *  Function: clock_virtual_start
+ *********************************************************/
+void clock_virtual_start(int64_t time)
+{
+    virtual_time = time;
+    clock_source = virtual_source;
+}
+
+/**********************************************************
+ *  Function: clock_virtual_set
+ *********************************************************/
+void clock_virtual_set(int64_t time)
+{
+    // virtual time never goes backwards
+    if (time > virtual_time)
+    {
+        virtual_time = time;
+    }
+}
+
+/**********************************************************
+ *  Function: clock_virtual_stop
+ *********************************************************/
+void clock_virtual_stop(void)
+{
+    if (clock_source == virtual_source)
+    {
+        clock_source = NULL;
+    }
+}
+
+/**********************************************************
+ *  Function: clock_monotonic_sleep_until
+ *********************************************************/
+void clock_monotonic_sleep_until(int64_t deadline)
+{
+    struct timespec wake_up;
+
+    wake_up.tv_sec = (time_t)(deadline / NS_PER_S);
+    wake_up.tv_nsec = (long)(deadline % NS_PER_S);
+
+    // sleep again if a signal wakes the thread up
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_up, NULL) == EINTR)
+    {
+    }
+}
+
+/**********************************************************
+ *  Function: clock_sleep_until
+ *********************************************************/
+void clock_sleep_until(int64_t deadline)
+{
+    // virtual time jumps to the deadline
+    if (clock_source == virtual_source)
+    {
+        clock_virtual_set(deadline);
+    }
+    // other sources are followed at the pace of the monotonic clock
+    else if (clock_source != NULL)
+    {
+        int64_t remaining = deadline - clock_source();
+
+        if (remaining > 0)
+        {
+            clock_monotonic_sleep_until(clock_monotonic_ns() + remaining);
+        }
+    }
+    else
+    {
+        clock_monotonic_sleep_until(deadline);
+    }
+}
+
+/**********************************************************
+ *  Function: clock_sleep
+ *********************************************************/
+void clock_sleep(int64_t time)
+{
+    clock_sleep_until(clock_now_ns() + time);
+}
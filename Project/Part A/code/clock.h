@@ -0,0 +1,99 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdint.h>
+#include <time.h>
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define NS_PER_S 1000000000LL
+#define NS_PER_MS 1000000LL
+#define NS_PER_US 1000LL
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// source of time in nanoseconds
+typedef int64_t (*clock_source_t)(void);
+
+/**********************************************************
+ *  PUBLIC STATUS (GLOBAL VARIABLES)
+ **********************************************************/
+
+// source of time used instead of the monotonic clock if set
+extern clock_source_t clock_source;
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: clock_monotonic_ns
+ *********************************************************/
+int64_t clock_monotonic_ns(void);
+
+/**********************************************************
+ *  Function: clock_now_ns
+ *********************************************************/
+static inline int64_t clock_now_ns(void)
+{
+    struct timespec tp;
+
+    // use the pluggable source if there is one (virtual time)
+    if (clock_source != NULL)
+    {
+        return (clock_source());
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (((int64_t)tp.tv_sec) * NS_PER_S + (int64_t)tp.tv_nsec);
+}
+
+/**********************************************************
+ *  Function: clock_thread_cpu_ns
+ *********************************************************/
+int64_t clock_thread_cpu_ns(void);
+
+/**********************************************************
+ *  Function: clock_set_source
+ *********************************************************/
+void clock_set_source(clock_source_t source);
+
+/**********************************************************
+ *  Function: clock_virtual_start
+ *********************************************************/
+void clock_virtual_start(int64_t time);
+
+/**********************************************************
+ *  Function: clock_virtual_set
+ *********************************************************/
+void clock_virtual_set(int64_t time);
+
+/**********************************************************
+ *  Function: clock_virtual_stop
+ *********************************************************/
+void clock_virtual_stop(void);
+
+/**********************************************************
+ *  Function: clock_monotonic_sleep_until
+ *********************************************************/
+void clock_monotonic_sleep_until(int64_t deadline);
+
+/**********************************************************
+ *  Function: clock_sleep_until
+ *********************************************************/
+void clock_sleep_until(int64_t deadline);
+
+/**********************************************************
+ *  Function: clock_sleep
+ *********************************************************/
+void clock_sleep(int64_t time);
+
+#endif
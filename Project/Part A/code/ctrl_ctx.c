@@ -0,0 +1,121 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <string.h>
+
+#include "ctrl_ctx.h"
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define MAX_TEMPERATURE 90.0
+#define MIN_TEMPERATURE -10.0
+#define AVG_TEMPERATURE 40.0
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: ctrl_ctx_init
+ *********************************************************/
+void ctrl_ctx_init(struct ctrl_ctx *ctx)
+{
+    memset(ctx, 0, sizeof(struct ctrl_ctx));
+    ctx->next_cmd_msg.addr = DEFAULT_ADDR;
+    ctx->next_cmd_msg.cmd = NO_CMD;
+    ctx->last_res_msg.cmd = NO_CMD;
+}
+
+/**********************************************************
+ *  Function: control_temperature_ctx
+ *********************************************************/
+void control_temperature_ctx(struct ctrl_ctx *ctx)
+{
+    // check if temperature is lower or higher
+    if (ctx->temperature < AVG_TEMPERATURE)
+    {
+        // set heater
+        ctx->heater_on = 1;
+    }
+    else if (ctx->temperature >= AVG_TEMPERATURE)
+    {
+        // unset heater
+        ctx->heater_on = 0;
+    }
+}
+
+/**********************************************************
+ *  Function: send_cmd_msg_ctx
+ *********************************************************/
+void send_cmd_msg_ctx(struct ctrl_ctx *ctx, enum command cmd)
+{
+    // set the command to send
+    ctx->next_cmd_msg.cmd = cmd;
+
+    // if command is to set the heater (alone or in a batch)
+    if (cmd == SET_HEAT_CMD || cmd == BATCH_CMD)
+    {
+        // set the heater
+        ctx->next_cmd_msg.set_heater = ctx->heater_on;
+    }
+}
+
+/**********************************************************
+ *  Function: recv_res_msg_ctx
+ *********************************************************/
+void recv_res_msg_ctx(struct ctrl_ctx *ctx)
+{
+    // read the last received commmand
+    enum command cmd = ctx->last_res_msg.cmd;
+
+    // update the state of the subsystems
+    if (cmd == SET_HEAT_CMD && ctx->last_res_msg.status == STATUS_DONE)
+    {
+        // update the state of the heater, as sent
+        ctx->heater_on = ctx->next_cmd_msg.set_heater;
+    }
+    else if (cmd == READ_SUN_CMD)
+    {
+        // update the state of the sunlight
+        ctx->sunlight_on = ctx->last_res_msg.data.sunlight_on;
+    }
+    else if (cmd == READ_TEMP_CMD)
+    {
+        // update the state of the temperature
+        ctx->temperature = ctx->last_res_msg.data.temperature;
+    }
+    else if (cmd == READ_POS_CMD)
+    {
+        // update the state of the position
+        ctx->position = ctx->last_res_msg.data.position;
+    }
+    else if (cmd == BATCH_CMD || cmd == TELEMETRY_CMD)
+    {
+        // update the state of every part executed or pushed
+        const struct batch_data *batch = &ctx->last_res_msg.data.batch;
+
+        // the answer carries the heater the slave has
+        if ((batch->batch & BATCH_SET_HEAT) && ctx->last_res_msg.status == STATUS_DONE)
+        {
+            ctx->heater_on = batch->heater_on;
+        }
+        if (batch->batch & BATCH_READ_SUN)
+        {
+            ctx->sunlight_on = batch->sunlight_on;
+        }
+        if (batch->batch & BATCH_READ_TEMP)
+        {
+            ctx->temperature = batch->temperature;
+        }
+        if (batch->batch & BATCH_READ_POS)
+        {
+            ctx->position = batch->position;
+        }
+    }
+
+    // set the last response to no command to clean it up
+    ctx->last_res_msg.cmd = NO_CMD;
+}
@@ -0,0 +1,50 @@
+#ifndef CTRL_CTX_H
+#define CTRL_CTX_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include "protocol.h"
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// status of one controller, so several of them can run in the same process
+struct ctrl_ctx
+{
+    int heater_on;               // boolean with the status of the heater
+    int sunlight_on;             // boolean with the status of the sunlight
+    double temperature;          // actual temperature of the ship
+    struct position position;    // actual position of the ship
+    struct cmd_msg next_cmd_msg; // next command message to be send
+    struct res_msg last_res_msg; // last response message received
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+// Every function only touches the given context.
+
+/**********************************************************
+ *  Function: ctrl_ctx_init
+ *********************************************************/
+void ctrl_ctx_init(struct ctrl_ctx *ctx);
+
+/**********************************************************
+ *  Function: control_temperature_ctx
+ *********************************************************/
+void control_temperature_ctx(struct ctrl_ctx *ctx);
+
+/**********************************************************
+ *  Function: send_cmd_msg_ctx
+ *********************************************************/
+void send_cmd_msg_ctx(struct ctrl_ctx *ctx, enum command cmd);
+
+/**********************************************************
+ *  Function: recv_res_msg_ctx
+ *********************************************************/
+void recv_res_msg_ctx(struct ctrl_ctx *ctx);
+
+#endif
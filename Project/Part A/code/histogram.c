@@ -0,0 +1,143 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <string.h>
+
+#include "clock.h"
+#include "histogram.h"
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: histogram_init
+ *********************************************************/
+void histogram_init(struct histogram *histogram)
+{
+    memset(histogram, 0, sizeof(struct histogram));
+}
+
+/**********************************************************
+ *  Function: histogram_bucket
+ *********************************************************/
+// the values below 8 have a bucket each, then every power of two is split
+// in 8 buckets by the 3 bits after the highest one
+int histogram_bucket(int64_t value)
+{
+    int exponent;
+    int bucket;
+
+    if (value < HISTOGRAM_SUB_BUCKETS)
+    {
+        return (value < 0) ? 0 : (int)value;
+    }
+    exponent = 63 - __builtin_clzll((unsigned long long)value);
+    bucket = (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS +
+             (int)((value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1));
+    return (bucket < HISTOGRAM_BUCKETS) ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+/**********************************************************
+ *  Function: histogram_bucket_value
+ *********************************************************/
+// lowest value of a bucket
+int64_t histogram_bucket_value(int bucket)
+{
+    int exponent = bucket / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BITS - 1;
+
+    if (bucket < HISTOGRAM_SUB_BUCKETS)
+    {
+        return (bucket);
+    }
+    return ((int64_t)(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << (exponent - HISTOGRAM_SUB_BITS));
+}
+
+/**********************************************************
+ *  Function: histogram_record
+ *********************************************************/
+// a few ns and no locks: only the thread that owns the histogram writes
+// it, the relaxed atomics keep every count whole for the readers
+void histogram_record(struct histogram *histogram, int64_t value)
+{
+    uint32_t *count = &histogram->counts[histogram_bucket(value)];
+
+    __atomic_store_n(count, __atomic_load_n(count, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    if (value > __atomic_load_n(&histogram->max, __ATOMIC_RELAXED))
+    {
+        __atomic_store_n(&histogram->max, value, __ATOMIC_RELAXED);
+    }
+}
+
+/**********************************************************
+ *  Function: histogram_snapshot
+ *********************************************************/
+// copy of a histogram the owner keeps recording, for the dumps
+void histogram_snapshot(const struct histogram *histogram, struct histogram *copy)
+{
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        copy->counts[i] = __atomic_load_n(&histogram->counts[i], __ATOMIC_RELAXED);
+    }
+    copy->max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+}
+
+/**********************************************************
+ *  Function: histogram_count
+ *********************************************************/
+uint64_t histogram_count(const struct histogram *histogram)
+{
+    uint64_t count = 0;
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        count += histogram->counts[i];
+    }
+    return (count);
+}
+
+/**********************************************************
+ *  Function: histogram_percentile
+ *********************************************************/
+// highest value of the bucket that holds the percentile (0 to 100), never
+// above the largest value recorded
+int64_t histogram_percentile(const struct histogram *histogram, double percentile)
+{
+    uint64_t count = histogram_count(histogram);
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)count + 0.5);
+    uint64_t seen = 0;
+
+    if (count == 0)
+    {
+        return (0);
+    }
+    rank = (rank < 1) ? 1 : rank;
+    for (int i = 0; i < HISTOGRAM_BUCKETS - 1; i++)
+    {
+        seen += histogram->counts[i];
+        if (seen >= rank)
+        {
+            int64_t high = histogram_bucket_value(i + 1) - 1;
+
+            return (high < histogram->max) ? high : histogram->max;
+        }
+    }
+    return (histogram->max);
+}
+
+/**********************************************************
+ *  Function: histogram_print
+ *********************************************************/
+void histogram_print(FILE *file, const char *name, const struct histogram *histogram)
+{
+    struct histogram copy;
+    const double ms = (double)NS_PER_MS;
+
+    histogram_snapshot(histogram, &copy);
+    fprintf(file, "%-18s %8llu  p50 %9.3f  p90 %9.3f  p99 %9.3f  p99.9 %9.3f  max %9.3f ms\n",
+            name, (unsigned long long)histogram_count(&copy),
+            (double)histogram_percentile(&copy, 50.0) / ms, (double)histogram_percentile(&copy, 90.0) / ms,
+            (double)histogram_percentile(&copy, 99.0) / ms, (double)histogram_percentile(&copy, 99.9) / ms,
+            (double)copy.max / ms);
+}
@@ -0,0 +1,78 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+// buckets of a power of two split in 8, 12.5% of precision, up to 2^40 ns
+// (18 min); longer values go to the last bucket
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_EXPONENT 40
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// latencies in buckets of logarithmic width, as HdrHistogram: a single
+// thread records, any thread reads it at the same time
+struct histogram
+{
+    uint32_t counts[HISTOGRAM_BUCKETS]; // values recorded in every bucket
+    int64_t max;                        // largest value recorded (ns)
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: histogram_init
+ *********************************************************/
+void histogram_init(struct histogram *histogram);
+
+/**********************************************************
+ *  Function: histogram_bucket
+ *********************************************************/
+int histogram_bucket(int64_t value);
+
+/**********************************************************
+ *  Function: histogram_bucket_value
+ *********************************************************/
+int64_t histogram_bucket_value(int bucket);
+
+/**********************************************************
+ *  Function: histogram_record
+ *********************************************************/
+void histogram_record(struct histogram *histogram, int64_t value);
+
+/**********************************************************
+ *  Function: histogram_snapshot
+ *********************************************************/
+void histogram_snapshot(const struct histogram *histogram, struct histogram *copy);
+
+/**********************************************************
+ *  Function: histogram_count
+ *********************************************************/
+uint64_t histogram_count(const struct histogram *histogram);
+
+/**********************************************************
+ *  Function: histogram_percentile
+ *********************************************************/
+int64_t histogram_percentile(const struct histogram *histogram, double percentile);
+
+/**********************************************************
+ *  Function: histogram_print
+ *********************************************************/
+void histogram_print(FILE *file, const char *name, const struct histogram *histogram);
+
+#endif
@@ -3,18 +3,11 @@
  *********************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 #include "i386_code.h"
 
-/**********************************************************
- *  CONSTANTS
- *********************************************************/
-
-#define MAX_TEMPERATURE 90.0
-#define MIN_TEMPERATURE -10.0
-#define AVG_TEMPERATURE 40.0
-
 /**********************************************************
  *  PUBLIC STATUS (GLOBAL VARIABLES)
  **********************************************************/
@@ -29,9 +22,41 @@ double temperature = 0.0;
 struct position position;
 
 // next command message to be send
-struct cmd_msg next_cmd_msg = {NO_CMD, 0};
+struct cmd_msg next_cmd_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
 // last response message received
-struct res_msg last_res_msg = {NO_CMD, 0};
+struct res_msg last_res_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: load_globals
+ *********************************************************/
+static void load_globals(struct ctrl_ctx *ctx)
+{
+    // copy the default instance into a context
+    ctx->heater_on = heater_on;
+    ctx->sunlight_on = sunlight_on;
+    ctx->temperature = temperature;
+    ctx->position = position;
+    ctx->next_cmd_msg = next_cmd_msg;
+    ctx->last_res_msg = last_res_msg;
+}
+
+/**********************************************************
+ *  Function: store_globals
+ *********************************************************/
+static void store_globals(const struct ctrl_ctx *ctx)
+{
+    // copy a context back into the default instance
+    heater_on = ctx->heater_on;
+    sunlight_on = ctx->sunlight_on;
+    temperature = ctx->temperature;
+    position = ctx->position;
+    next_cmd_msg = ctx->next_cmd_msg;
+    last_res_msg = ctx->last_res_msg;
+}
 
 //---------------------------------------------------------------------------
 //                           MAIN FUNCTIONS
@@ -42,17 +67,11 @@ struct res_msg last_res_msg = {NO_CMD, 0};
  *********************************************************/
 void control_temperature()
 {
-    // check if temperature is lower or higher
-    if (temperature < AVG_TEMPERATURE)
-    {
-        // set heater
-        heater_on = 1;
-    }
-    else if (temperature >= AVG_TEMPERATURE)
-    {
-        // unset heater
-        heater_on = 0;
-    }
+    struct ctrl_ctx ctx;
+
+    load_globals(&ctx);
+    control_temperature_ctx(&ctx);
+    store_globals(&ctx);
 }
 
 /**********************************************************
@@ -60,15 +79,11 @@ void control_temperature()
  *********************************************************/
 void send_cmd_msg(enum command cmd)
 {
-    // set the command to send
-    next_cmd_msg.cmd = cmd;
+    struct ctrl_ctx ctx;
 
-    // if command is to set the heater
-    if (cmd == SET_HEAT_CMD)
-    {
-        // set the heater
-        next_cmd_msg.set_heater = heater_on;
-    }
+    load_globals(&ctx);
+    send_cmd_msg_ctx(&ctx, cmd);
+    store_globals(&ctx);
 }
 
 /**********************************************************
@@ -76,31 +91,9 @@ void send_cmd_msg(enum command cmd)
  *********************************************************/
 void recv_res_msg()
 {
-    // read the last received commmand
-    enum command cmd = last_res_msg.cmd;
-
-    // update the state of the subsystems
-    if (cmd == SET_HEAT_CMD)
-    {
-        // update the state of the heater
-        heater_on = last_res_msg.status;
-    }
-    else if (cmd == READ_SUN_CMD)
-    {
-        // update the state of the sunlight
-        sunlight_on = last_res_msg.data.sunlight_on;
-    }
-    else if (cmd == READ_TEMP_CMD)
-    {
-        // update the state of the temperature
-        temperature = last_res_msg.data.temperature;
-    }
-    else if (cmd == READ_POS_CMD)
-    {
-        // update the state of the position
-        position = last_res_msg.data.position;
-    }
+    struct ctrl_ctx ctx;
 
-    // set the last response to no command to clean it up
-    last_res_msg.cmd = NO_CMD;
+    load_globals(&ctx);
+    recv_res_msg_ctx(&ctx);
+    store_globals(&ctx);
 }
@@ -4,47 +4,7 @@
 
 #include <stdio.h>
 
-/**********************************************************
- *  TYPES
- *********************************************************/
-
-// structture of a position on the orbit
-struct position
-{
-    float x;
-    float y;
-    float z;
-};
-
-// list of commands to be send
-enum command
-{
-    NO_CMD = 0,
-    SET_HEAT_CMD = 1,
-    READ_SUN_CMD = 2,
-    READ_TEMP_CMD = 3,
-    READ_POS_CMD = 4
-};
-
-// structure of command message
-struct cmd_msg
-{
-    short int cmd;        // command to execute
-    short int set_heater; // boolean to set or unset the heater
-};
-
-// structure of response message
-struct res_msg
-{
-    short int cmd;    // command to respond to
-    short int status; // boolean to state if execution went well
-    union
-    {
-        short int sunlight_on;    // boolean to state if sunlight is on
-        float temperature;        // value of the temperature
-        struct position position; // value of the position
-    } data;
-};
+#include "ctrl_ctx.h"
 
 /**********************************************************
  *  PUBLIC STATUS (GLOBAL VARIABLES)
@@ -67,6 +27,8 @@ extern struct res_msg last_res_msg;
 //---------------------------------------------------------------------------
 //                           MAIN FUNCTIONS
 //---------------------------------------------------------------------------
+// The functions below work on the global variables above, the default
+// instance, through the context functions of ctrl_ctx.h.
 
 /**********************************************************
  *  Function: control_temperature
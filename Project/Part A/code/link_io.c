@@ -0,0 +1,306 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "link_io.h"
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: baud_to_speed
+ *********************************************************/
+static speed_t baud_to_speed(long baud)
+{
+    switch (baud)
+    {
+    case 9600:
+        return (B9600);
+    case 19200:
+        return (B19200);
+    case 38400:
+        return (B38400);
+    case 57600:
+        return (B57600);
+    case 115200:
+        return (B115200);
+    default:
+        return (B0);
+    }
+}
+
+/**********************************************************
+ *  Function: wait_readable
+ *********************************************************/
+// waits for data until the deadline (none if negative)
+static int wait_readable(int fd, int64_t deadline)
+{
+    while (1)
+    {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int timeout = -1;
+        int ret;
+
+        if (deadline >= 0)
+        {
+            int64_t remaining = deadline - clock_now_ns();
+            if (remaining <= 0)
+            {
+                return (LINK_READ_TIMEOUT);
+            }
+            timeout = (int)((remaining + NS_PER_MS - 1) / NS_PER_MS);
+        }
+
+        ret = poll(&pfd, 1, timeout);
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ret < 0)
+        {
+            return (LINK_READ_CLOSED);
+        }
+        if (ret > 0)
+        {
+            return (LINK_READ_OK);
+        }
+    }
+}
+
+/**********************************************************
+ *  Function: parse_buffered
+ *********************************************************/
+// parses the bytes received up to the end of a frame, LINK_READ_TIMEOUT
+// if they end first
+static int parse_buffered(struct link_reader *reader)
+{
+    while (reader->head < reader->tail)
+    {
+        int ret = frame_parse_byte(&reader->parser, reader->buffer[reader->head++]);
+        if (ret == FRAME_COMPLETE)
+        {
+            return (reader->parser.size);
+        }
+        if (ret == FRAME_WRONG)
+        {
+            return (LINK_READ_WRONG);
+        }
+    }
+    return (LINK_READ_TIMEOUT);
+}
+
+/**********************************************************
+ *  Function: fill_buffer
+ *********************************************************/
+// reads the bytes received once the fd is readable
+static int fill_buffer(struct link_reader *reader)
+{
+    while (1)
+    {
+        int ret = read(reader->fd, reader->buffer, sizeof(reader->buffer));
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ret <= 0)
+        {
+            return (LINK_READ_CLOSED);
+        }
+        reader->head = 0;
+        reader->tail = ret;
+        return (LINK_READ_OK);
+    }
+}
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: link_open_serial
+ *********************************************************/
+int link_open_serial(const char *device, long baud)
+{
+    struct termios portSettings;
+    speed_t speed = baud_to_speed(baud);
+    int fd;
+
+    if (speed == B0)
+    {
+        return (-1);
+    }
+    fd = open(device, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+    {
+        return (-1);
+    }
+
+    // same settings as the master of Part C
+    tcgetattr(fd, &portSettings);
+    cfsetispeed(&portSettings, speed);
+    cfsetospeed(&portSettings, speed);
+    cfmakeraw(&portSettings);
+    tcsetattr(fd, TCSANOW, &portSettings);
+    return (fd);
+}
+
+/**********************************************************
+ *  Function: link_write_all
+ *********************************************************/
+int link_write_all(int fd, const void *data, int size)
+{
+    int sent = 0;
+
+    // write again after short writes
+    while (sent < size)
+    {
+        int ret = write(fd, (const unsigned char *)data + sent, size - sent);
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ret <= 0)
+        {
+            return (-1);
+        }
+        sent += ret;
+    }
+    return (0);
+}
+
+/**********************************************************
+ *  Function: link_read_all
+ *********************************************************/
+int link_read_all(int fd, void *data, int size, int64_t deadline)
+{
+    int received = 0;
+
+    while (received < size)
+    {
+        int ret = wait_readable(fd, deadline);
+        if (ret != LINK_READ_OK)
+        {
+            return (ret);
+        }
+
+        ret = read(fd, (unsigned char *)data + received, size - received);
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ret <= 0)
+        {
+            return (LINK_READ_CLOSED);
+        }
+        received += ret;
+    }
+    return (LINK_READ_OK);
+}
+
+/**********************************************************
+ *  Function: link_reader_init
+ *********************************************************/
+void link_reader_init(struct link_reader *reader, int fd)
+{
+    memset(reader, 0, sizeof(struct link_reader));
+    reader->fd = fd;
+}
+
+/**********************************************************
+ *  Function: link_read_frame
+ *********************************************************/
+// reads up to the next delimiter, returns the size of the message, left in
+// reader->parser.message, or LINK_READ_*
+int link_read_frame(struct link_reader *reader, int64_t deadline)
+{
+    while (1)
+    {
+        int ret = parse_buffered(reader);
+
+        // the bytes already received may hold the frame
+        if (ret != LINK_READ_TIMEOUT)
+        {
+            return (ret);
+        }
+
+        ret = wait_readable(reader->fd, deadline);
+        if (ret != LINK_READ_OK)
+        {
+            return (ret);
+        }
+        ret = fill_buffer(reader);
+        if (ret != LINK_READ_OK)
+        {
+            return (ret);
+        }
+    }
+}
+
+/**********************************************************
+ *  Function: link_poll_frame
+ *********************************************************/
+// as link_read_frame, but only with the bytes already received: returns
+// LINK_READ_TIMEOUT at once if they do not end a frame
+int link_poll_frame(struct link_reader *reader)
+{
+    while (1)
+    {
+        struct pollfd pfd = {reader->fd, POLLIN, 0};
+        int ret = parse_buffered(reader);
+
+        if (ret != LINK_READ_TIMEOUT)
+        {
+            return (ret);
+        }
+        ret = poll(&pfd, 1, 0);
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ret == 0)
+        {
+            return (LINK_READ_TIMEOUT);
+        }
+        ret = (ret < 0) ? LINK_READ_CLOSED : fill_buffer(reader);
+        if (ret != LINK_READ_OK)
+        {
+            return (ret);
+        }
+    }
+}
+
+/**********************************************************
+ *  Function: link_reader_drain
+ *********************************************************/
+void link_reader_drain(struct link_reader *reader)
+{
+    // drop the bytes already received and the frame being received
+    reader->head = 0;
+    reader->tail = 0;
+    reader->parser.count = 0;
+    link_drain(reader->fd);
+}
+
+/**********************************************************
+ *  Function: link_drain
+ *********************************************************/
+void link_drain(int fd)
+{
+    unsigned char buffer[64];
+    struct pollfd pfd = {fd, POLLIN, 0};
+
+    // drop the bytes already received
+    while (poll(&pfd, 1, 0) > 0 && read(fd, buffer, sizeof(buffer)) > 0)
+    {
+    }
+}
@@ -0,0 +1,78 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+// results of link_read_all
+#define LINK_READ_OK 0
+#define LINK_READ_TIMEOUT -1
+#define LINK_READ_CLOSED -2
+#define LINK_READ_WRONG -3 // wrong frame or parity
+
+#define LINK_READER_SIZE 256 // bytes read from the link at once
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// receiver of frames on a link
+struct link_reader
+{
+    int fd;
+    unsigned char buffer[LINK_READER_SIZE]; // bytes read and not parsed yet
+    int head;                               // next byte to parse
+    int tail;                               // end of the bytes read
+    struct frame_parser parser;
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: link_open_serial
+ *********************************************************/
+int link_open_serial(const char *device, long baud);
+
+/**********************************************************
+ *  Function: link_write_all
+ *********************************************************/
+int link_write_all(int fd, const void *data, int size);
+
+/**********************************************************
+ *  Function: link_read_all
+ *********************************************************/
+int link_read_all(int fd, void *data, int size, int64_t deadline);
+
+/**********************************************************
+ *  Function: link_reader_init
+ *********************************************************/
+void link_reader_init(struct link_reader *reader, int fd);
+
+/**********************************************************
+ *  Function: link_read_frame
+ *********************************************************/
+int link_read_frame(struct link_reader *reader, int64_t deadline);
+
+/**********************************************************
+ *  Function: link_poll_frame
+ *********************************************************/
+int link_poll_frame(struct link_reader *reader);
+
+/**********************************************************
+ *  Function: link_reader_drain
+ *********************************************************/
+void link_reader_drain(struct link_reader *reader);
+
+/**********************************************************
+ *  Function: link_drain
+ *********************************************************/
+void link_drain(int fd);
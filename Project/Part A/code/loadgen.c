@@ -0,0 +1,723 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arduino_code.h"
+#include "capture.h"
+#include "clock.h"
+#include "link_io.h"
+#include "loadgen.h"
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define PENDING_SIZE 4096    // requests waiting for an answer (open loop)
+#define SAMPLES_INITIAL 1024 // initial size of the latency buffers
+
+#define READ_OK LINK_READ_OK
+#define READ_PARITY 1
+#define READ_TIMEOUT LINK_READ_TIMEOUT
+#define READ_CLOSED LINK_READ_CLOSED
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// round trip times of one command on one link
+struct samples
+{
+    int64_t *data;
+    unsigned long count;
+    unsigned long size;
+};
+
+// request sent and still waiting for its answer (open loop)
+struct pending
+{
+    int64_t time;      // time the request was due to be sent (ns)
+    short int cmd;
+    unsigned char seq; // sequence number of the request
+};
+
+// status of one link during the run
+struct link_state
+{
+    const struct loadgen_config *config;
+    int fd;
+    int link;            // index of the link
+    unsigned int random; // state of the command selection
+    int64_t start;       // time of the first request (ns)
+    int64_t stop;        // time to stop sending requests (ns)
+
+    // answers received, parsed by a single thread
+    struct link_reader reader;
+
+    unsigned long sent;
+    unsigned long received;
+    unsigned long parity_errors;
+    unsigned long timeouts;
+    int out_of_memory;
+    struct samples samples[LOADGEN_COMMANDS];
+
+    // queue from the sender to the receiver (open loop)
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct pending pending[PENDING_SIZE];
+    int head;
+    int tail;
+    int sending;
+};
+
+/**********************************************************
+ *  PRIVATE STATUS (STATIC GLOBAL VARIABLES)
+ **********************************************************/
+
+// names of the commands in the mix and in the report
+static const char *cmd_names[LOADGEN_COMMANDS] = {
+    "NO_CMD", "SET_HEAT_CMD", "READ_SUN_CMD", "READ_TEMP_CMD", "READ_POS_CMD", "BATCH_CMD"};
+static const char *mix_names[LOADGEN_COMMANDS] = {
+    "none", "set", "sun", "temp", "pos", "batch"};
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: write_frame
+ *********************************************************/
+// frame holds the encoded message from frame[1]
+static int write_frame(int fd, int link, unsigned char *frame, int size)
+{
+    // the whole frame, delimiter included, goes out in a single write
+    size = frame_close(frame, size);
+
+    // only the master side is captured (link is negative on the slave)
+    if (link >= 0)
+    {
+        capture_frame(CAPTURE_TO_SLAVE, link, frame, size);
+    }
+
+    return (link_write_all(fd, frame, size));
+}
+
+/**********************************************************
+ *  Function: read_answer
+ *********************************************************/
+static int read_answer(struct link_state *state, unsigned char seq, int64_t deadline,
+                       struct res_msg *res)
+{
+    struct frame_parser *parser = &state->reader.parser;
+    int ret = link_read_frame(&state->reader, deadline);
+
+    if (ret == READ_TIMEOUT || ret == READ_CLOSED)
+    {
+        return (ret);
+    }
+    capture_frame(CAPTURE_TO_MASTER, state->link, parser->frame, parser->length);
+
+    // the next frame starts after the delimiter, nothing to drop; an
+    // answer to another request is as wrong as a corrupted one
+    if (ret == LINK_READ_WRONG || decode_res_msg(parser->message, ret, res) < 0 ||
+        res->seq != seq)
+    {
+        return (READ_PARITY);
+    }
+    return (READ_OK);
+}
+
+/**********************************************************
+ *  Function: samples_add
+ *********************************************************/
+static void samples_add(struct link_state *state, int cmd, int64_t latency)
+{
+    struct samples *samples = &state->samples[cmd];
+
+    if (samples->count == samples->size)
+    {
+        unsigned long size = (samples->size == 0) ? SAMPLES_INITIAL : samples->size * 2;
+        int64_t *data = realloc(samples->data, size * sizeof(int64_t));
+        if (data == NULL)
+        {
+            state->out_of_memory = 1;
+            return;
+        }
+        samples->data = data;
+        samples->size = size;
+    }
+    samples->data[samples->count++] = latency;
+}
+
+/**********************************************************
+ *  Function: pick_command
+ *********************************************************/
+static short int pick_command(struct link_state *state)
+{
+    unsigned int total = 0;
+    unsigned int value;
+
+    for (int i = 0; i < LOADGEN_COMMANDS; i++)
+    {
+        total += state->config->mix[i];
+    }
+
+    // xorshift, so the same seed gives the same sequence of commands
+    state->random ^= state->random << 13;
+    state->random ^= state->random >> 17;
+    state->random ^= state->random << 5;
+    value = state->random % total;
+
+    for (int i = 0; i < LOADGEN_COMMANDS; i++)
+    {
+        if (value < state->config->mix[i])
+        {
+            return (i);
+        }
+        value -= state->config->mix[i];
+    }
+    return (NO_CMD);
+}
+
+/**********************************************************
+ *  Function: account_answer
+ *********************************************************/
+static void account_answer(struct link_state *state, int ret, short int cmd, int64_t sent_time)
+{
+    if (ret == READ_TIMEOUT)
+    {
+        state->timeouts++;
+        // a late answer must not be taken for the next one
+        link_reader_drain(&state->reader);
+    }
+    else if (ret == READ_PARITY)
+    {
+        state->parity_errors++;
+    }
+    else if (ret == READ_OK)
+    {
+        state->received++;
+        samples_add(state, cmd, clock_now_ns() - sent_time);
+    }
+}
+
+/**********************************************************
+ *  Function: send_request
+ *********************************************************/
+static int send_request(struct link_state *state, short int cmd)
+{
+    struct cmd_msg msg;
+    unsigned char frame[FRAME_MAX_SIZE];
+
+    memset(&msg, 0, sizeof(struct cmd_msg));
+    msg.addr = DEFAULT_ADDR;
+    msg.seq = (unsigned char)state->sent;
+    msg.cmd = (unsigned char)cmd;
+    msg.set_heater = (unsigned char)(state->random & 1);
+    if (cmd == BATCH_CMD)
+    {
+        // the whole state refresh of a cycle of Part C
+        msg.batch = BATCH_SET_HEAT | BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS;
+    }
+
+    if (write_frame(state->fd, state->link, frame, encode_cmd_msg(&msg, frame + 1)) < 0)
+    {
+        return (-1);
+    }
+    state->sent++;
+    return (0);
+}
+
+/**********************************************************
+ *  Function: closed_loop
+ *********************************************************/
+static void *closed_loop(void *arg)
+{
+    struct link_state *state = (struct link_state *)arg;
+    struct res_msg res;
+    int64_t now;
+
+    // one request at a time, the next one as soon as the answer arrives
+    while ((now = clock_now_ns()) < state->stop)
+    {
+        short int cmd = pick_command(state);
+        int ret;
+
+        if (send_request(state, cmd) < 0)
+        {
+            break;
+        }
+        ret = read_answer(state, (unsigned char)(state->sent - 1), now + state->config->timeout, &res);
+        if (ret == READ_CLOSED)
+        {
+            break;
+        }
+        account_answer(state, ret, cmd, now);
+    }
+    return (NULL);
+}
+
+/**********************************************************
+ *  Function: open_loop_sender
+ *********************************************************/
+static void *open_loop_sender(void *arg)
+{
+    struct link_state *state = (struct link_state *)arg;
+    int64_t interval = (int64_t)((double)NS_PER_S / state->config->rate);
+
+    // requests are due at fixed times, whatever the answers
+    for (int64_t due = state->start; due < state->stop; due += interval)
+    {
+        short int cmd = pick_command(state);
+
+        clock_sleep_until(due);
+
+        pthread_mutex_lock(&state->lock);
+        while (((state->tail + 1) % PENDING_SIZE == state->head) && state->sending)
+        {
+            pthread_cond_wait(&state->cond, &state->lock);
+        }
+        // the receiver found the link closed
+        if (!state->sending)
+        {
+            pthread_mutex_unlock(&state->lock);
+            break;
+        }
+        state->pending[state->tail].time = due;
+        state->pending[state->tail].cmd = cmd;
+        state->pending[state->tail].seq = (unsigned char)state->sent;
+        state->tail = (state->tail + 1) % PENDING_SIZE;
+        pthread_cond_broadcast(&state->cond);
+        pthread_mutex_unlock(&state->lock);
+
+        if (send_request(state, cmd) < 0)
+        {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&state->lock);
+    state->sending = 0;
+    pthread_cond_broadcast(&state->cond);
+    pthread_mutex_unlock(&state->lock);
+    return (NULL);
+}
+
+/**********************************************************
+ *  Function: open_loop
+ *********************************************************/
+static void *open_loop(void *arg)
+{
+    struct link_state *state = (struct link_state *)arg;
+    struct res_msg res;
+    pthread_t sender;
+
+    state->sending = 1;
+    if (pthread_create(&sender, NULL, open_loop_sender, state) != 0)
+    {
+        return (NULL);
+    }
+
+    // answers come back in the order of the requests
+    while (1)
+    {
+        struct pending request;
+        int ret;
+
+        pthread_mutex_lock(&state->lock);
+        while (state->head == state->tail && state->sending)
+        {
+            pthread_cond_wait(&state->cond, &state->lock);
+        }
+        if (state->head == state->tail)
+        {
+            pthread_mutex_unlock(&state->lock);
+            break;
+        }
+        request = state->pending[state->head];
+        pthread_mutex_unlock(&state->lock);
+
+        // the latency counts from the time the request was due
+        ret = read_answer(state, request.seq, request.time + state->config->timeout, &res);
+
+        pthread_mutex_lock(&state->lock);
+        state->head = (state->head + 1) % PENDING_SIZE;
+        if (ret == READ_CLOSED)
+        {
+            state->sending = 0;
+        }
+        pthread_cond_broadcast(&state->cond);
+        pthread_mutex_unlock(&state->lock);
+
+        if (ret == READ_CLOSED)
+        {
+            break;
+        }
+        account_answer(state, ret, request.cmd, request.time);
+    }
+
+    pthread_join(sender, NULL);
+    return (NULL);
+}
+
+/**********************************************************
+ *  Function: compare_latency
+ *********************************************************/
+static int compare_latency(const void *a, const void *b)
+{
+    int64_t first = *(const int64_t *)a;
+    int64_t second = *(const int64_t *)b;
+
+    return (first > second) - (first < second);
+}
+
+/**********************************************************
+ *  Function: percentile
+ *********************************************************/
+static int64_t percentile(const int64_t *sorted, unsigned long count, double ratio)
+{
+    // nearest rank
+    unsigned long rank = (unsigned long)(ratio * (double)count + 0.999999);
+
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    if (rank > count)
+    {
+        rank = count;
+    }
+    return (sorted[rank - 1]);
+}
+
+/**********************************************************
+ *  Function: summarize
+ *********************************************************/
+static int summarize(struct link_state *states, int links, int cmd,
+                     struct loadgen_latency *latency)
+{
+    unsigned long count = 0;
+    int64_t *all;
+    double sum = 0.0;
+
+    memset(latency, 0, sizeof(struct loadgen_latency));
+
+    // gather the samples of the command (or all of them if negative)
+    for (int l = 0; l < links; l++)
+    {
+        for (int c = 0; c < LOADGEN_COMMANDS; c++)
+        {
+            if (cmd < 0 || cmd == c)
+            {
+                count += states[l].samples[c].count;
+            }
+        }
+    }
+    if (count == 0)
+    {
+        return (0);
+    }
+
+    all = malloc(count * sizeof(int64_t));
+    if (all == NULL)
+    {
+        return (-1);
+    }
+    count = 0;
+    for (int l = 0; l < links; l++)
+    {
+        for (int c = 0; c < LOADGEN_COMMANDS; c++)
+        {
+            if (cmd < 0 || cmd == c)
+            {
+                memcpy(all + count, states[l].samples[c].data,
+                       states[l].samples[c].count * sizeof(int64_t));
+                count += states[l].samples[c].count;
+            }
+        }
+    }
+
+    qsort(all, count, sizeof(int64_t), compare_latency);
+    for (unsigned long i = 0; i < count; i++)
+    {
+        sum += (double)all[i];
+    }
+
+    latency->count = count;
+    latency->mean = (int64_t)(sum / (double)count);
+    latency->p50 = percentile(all, count, 0.50);
+    latency->p99 = percentile(all, count, 0.99);
+    latency->p999 = percentile(all, count, 0.999);
+    latency->max = all[count - 1];
+
+    free(all);
+    return (0);
+}
+
+/**********************************************************
+ *  Function: print_latency
+ *********************************************************/
+static void print_latency(FILE *out, const char *name, const struct loadgen_latency *latency)
+{
+    fprintf(out, "latency cmd=%s count=%lu mean_us=%.1f p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f\n",
+            name, latency->count,
+            (double)latency->mean / (double)NS_PER_US,
+            (double)latency->p50 / (double)NS_PER_US,
+            (double)latency->p99 / (double)NS_PER_US,
+            (double)latency->p999 / (double)NS_PER_US,
+            (double)latency->max / (double)NS_PER_US);
+}
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: loadgen_default_config
+ *********************************************************/
+void loadgen_default_config(struct loadgen_config *config)
+{
+    memset(config, 0, sizeof(struct loadgen_config));
+    config->mode = LOADGEN_CLOSED;
+    config->rate = 100.0;
+    config->duration = 10 * NS_PER_S;
+    config->timeout = NS_PER_S;
+    config->mix[SET_HEAT_CMD] = 1;
+    config->mix[READ_SUN_CMD] = 1;
+    config->mix[READ_TEMP_CMD] = 1;
+    config->mix[READ_POS_CMD] = 1;
+    config->seed = 1;
+}
+
+/**********************************************************
+ *  Function: loadgen_parse_mix
+ *********************************************************/
+// "set=1,sun=2,temp=4,pos=1" (commands not given get weight 0)
+int loadgen_parse_mix(const char *text, struct loadgen_config *config)
+{
+    unsigned int mix[LOADGEN_COMMANDS] = {0};
+    unsigned int total = 0;
+    const char *item = text;
+
+    while (*item != '\0')
+    {
+        const char *equal = strchr(item, '=');
+        const char *end = strchr(item, ',');
+        int found = 0;
+
+        if (end == NULL)
+        {
+            end = item + strlen(item);
+        }
+        if (equal == NULL || equal > end)
+        {
+            return (-1);
+        }
+        for (int i = 0; i < LOADGEN_COMMANDS; i++)
+        {
+            if (strlen(mix_names[i]) == (size_t)(equal - item) &&
+                strncmp(item, mix_names[i], equal - item) == 0)
+            {
+                mix[i] = (unsigned int)strtoul(equal + 1, NULL, 10);
+                found = 1;
+            }
+        }
+        if (!found)
+        {
+            return (-1);
+        }
+        item = (*end == ',') ? end + 1 : end;
+    }
+
+    for (int i = 0; i < LOADGEN_COMMANDS; i++)
+    {
+        total += mix[i];
+    }
+    if (total == 0)
+    {
+        return (-1);
+    }
+    memcpy(config->mix, mix, sizeof(mix));
+    return (0);
+}
+
+/**********************************************************
+ *  Function: loadgen_run
+ *********************************************************/
+int loadgen_run(const struct loadgen_config *config, const int *fds, int links,
+                struct loadgen_report *report)
+{
+    struct link_state *states;
+    pthread_t threads[LOADGEN_MAX_LINKS];
+    unsigned int total = 0;
+    int64_t start;
+    int ret = 0;
+
+    for (int i = 0; i < LOADGEN_COMMANDS; i++)
+    {
+        total += config->mix[i];
+    }
+    if (links < 1 || links > LOADGEN_MAX_LINKS || config->duration <= 0 ||
+        config->timeout <= 0 || total == 0 ||
+        (config->mode == LOADGEN_OPEN && config->rate <= 0.0))
+    {
+        return (-1);
+    }
+
+    states = calloc(links, sizeof(struct link_state));
+    if (states == NULL)
+    {
+        return (-1);
+    }
+
+    // all the links start at the same time
+    start = clock_now_ns();
+    for (int l = 0; l < links; l++)
+    {
+        states[l].config = config;
+        states[l].fd = fds[l];
+        link_reader_init(&states[l].reader, fds[l]);
+        states[l].link = l;
+        states[l].random = config->seed * 2654435761u + (unsigned int)l + 1;
+        states[l].start = start;
+        states[l].stop = start + config->duration;
+        pthread_mutex_init(&states[l].lock, NULL);
+        pthread_cond_init(&states[l].cond, NULL);
+    }
+    for (int l = 0; l < links; l++)
+    {
+        pthread_create(&threads[l], NULL,
+                       (config->mode == LOADGEN_OPEN) ? open_loop : closed_loop,
+                       &states[l]);
+    }
+    for (int l = 0; l < links; l++)
+    {
+        pthread_join(threads[l], NULL);
+    }
+
+    // merge the results of all the links
+    memset(report, 0, sizeof(struct loadgen_report));
+    report->links = links;
+    report->elapsed = clock_now_ns() - start;
+    for (int l = 0; l < links; l++)
+    {
+        report->sent += states[l].sent;
+        report->received += states[l].received;
+        report->parity_errors += states[l].parity_errors;
+        report->timeouts += states[l].timeouts;
+        if (states[l].out_of_memory)
+        {
+            ret = -1;
+        }
+    }
+    report->throughput = (double)report->received * (double)NS_PER_S / (double)report->elapsed;
+    if (summarize(states, links, -1, &report->total) < 0)
+    {
+        ret = -1;
+    }
+    for (int c = 0; c < LOADGEN_COMMANDS; c++)
+    {
+        if (summarize(states, links, c, &report->per_cmd[c]) < 0)
+        {
+            ret = -1;
+        }
+    }
+
+    for (int l = 0; l < links; l++)
+    {
+        for (int c = 0; c < LOADGEN_COMMANDS; c++)
+        {
+            free(states[l].samples[c].data);
+        }
+        pthread_mutex_destroy(&states[l].lock);
+        pthread_cond_destroy(&states[l].cond);
+    }
+    free(states);
+    return (ret);
+}
+
+/**********************************************************
+ *  Function: loadgen_print_report
+ *********************************************************/
+// one key=value record per line, so runs can be compared with diff/grep
+void loadgen_print_report(FILE *out, const struct loadgen_config *config,
+                          const struct loadgen_report *report)
+{
+    fprintf(out, "loadgen mode=%s links=%d rate=%.1f duration_s=%.3f mix=",
+            (config->mode == LOADGEN_OPEN) ? "open" : "closed", report->links,
+            (config->mode == LOADGEN_OPEN) ? config->rate : 0.0,
+            (double)config->duration / (double)NS_PER_S);
+    for (int i = 0, first = 1; i < LOADGEN_COMMANDS; i++)
+    {
+        if (config->mix[i] > 0)
+        {
+            fprintf(out, "%s%s=%u", first ? "" : ",", mix_names[i], config->mix[i]);
+            first = 0;
+        }
+    }
+    fprintf(out, "\n");
+    fprintf(out, "result elapsed_s=%.3f sent=%lu received=%lu parity_errors=%lu timeouts=%lu throughput=%.1f\n",
+            (double)report->elapsed / (double)NS_PER_S, report->sent, report->received,
+            report->parity_errors, report->timeouts, report->throughput);
+    print_latency(out, "all", &report->total);
+    for (int i = 0; i < LOADGEN_COMMANDS; i++)
+    {
+        if (config->mix[i] > 0)
+        {
+            print_latency(out, cmd_names[i], &report->per_cmd[i]);
+        }
+    }
+}
+
+/**********************************************************
+ *  Function: loadgen_slave
+ *********************************************************/
+// emulated slave: answers the requests on fd with the Part A model
+// until the other end closes it
+int loadgen_slave(int fd)
+{
+    struct sat_ctx ctx;
+    struct link_reader reader;
+    unsigned char frame[FRAME_MAX_SIZE];
+    int ret;
+
+    sat_ctx_init(&ctx);
+    link_reader_init(&reader, fd);
+    while ((ret = link_read_frame(&reader, -1)) != READ_CLOSED)
+    {
+        // a frame for another slave is dropped without decoding it
+        if (ret != LINK_READ_WRONG && reader.parser.message[0] != ctx.addr &&
+            reader.parser.message[0] != BROADCAST_ADDR)
+        {
+            continue;
+        }
+        // check parity error or wrong message
+        if (ret == LINK_READ_WRONG || decode_cmd_msg(reader.parser.message, ret, &ctx.last_cmd_msg) < 0)
+        {
+            ctx.next_res_msg.addr = ctx.addr;
+            ctx.next_res_msg.cmd = NO_CMD;
+            ctx.next_res_msg.status = STATUS_NACK;
+        }
+        else
+        {
+            exec_cmd_msg_ctx(&ctx);
+        }
+
+        // a broadcast is executed but never answered
+        if (ctx.next_res_msg.addr != BROADCAST_ADDR &&
+            write_frame(fd, -1, frame, encode_res_msg(&ctx.next_res_msg, frame + 1)) < 0)
+        {
+            return (-1);
+        }
+
+        // reset buffers for the next request
+        memset(&ctx.last_cmd_msg, 0, sizeof(struct cmd_msg));
+        memset(&ctx.next_res_msg, 0, sizeof(struct res_msg));
+    }
+    return (0);
+}
@@ -0,0 +1,91 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define LOADGEN_MAX_LINKS 64
+#define LOADGEN_COMMANDS 6 // NO_CMD to BATCH_CMD
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// way requests are issued on each link
+enum loadgen_mode
+{
+    LOADGEN_CLOSED = 0, // next request as soon as the answer arrives
+    LOADGEN_OPEN = 1    // requests at a fixed rate, whatever the answers
+};
+
+// configuration of a load run
+struct loadgen_config
+{
+    enum loadgen_mode mode;             // closed or open loop
+    double rate;                        // requests/sec per link (open loop)
+    int64_t duration;                   // time to issue requests (ns)
+    int64_t timeout;                    // time to wait for an answer (ns)
+    unsigned int mix[LOADGEN_COMMANDS]; // weight of each command
+    unsigned int seed;                  // seed of the command selection
+};
+
+// latency of a set of requests
+struct loadgen_latency
+{
+    unsigned long count; // answers received
+    int64_t mean;        // mean round trip time (ns)
+    int64_t p50;         // percentiles of the round trip time (ns)
+    int64_t p99;
+    int64_t p999;
+    int64_t max;
+};
+
+// results of a load run
+struct loadgen_report
+{
+    int links;                   // links driven
+    int64_t elapsed;             // time from first request to last answer (ns)
+    unsigned long sent;          // requests sent
+    unsigned long received;      // answers received
+    unsigned long parity_errors; // answers received wrong
+    unsigned long timeouts;      // requests without answer in time
+    double throughput;           // answers/sec on all links
+    struct loadgen_latency total;
+    struct loadgen_latency per_cmd[LOADGEN_COMMANDS];
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: loadgen_default_config
+ *********************************************************/
+void loadgen_default_config(struct loadgen_config *config);
+
+/**********************************************************
+ *  Function: loadgen_parse_mix
+ *********************************************************/
+int loadgen_parse_mix(const char *text, struct loadgen_config *config);
+
+/**********************************************************
+ *  Function: loadgen_run
+ *********************************************************/
+int loadgen_run(const struct loadgen_config *config, const int *fds, int links,
+                struct loadgen_report *report);
+
+/**********************************************************
+ *  Function: loadgen_print_report
+ *********************************************************/
+void loadgen_print_report(FILE *out, const struct loadgen_config *config,
+                          const struct loadgen_report *report);
+
+/**********************************************************
+ *  Function: loadgen_slave
+ *********************************************************/
+int loadgen_slave(int fd);
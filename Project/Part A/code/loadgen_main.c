@@ -0,0 +1,177 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "capture.h"
+#include "clock.h"
+#include "link_io.h"
+#include "loadgen.h"
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: usage
+ *********************************************************/
+static void usage(const char *name)
+{
+    printf("usage: %s [options] [device ...]\n", name);
+    printf("  -m closed|open  closed loop or fixed rate requests (closed)\n");
+    printf("  -r rate         requests/sec per link in open loop (100)\n");
+    printf("  -d seconds      time to issue requests (10)\n");
+    printf("  -t ms           time to wait for an answer (1000)\n");
+    printf("  -x mix          weights, e.g. set=1,sun=1,temp=4,pos=1,batch=1\n");
+    printf("  -s seed         seed of the command selection (1)\n");
+    printf("  -b baud         speed of the serial devices (9600)\n");
+    printf("  -l links        emulated slaves if no device is given (1)\n");
+    printf("  -c file         capture the traffic to file\n");
+}
+
+/**********************************************************
+ *  Function: slave_thread
+ *********************************************************/
+static void *slave_thread(void *arg)
+{
+    int fd = *(int *)arg;
+
+    loadgen_slave(fd);
+    close(fd);
+    return (NULL);
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+int main(int argc, char **argv)
+{
+    struct loadgen_config config;
+    struct loadgen_report report;
+    int fds[LOADGEN_MAX_LINKS];
+    int slave_fds[LOADGEN_MAX_LINKS];
+    pthread_t slaves[LOADGEN_MAX_LINKS];
+    int links = 1;
+    int emulated = 0;
+    long baud = 9600;
+    const char *capture = NULL;
+    int option;
+
+    loadgen_default_config(&config);
+    while ((option = getopt(argc, argv, "m:r:d:t:x:s:b:l:c:h")) != -1)
+    {
+        switch (option)
+        {
+        case 'm':
+            config.mode = (strcmp(optarg, "open") == 0) ? LOADGEN_OPEN : LOADGEN_CLOSED;
+            break;
+        case 'r':
+            config.rate = atof(optarg);
+            break;
+        case 'd':
+            config.duration = (int64_t)(atof(optarg) * (double)NS_PER_S);
+            break;
+        case 't':
+            config.timeout = (int64_t)(atof(optarg) * (double)NS_PER_MS);
+            break;
+        case 'x':
+            if (loadgen_parse_mix(optarg, &config) < 0)
+            {
+                printf("ERROR: wrong command mix %s\n", optarg);
+                return (-1);
+            }
+            break;
+        case 's':
+            config.seed = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            baud = atol(optarg);
+            break;
+        case 'l':
+            links = atoi(optarg);
+            break;
+        case 'c':
+            capture = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return (-1);
+        }
+    }
+
+    // a closed link must not kill the process
+    signal(SIGPIPE, SIG_IGN);
+
+    if (optind < argc)
+    {
+        // real slaves on serial devices
+        links = argc - optind;
+        if (links > LOADGEN_MAX_LINKS)
+        {
+            printf("ERROR: wrong number of devices\n");
+            return (-1);
+        }
+        for (int l = 0; l < links; l++)
+        {
+            fds[l] = link_open_serial(argv[optind + l], baud);
+            if (fds[l] < 0)
+            {
+                printf("open: error opening serial %s\n", argv[optind + l]);
+                return (-1);
+            }
+        }
+    }
+    else
+    {
+        // emulated slaves connected through socket pairs
+        if (links < 1 || links > LOADGEN_MAX_LINKS)
+        {
+            printf("ERROR: wrong number of links\n");
+            return (-1);
+        }
+        emulated = 1;
+        for (int l = 0; l < links; l++)
+        {
+            int pair[2];
+
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+            {
+                printf("ERROR: socketpair\n");
+                return (-1);
+            }
+            fds[l] = pair[0];
+            slave_fds[l] = pair[1];
+            pthread_create(&slaves[l], NULL, slave_thread, &slave_fds[l]);
+        }
+    }
+
+    if (capture != NULL && capture_start(capture) < 0)
+    {
+        printf("ERROR: cannot create capture %s\n", capture);
+        return (-1);
+    }
+    if (loadgen_run(&config, fds, links, &report) < 0)
+    {
+        printf("ERROR: wrong load parameters\n");
+        return (-1);
+    }
+    capture_stop();
+    loadgen_print_report(stdout, &config, &report);
+
+    for (int l = 0; l < links; l++)
+    {
+        close(fds[l]);
+        if (emulated)
+        {
+            pthread_join(slaves[l], NULL);
+        }
+    }
+    return (0);
+}
@@ -0,0 +1,123 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <string.h>
+
+#include "poll_scheduler.h"
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: poll_scheduler_init
+ *********************************************************/
+// -1 with no nodes, more than POLL_MAX_NODES or a node taking no requests
+int poll_scheduler_init(struct poll_scheduler *scheduler, const unsigned char *addrs, int count,
+                        int max_outstanding)
+{
+    if (count < 1 || count > POLL_MAX_NODES || max_outstanding < 1)
+    {
+        return (-1);
+    }
+    memset(scheduler, 0, sizeof(struct poll_scheduler));
+    for (int i = 0; i < count; i++)
+    {
+        scheduler->nodes[i].addr = addrs[i];
+        scheduler->nodes[i].backoff = POLL_BACKOFF_MIN;
+    }
+    scheduler->count = count;
+    scheduler->max_outstanding = max_outstanding;
+    return (0);
+}
+
+/**********************************************************
+ *  Function: poll_scheduler_next
+ *********************************************************/
+// node of the next request: the one with the fewest requests outstanding
+// of those not resting after a failure, in turns on a tie; if all of
+// them rest, the first to end it, so a lone node is never left out;
+// -1 if every node has max_outstanding requests
+int poll_scheduler_next(struct poll_scheduler *scheduler, int64_t now)
+{
+    int best = -1;
+    int resting = -1;
+
+    for (int k = 0; k < scheduler->count; k++)
+    {
+        int i = (scheduler->next + k) % scheduler->count;
+        const struct poll_node *node = &scheduler->nodes[i];
+
+        if (node->outstanding >= scheduler->max_outstanding)
+        {
+            continue;
+        }
+        if (node->ready > now)
+        {
+            if (resting < 0 || node->ready < scheduler->nodes[resting].ready)
+            {
+                resting = i;
+            }
+        }
+        else if (best < 0 || node->outstanding < scheduler->nodes[best].outstanding)
+        {
+            best = i;
+        }
+    }
+    return ((best >= 0) ? best : resting);
+}
+
+/**********************************************************
+ *  Function: poll_scheduler_find
+ *********************************************************/
+// node of an address, -1 if it is not on the link
+int poll_scheduler_find(const struct poll_scheduler *scheduler, unsigned char addr)
+{
+    for (int i = 0; i < scheduler->count; i++)
+    {
+        if (scheduler->nodes[i].addr == addr)
+        {
+            return (i);
+        }
+    }
+    return (-1);
+}
+
+/**********************************************************
+ *  Function: poll_scheduler_sent
+ *********************************************************/
+void poll_scheduler_sent(struct poll_scheduler *scheduler, int node)
+{
+    scheduler->nodes[node].outstanding++;
+    scheduler->nodes[node].polls++;
+    scheduler->next = (node + 1) % scheduler->count;
+}
+
+/**********************************************************
+ *  Function: poll_scheduler_answered
+ *********************************************************/
+void poll_scheduler_answered(struct poll_scheduler *scheduler, int node)
+{
+    if (scheduler->nodes[node].outstanding > 0)
+    {
+        scheduler->nodes[node].outstanding--;
+    }
+    scheduler->nodes[node].ready = 0;
+    scheduler->nodes[node].backoff = POLL_BACKOFF_MIN;
+}
+
+/**********************************************************
+ *  Function: poll_scheduler_failed
+ *********************************************************/
+// the node left its requests without answer: they are over, and it rests
+// for a while, twice as long after every failure in a row
+void poll_scheduler_failed(struct poll_scheduler *scheduler, int node, int64_t now)
+{
+    struct poll_node *failed = &scheduler->nodes[node];
+
+    failed->outstanding = 0;
+    failed->failures++;
+    failed->ready = now + failed->backoff;
+    failed->backoff = (2 * failed->backoff < POLL_BACKOFF_MAX) ? 2 * failed->backoff : POLL_BACKOFF_MAX;
+}
@@ -0,0 +1,81 @@
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdint.h>
+
+#include "clock.h"
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define POLL_MAX_NODES 8                    // slaves sharing one link
+#define POLL_BACKOFF_MIN (100 * NS_PER_MS)  // rest of a node after its first failure
+#define POLL_BACKOFF_MAX (5 * NS_PER_S)
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// one slave of a multi-drop link
+struct poll_node
+{
+    unsigned char addr;     // address of the slave (enum address)
+    int outstanding;        // requests sent and not answered yet
+    int64_t ready;          // time it is polled again after a failure (ns)
+    int64_t backoff;        // rest after its next failure (ns)
+    unsigned long polls;    // requests sent to it
+    unsigned long failures; // times it left its requests without answer
+};
+
+// chooses the slave of every request: the master is the only one that
+// starts a talk on the link, so while a slave executes the requests it
+// has, the link is used to send others to the rest
+struct poll_scheduler
+{
+    struct poll_node nodes[POLL_MAX_NODES];
+    int count;           // nodes on the link
+    int max_outstanding; // requests a node takes before its answers
+    int next;            // first node looked at on the next choice
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: poll_scheduler_init
+ *********************************************************/
+int poll_scheduler_init(struct poll_scheduler *scheduler, const unsigned char *addrs, int count,
+                        int max_outstanding);
+
+/**********************************************************
+ *  Function: poll_scheduler_next
+ *********************************************************/
+int poll_scheduler_next(struct poll_scheduler *scheduler, int64_t now);
+
+/**********************************************************
+ *  Function: poll_scheduler_find
+ *********************************************************/
+int poll_scheduler_find(const struct poll_scheduler *scheduler, unsigned char addr);
+
+/**********************************************************
+ *  Function: poll_scheduler_sent
+ *********************************************************/
+void poll_scheduler_sent(struct poll_scheduler *scheduler, int node);
+
+/**********************************************************
+ *  Function: poll_scheduler_answered
+ *********************************************************/
+void poll_scheduler_answered(struct poll_scheduler *scheduler, int node);
+
+/**********************************************************
+ *  Function: poll_scheduler_failed
+ *********************************************************/
+void poll_scheduler_failed(struct poll_scheduler *scheduler, int node, int64_t now);
+
+#endif
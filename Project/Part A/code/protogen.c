@@ -0,0 +1,1243 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define MAX_DECLS 32
+#define MAX_MEMBERS 32
+#define MAX_NAME 32
+#define MAX_COMMENT 96
+#define MAX_LINE 256
+#define MAX_OUTPUT 65536
+
+#define DECL_ENUM 0
+#define DECL_STRUCT 1
+
+// CRC-16/CCITT of the frames
+#define CRC_POLY 0x1021
+#define CRC_INIT 0xFFFF
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// basic type of a field on the wire
+struct wire_type
+{
+    const char *name;  // name in the schema
+    const char *ctype; // type of the field in memory
+    int size;          // bytes on the wire (bit fields share bytes)
+};
+
+// constant of an enum, field of a struct or member of its union
+struct member
+{
+    char type[MAX_NAME];       // type of the field
+    char name[MAX_NAME];       // name of the constant or field
+    char selector[MAX_NAME];   // case of the union it belongs to
+    char step[MAX_NAME];       // resolution of a fixed point field
+    char comment[MAX_COMMENT]; // comment of the declaration
+    long value;                // value of an enum constant
+};
+
+// enum or struct of the schema
+struct decl
+{
+    int kind;                  // DECL_ENUM or DECL_STRUCT
+    char name[MAX_NAME];       // name of the enum or struct
+    char comment[MAX_COMMENT]; // comment of the declaration
+    struct member members[MAX_MEMBERS];
+    int count;
+    char union_name[MAX_NAME]; // union at the end of the struct (if any)
+    char union_on[MAX_NAME];   // field selecting the member of the union
+    struct member cases[MAX_MEMBERS];
+    int cases_count;
+};
+
+/**********************************************************
+ *  PRIVATE STATUS (STATIC GLOBAL VARIABLES)
+ **********************************************************/
+
+static const struct wire_type wire_types[] = {
+    {"u8", "unsigned char", 1},
+    {"i16", "short int", 2},
+    {"u16", "unsigned short int", 2},
+    {"i32", "int32_t", 4},
+    {"u32", "uint32_t", 4},
+    {"f32", "float", 4},
+    {"q16", "float", 2},
+    {"q24", "float", 3},
+    {"bit", "unsigned char", 0},
+};
+
+static struct decl decls[MAX_DECLS];
+static int decls_count = 0;
+
+// generated header
+static char output[MAX_OUTPUT];
+static int output_size = 0;
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: fail
+ *********************************************************/
+static void fail(int line, const char *message)
+{
+    fprintf(stderr, "protogen: line %d: %s\n", line, message);
+    exit(1);
+}
+
+/**********************************************************
+ *  Function: emit
+ *********************************************************/
+static void emit(const char *format, ...)
+{
+    va_list args;
+    int ret;
+
+    va_start(args, format);
+    ret = vsnprintf(output + output_size, MAX_OUTPUT - output_size, format, args);
+    va_end(args);
+    if (ret < 0 || ret >= MAX_OUTPUT - output_size)
+    {
+        fprintf(stderr, "protogen: generated header too long\n");
+        exit(1);
+    }
+    output_size += ret;
+}
+
+/**********************************************************
+ *  Function: find_wire_type
+ *********************************************************/
+static const struct wire_type *find_wire_type(const char *name)
+{
+    for (int i = 0; i < (int)(sizeof(wire_types) / sizeof(wire_types[0])); i++)
+    {
+        if (strcmp(wire_types[i].name, name) == 0)
+        {
+            return (&wire_types[i]);
+        }
+    }
+    return (NULL);
+}
+
+/**********************************************************
+ *  Function: find_decl
+ *********************************************************/
+static struct decl *find_decl(const char *name, int kind)
+{
+    for (int i = 0; i < decls_count; i++)
+    {
+        if (decls[i].kind == kind && strcmp(decls[i].name, name) == 0)
+        {
+            return (&decls[i]);
+        }
+    }
+    return (NULL);
+}
+
+/**********************************************************
+ *  Function: type_size
+ *********************************************************/
+static int wire_size(const struct decl *decl);
+
+static int type_size(const char *type)
+{
+    const struct wire_type *wire = find_wire_type(type);
+
+    if (wire != NULL)
+    {
+        return (wire->size);
+    }
+    return (wire_size(find_decl(type, DECL_STRUCT)));
+}
+
+/**********************************************************
+ *  Function: find_case
+ *********************************************************/
+// earlier case of the union declaring the same member (several cases can
+// share one member)
+static const struct member *find_case(const struct decl *decl, int count, const char *name)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(decl->cases[i].name, name) == 0)
+        {
+            return (&decl->cases[i]);
+        }
+    }
+    return (NULL);
+}
+
+/**********************************************************
+ *  Function: is_fixed
+ *********************************************************/
+// fixed point fields carry a float as a signed integer of steps
+static int is_fixed(const char *type)
+{
+    return (strcmp(type, "q16") == 0 || strcmp(type, "q24") == 0);
+}
+
+/**********************************************************
+ *  Function: field_layout
+ *********************************************************/
+// byte offset of each field of the struct and bit of the bit fields (-1
+// for the others), returns the bytes before the union: consecutive bit
+// fields are packed in the same byte, up to 8
+static int field_layout(const struct decl *decl, int *offset, int *bit)
+{
+    int size = 0;
+    int next_bit = 8;
+
+    for (int i = 0; i < decl->count; i++)
+    {
+        if (strcmp(decl->members[i].type, "bit") == 0)
+        {
+            if (next_bit == 8)
+            {
+                next_bit = 0;
+                size++;
+            }
+            offset[i] = size - 1;
+            bit[i] = next_bit++;
+            continue;
+        }
+        next_bit = 8;
+        offset[i] = size;
+        bit[i] = -1;
+        size += type_size(decl->members[i].type);
+    }
+    return (size);
+}
+
+/**********************************************************
+ *  Function: header_size
+ *********************************************************/
+// bytes of the fields before the union
+static int header_size(const struct decl *decl)
+{
+    int offset[MAX_MEMBERS];
+    int bit[MAX_MEMBERS];
+
+    return (field_layout(decl, offset, bit));
+}
+
+/**********************************************************
+ *  Function: union_size
+ *********************************************************/
+static int union_size(const struct decl *decl)
+{
+    int size = 0;
+
+    // the largest member sets the size of the union
+    for (int i = 0; i < decl->cases_count; i++)
+    {
+        int member = type_size(decl->cases[i].type);
+        size = (member > size) ? member : size;
+    }
+    return (size);
+}
+
+/**********************************************************
+ *  Function: wire_size
+ *********************************************************/
+static int wire_size(const struct decl *decl)
+{
+    return (header_size(decl) + union_size(decl));
+}
+
+/**********************************************************
+ *  Function: ctype
+ *********************************************************/
+static const char *ctype(const char *type)
+{
+    static char name[2 * MAX_NAME];
+    const struct wire_type *wire = find_wire_type(type);
+
+    if (wire != NULL)
+    {
+        return (wire->ctype);
+    }
+    snprintf(name, sizeof(name), "struct %s", type);
+    return (name);
+}
+
+/**********************************************************
+ *  Function: upper
+ *********************************************************/
+static const char *upper(const char *text)
+{
+    static char name[MAX_NAME];
+    int i;
+
+    for (i = 0; text[i] != '\0' && i < MAX_NAME - 1; i++)
+    {
+        name[i] = (char)toupper((unsigned char)text[i]);
+    }
+    name[i] = '\0';
+    return (name);
+}
+
+/**********************************************************
+ *  Function: split_comment
+ *********************************************************/
+// cuts the line at '#' and keeps the text after it as comment
+static void split_comment(char *line, char *comment)
+{
+    char *mark = strchr(line, '#');
+    int size;
+
+    comment[0] = '\0';
+    if (mark == NULL)
+    {
+        return;
+    }
+    *mark = '\0';
+    mark++;
+    while (isspace((unsigned char)*mark))
+    {
+        mark++;
+    }
+    snprintf(comment, MAX_COMMENT, "%s", mark);
+    size = (int)strlen(comment);
+    while (size > 0 && isspace((unsigned char)comment[size - 1]))
+    {
+        comment[--size] = '\0';
+    }
+}
+
+/**********************************************************
+ *  Function: check_type
+ *********************************************************/
+static void check_type(int line, const char *type)
+{
+    if (find_wire_type(type) == NULL && find_decl(type, DECL_STRUCT) == NULL)
+    {
+        fail(line, "unknown type");
+    }
+}
+
+/**********************************************************
+ *  Function: check_step
+ *********************************************************/
+// a fixed point field is "TYPE NAME STEP", any other "TYPE NAME"
+static void check_step(int line, const char *type, int words, int expected, const char *step)
+{
+    char *end;
+
+    if (!is_fixed(type))
+    {
+        if (words != expected)
+        {
+            fail(line, "only q16 and q24 fields have a step");
+        }
+        return;
+    }
+    if (words != expected + 1 || strtod(step, &end) <= 0.0 || *end != '\0')
+    {
+        fail(line, "expected a positive STEP after a q16 or q24 field");
+    }
+}
+
+/**********************************************************
+ *  Function: parse_schema
+ *********************************************************/
+static void parse_schema(FILE *file)
+{
+    char line[MAX_LINE];
+    char comment[MAX_COMMENT];
+    char word[5][MAX_NAME];
+    struct decl *decl = NULL;
+    int union_indent = -1;
+    int number = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        int indent = 0;
+        int words;
+
+        number++;
+        split_comment(line, comment);
+        while (line[indent] == ' ' || line[indent] == '\t')
+        {
+            indent++;
+        }
+        words = sscanf(line, "%31s %31s %31s %31s %31s", word[0], word[1], word[2], word[3], word[4]);
+        if (words <= 0)
+        {
+            continue;
+        }
+
+        // new declaration
+        if (indent == 0)
+        {
+            if (words != 2 || decls_count == MAX_DECLS)
+            {
+                fail(number, "expected \"enum NAME\" or \"struct NAME\"");
+            }
+            decl = &decls[decls_count++];
+            memset(decl, 0, sizeof(struct decl));
+            if (strcmp(word[0], "enum") == 0)
+            {
+                decl->kind = DECL_ENUM;
+            }
+            else if (strcmp(word[0], "struct") == 0)
+            {
+                decl->kind = DECL_STRUCT;
+            }
+            else
+            {
+                fail(number, "expected \"enum NAME\" or \"struct NAME\"");
+            }
+            snprintf(decl->name, MAX_NAME, "%s", word[1]);
+            snprintf(decl->comment, MAX_COMMENT, "%s", comment);
+            union_indent = -1;
+            continue;
+        }
+        if (decl == NULL)
+        {
+            fail(number, "member outside a declaration");
+        }
+
+        // constant of an enum
+        if (decl->kind == DECL_ENUM)
+        {
+            struct member *member = &decl->members[decl->count];
+            char *end;
+
+            if (words != 3 || strcmp(word[1], "=") != 0 || decl->count == MAX_MEMBERS)
+            {
+                fail(number, "expected \"NAME = VALUE\"");
+            }
+            snprintf(member->name, MAX_NAME, "%s", word[0]);
+            snprintf(member->comment, MAX_COMMENT, "%s", comment);
+            member->value = strtol(word[2], &end, 0);
+            if (*end != '\0')
+            {
+                fail(number, "wrong value");
+            }
+            decl->count++;
+            continue;
+        }
+
+        // member of the union
+        if (union_indent >= 0 && indent > union_indent)
+        {
+            struct member *member = &decl->cases[decl->cases_count];
+
+            if (words < 3 || decl->cases_count == MAX_MEMBERS)
+            {
+                fail(number, "expected \"CASE TYPE NAME\"");
+            }
+            check_type(number, word[1]);
+            check_step(number, word[1], words, 3, word[3]);
+            if (strcmp(word[1], "bit") == 0)
+            {
+                fail(number, "bit fields go before the union");
+            }
+            const struct member *shared = find_case(decl, decl->cases_count, word[2]);
+            if (shared != NULL && strcmp(shared->type, word[1]) != 0)
+            {
+                fail(number, "cases sharing a member must have the same type");
+            }
+            snprintf(member->selector, MAX_NAME, "%s", word[0]);
+            snprintf(member->type, MAX_NAME, "%s", word[1]);
+            snprintf(member->name, MAX_NAME, "%s", word[2]);
+            snprintf(member->step, MAX_NAME, "%s", (words > 3) ? word[3] : "");
+            snprintf(member->comment, MAX_COMMENT, "%s", comment);
+            decl->cases_count++;
+            continue;
+        }
+        if (union_indent >= 0)
+        {
+            fail(number, "the union must be the last member of the struct");
+        }
+
+        // union at the end of the struct
+        if (strcmp(word[0], "union") == 0)
+        {
+            int selector = -1;
+
+            if (words != 4 || strcmp(word[2], "on") != 0)
+            {
+                fail(number, "expected \"union NAME on FIELD\"");
+            }
+            for (int i = 0; i < decl->count; i++)
+            {
+                if (strcmp(decl->members[i].name, word[3]) == 0)
+                {
+                    selector = i;
+                }
+            }
+            if (selector < 0 || find_wire_type(decl->members[selector].type) == NULL ||
+                strcmp(find_wire_type(decl->members[selector].type)->ctype, "float") == 0 ||
+                strcmp(decl->members[selector].type, "bit") == 0)
+            {
+                fail(number, "the union must be selected by a previous integer field");
+            }
+            snprintf(decl->union_name, MAX_NAME, "%s", word[1]);
+            snprintf(decl->union_on, MAX_NAME, "%s", word[3]);
+            union_indent = indent;
+            continue;
+        }
+
+        // field of the struct
+        if (words < 2 || decl->count == MAX_MEMBERS)
+        {
+            fail(number, "expected \"TYPE NAME\"");
+        }
+        check_type(number, word[0]);
+        check_step(number, word[0], words, 2, word[2]);
+        snprintf(decl->members[decl->count].type, MAX_NAME, "%s", word[0]);
+        snprintf(decl->members[decl->count].name, MAX_NAME, "%s", word[1]);
+        snprintf(decl->members[decl->count].step, MAX_NAME, "%s", (words > 2) ? word[2] : "");
+        snprintf(decl->members[decl->count].comment, MAX_COMMENT, "%s", comment);
+        decl->count++;
+    }
+}
+
+/**********************************************************
+ *  Function: emit_field
+ *********************************************************/
+// declaration of a field with its comment aligned at column
+static void emit_field(const char *indent, const struct member *member, int column)
+{
+    char text[3 * MAX_NAME];
+
+    snprintf(text, sizeof(text), "%s %s;", ctype(member->type), member->name);
+    if (member->comment[0] == '\0')
+    {
+        emit("%s%s\n", indent, text);
+    }
+    else
+    {
+        emit("%s%-*s // %s\n", indent, column, text, member->comment);
+    }
+}
+
+/**********************************************************
+ *  Function: field_width
+ *********************************************************/
+static int field_width(const struct member *members, int count)
+{
+    int width = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        int size = (int)strlen(ctype(members[i].type)) + (int)strlen(members[i].name) + 2;
+        width = (size > width) ? size : width;
+    }
+    return (width);
+}
+
+/**********************************************************
+ *  Function: emit_types
+ *********************************************************/
+static void emit_types(void)
+{
+    for (int d = 0; d < decls_count; d++)
+    {
+        const struct decl *decl = &decls[d];
+
+        if (decl->comment[0] != '\0')
+        {
+            emit("// %s\n", decl->comment);
+        }
+        if (decl->kind == DECL_ENUM)
+        {
+            char text[MAX_NAME + 32];
+            int width = 0;
+
+            // constants with their comments aligned
+            for (int i = 0; i < decl->count; i++)
+            {
+                int size = snprintf(text, sizeof(text), "%s = %ld,", decl->members[i].name,
+                                    decl->members[i].value);
+                width = (size > width) ? size : width;
+            }
+            emit("enum %s\n{\n", decl->name);
+            for (int i = 0; i < decl->count; i++)
+            {
+                snprintf(text, sizeof(text), "%s = %ld%s", decl->members[i].name,
+                         decl->members[i].value, (i + 1 < decl->count) ? "," : "");
+                if (decl->members[i].comment[0] == '\0')
+                {
+                    emit("    %s\n", text);
+                }
+                else
+                {
+                    emit("    %-*s // %s\n", width, text, decl->members[i].comment);
+                }
+            }
+            emit("};\n\n");
+            continue;
+        }
+
+        int width = field_width(decl->members, decl->count);
+        int cases = field_width(decl->cases, decl->cases_count);
+
+        emit("struct %s\n{\n", decl->name);
+        for (int i = 0; i < decl->count; i++)
+        {
+            emit_field("    ", &decl->members[i], width);
+        }
+        if (decl->cases_count > 0)
+        {
+            emit("    union\n    {\n");
+            for (int i = 0; i < decl->cases_count; i++)
+            {
+                if (find_case(decl, i, decl->cases[i].name) == NULL)
+                {
+                    emit_field("        ", &decl->cases[i], cases);
+                }
+            }
+            emit("    } %s;\n", decl->union_name);
+        }
+        emit("};\n\n");
+    }
+}
+
+/**********************************************************
+ *  Function: emit_helpers
+ *********************************************************/
+static void emit_helpers(void)
+{
+    emit("/**********************************************************\n"
+         " *  Function: protocol_put_u8 ... protocol_get_f32\n"
+         " *********************************************************/\n"
+         "// little endian whatever the host, floats as their IEEE 754 bits\n"
+         "static inline void protocol_put_u32(unsigned char *buffer, uint32_t value)\n"
+         "{\n"
+         "    buffer[0] = (unsigned char)value;\n"
+         "    buffer[1] = (unsigned char)(value >> 8);\n"
+         "    buffer[2] = (unsigned char)(value >> 16);\n"
+         "    buffer[3] = (unsigned char)(value >> 24);\n"
+         "}\n\n"
+         "static inline uint32_t protocol_get_u32(const unsigned char *buffer)\n"
+         "{\n"
+         "    return (((uint32_t)buffer[0]) | (((uint32_t)buffer[1]) << 8) |\n"
+         "            (((uint32_t)buffer[2]) << 16) | (((uint32_t)buffer[3]) << 24));\n"
+         "}\n\n"
+         "static inline void protocol_put_u16(unsigned char *buffer, uint16_t value)\n"
+         "{\n"
+         "    buffer[0] = (unsigned char)value;\n"
+         "    buffer[1] = (unsigned char)(value >> 8);\n"
+         "}\n\n"
+         "static inline uint16_t protocol_get_u16(const unsigned char *buffer)\n"
+         "{\n"
+         "    return ((uint16_t)(((uint16_t)buffer[0]) | (((uint16_t)buffer[1]) << 8)));\n"
+         "}\n\n"
+         "static inline void protocol_put_u8(unsigned char *buffer, unsigned char value)\n"
+         "{\n"
+         "    buffer[0] = value;\n"
+         "}\n\n"
+         "static inline unsigned char protocol_get_u8(const unsigned char *buffer)\n"
+         "{\n"
+         "    return (buffer[0]);\n"
+         "}\n\n"
+         "static inline void protocol_put_i16(unsigned char *buffer, short int value)\n"
+         "{\n"
+         "    protocol_put_u16(buffer, (uint16_t)value);\n"
+         "}\n\n"
+         "static inline short int protocol_get_i16(const unsigned char *buffer)\n"
+         "{\n"
+         "    return ((short int)protocol_get_u16(buffer));\n"
+         "}\n\n"
+         "static inline void protocol_put_i32(unsigned char *buffer, int32_t value)\n"
+         "{\n"
+         "    protocol_put_u32(buffer, (uint32_t)value);\n"
+         "}\n\n"
+         "static inline int32_t protocol_get_i32(const unsigned char *buffer)\n"
+         "{\n"
+         "    return ((int32_t)protocol_get_u32(buffer));\n"
+         "}\n\n"
+         "static inline void protocol_put_f32(unsigned char *buffer, float value)\n"
+         "{\n"
+         "    uint32_t bits;\n"
+         "\n"
+         "    memcpy(&bits, &value, 4);\n"
+         "    protocol_put_u32(buffer, bits);\n"
+         "}\n\n"
+         "static inline float protocol_get_f32(const unsigned char *buffer)\n"
+         "{\n"
+         "    uint32_t bits = protocol_get_u32(buffer);\n"
+         "    float value;\n"
+         "\n"
+         "    memcpy(&value, &bits, 4);\n"
+         "    return (value);\n"
+         "}\n\n"
+         "/**********************************************************\n"
+         " *  Function: protocol_put_bit ... protocol_get_q24\n"
+         " *********************************************************/\n"
+         "// bit fields share a byte, the first one clears it\n"
+         "static inline void protocol_put_bit(unsigned char *buffer, int bit, unsigned char value)\n"
+         "{\n"
+         "    if (bit == 0)\n"
+         "    {\n"
+         "        buffer[0] = 0;\n"
+         "    }\n"
+         "    buffer[0] |= (unsigned char)((value ? 1 : 0) << bit);\n"
+         "}\n\n"
+         "static inline unsigned char protocol_get_bit(const unsigned char *buffer, int bit)\n"
+         "{\n"
+         "    return ((unsigned char)((buffer[0] >> bit) & 1));\n"
+         "}\n\n"
+         "// fixed point: value rounded to a whole number of steps, saturated at the\n"
+         "// limits of the field (NaN goes as 0)\n"
+         "static inline long protocol_quantize(float value, float step, long limit)\n"
+         "{\n"
+         "    float steps = value / step;\n"
+         "\n"
+         "    if (steps != steps)\n"
+         "    {\n"
+         "        return (0);\n"
+         "    }\n"
+         "    if (steps >= (float)limit)\n"
+         "    {\n"
+         "        return (limit);\n"
+         "    }\n"
+         "    if (steps <= (float)-limit)\n"
+         "    {\n"
+         "        return (-limit);\n"
+         "    }\n"
+         "    return ((long)(steps + ((steps < 0.0f) ? -0.5f : 0.5f)));\n"
+         "}\n\n"
+         "static inline void protocol_put_q16(unsigned char *buffer, float value, float step)\n"
+         "{\n"
+         "    protocol_put_u16(buffer, (uint16_t)protocol_quantize(value, step, 32767L));\n"
+         "}\n\n"
+         "static inline float protocol_get_q16(const unsigned char *buffer, float step)\n"
+         "{\n"
+         "    return ((float)(int16_t)protocol_get_u16(buffer) * step);\n"
+         "}\n\n"
+         "static inline void protocol_put_q24(unsigned char *buffer, float value, float step)\n"
+         "{\n"
+         "    uint32_t steps = (uint32_t)protocol_quantize(value, step, 8388607L);\n"
+         "\n"
+         "    buffer[0] = (unsigned char)steps;\n"
+         "    buffer[1] = (unsigned char)(steps >> 8);\n"
+         "    buffer[2] = (unsigned char)(steps >> 16);\n"
+         "}\n\n"
+         "static inline float protocol_get_q24(const unsigned char *buffer, float step)\n"
+         "{\n"
+         "    uint32_t steps = ((uint32_t)buffer[0]) | (((uint32_t)buffer[1]) << 8) |\n"
+         "                     (((uint32_t)buffer[2]) << 16);\n"
+         "\n"
+         "    // sign of the 24 bits\n"
+         "    return ((float)((int32_t)(steps ^ 0x800000UL) - 0x800000L) * step);\n"
+         "}\n\n");
+}
+
+/**********************************************************
+ *  Function: emit_encode_field
+ *********************************************************/
+static void emit_encode_field(const char *indent, const char *field, const struct member *member,
+                              int offset, int bit)
+{
+    const char *type = member->type;
+
+    if (bit >= 0)
+    {
+        emit("%sprotocol_put_bit(buffer + %d, %d, msg->%s);\n", indent, offset, bit, field);
+    }
+    else if (is_fixed(type))
+    {
+        emit("%sprotocol_put_%s(buffer + %d, msg->%s, %s);\n", indent, type, offset, field, member->step);
+    }
+    else if (find_wire_type(type) != NULL)
+    {
+        emit("%sprotocol_put_%s(buffer + %d, msg->%s);\n", indent, type, offset, field);
+    }
+    else
+    {
+        emit("%sencode_%s(&msg->%s, buffer + %d);\n", indent, type, field, offset);
+    }
+}
+
+/**********************************************************
+ *  Function: emit_decode_field
+ *********************************************************/
+static void emit_decode_field(const char *indent, const char *field, const struct member *member,
+                              int offset, int bit)
+{
+    const char *type = member->type;
+
+    if (bit >= 0)
+    {
+        emit("%smsg->%s = protocol_get_bit(buffer + %d, %d);\n", indent, field, offset, bit);
+    }
+    else if (is_fixed(type))
+    {
+        emit("%smsg->%s = protocol_get_%s(buffer + %d, %s);\n", indent, field, type, offset, member->step);
+    }
+    else if (find_wire_type(type) != NULL)
+    {
+        emit("%smsg->%s = protocol_get_%s(buffer + %d);\n", indent, field, type, offset);
+    }
+    else
+    {
+        emit("%sdecode_%s(buffer + %d, %s_WIRE_SIZE, &msg->%s);\n", indent, type, offset,
+             upper(type), field);
+    }
+}
+
+/**********************************************************
+ *  Function: emit_wire_size
+ *********************************************************/
+// bytes on the wire of a message with a union, given its selector
+static void emit_wire_size(const struct decl *decl)
+{
+    const char *name = decl->name;
+    int header = header_size(decl);
+
+    emit("/**********************************************************\n"
+         " *  Function: wire_size_%s\n"
+         " *********************************************************/\n"
+         "static inline int wire_size_%s(int %s)\n{\n"
+         "    switch (%s)\n    {\n",
+         name, name, decl->union_on, decl->union_on);
+    for (int i = 0; i < decl->cases_count; i++)
+    {
+        emit("    case %s:\n        return (%d);\n", decl->cases[i].selector,
+             header + type_size(decl->cases[i].type));
+    }
+    emit("    default:\n        return (%d);\n    }\n}\n\n", header);
+}
+
+/**********************************************************
+ *  Function: emit_codec
+ *********************************************************/
+static void emit_codec(const struct decl *decl, int encode)
+{
+    const char *name = decl->name;
+    char field[2 * MAX_NAME + 1];
+    int field_offset[MAX_MEMBERS];
+    int field_bit[MAX_MEMBERS];
+    int offset = field_layout(decl, field_offset, field_bit);
+
+    emit("/**********************************************************\n"
+         " *  Function: %s_%s\n"
+         " *********************************************************/\n",
+         encode ? "encode" : "decode", name);
+    if (encode)
+    {
+        emit("// returns the bytes written on buffer\n");
+        emit("static inline int encode_%s(const struct %s *msg, unsigned char *buffer)\n{\n",
+             name, name);
+    }
+    else
+    {
+        emit("// returns the bytes read from buffer, or -1 if size does not match the message\n");
+        emit("static inline int decode_%s(const unsigned char *buffer, int size, struct %s *msg)\n{\n",
+             name, name);
+        if (decl->cases_count > 0)
+        {
+            // the size depends on the selector, read it first
+            for (int i = 0; i < decl->count; i++)
+            {
+                if (strcmp(decl->members[i].name, decl->union_on) == 0)
+                {
+                    emit("    if (size < %d || size != wire_size_%s(protocol_get_%s(buffer + %d)))\n",
+                         header_size(decl), name, decl->members[i].type, field_offset[i]);
+                }
+            }
+        }
+        else
+        {
+            emit("    if (size != %s_WIRE_SIZE)\n", upper(name));
+        }
+        emit("    {\n        return (-1);\n    }\n");
+        if (decl->cases_count > 0)
+        {
+            emit("    memset(msg, 0, sizeof(struct %s));\n", name);
+        }
+    }
+
+    for (int i = 0; i < decl->count; i++)
+    {
+        if (encode)
+        {
+            emit_encode_field("    ", decl->members[i].name, &decl->members[i], field_offset[i], field_bit[i]);
+        }
+        else
+        {
+            emit_decode_field("    ", decl->members[i].name, &decl->members[i], field_offset[i], field_bit[i]);
+        }
+    }
+
+    if (decl->cases_count == 0)
+    {
+        emit("    return (%s_WIRE_SIZE);\n}\n\n", upper(name));
+        return;
+    }
+
+    emit("\n    // only the member selected by %s goes on the wire\n", decl->union_on);
+    emit("    switch (msg->%s)\n    {\n", decl->union_on);
+    for (int i = 0; i < decl->cases_count; i++)
+    {
+        snprintf(field, sizeof(field), "%s.%s", decl->union_name, decl->cases[i].name);
+        emit("    case %s:\n", decl->cases[i].selector);
+        if (encode)
+        {
+            emit_encode_field("        ", field, &decl->cases[i], offset, -1);
+        }
+        else
+        {
+            emit_decode_field("        ", field, &decl->cases[i], offset, -1);
+        }
+        emit("        break;\n");
+    }
+    emit("    default:\n        break;\n    }\n");
+    emit("    return (wire_size_%s(msg->%s));\n}\n\n", name, decl->union_on);
+}
+
+/**********************************************************
+ *  Function: emit_frames
+ *********************************************************/
+static void emit_frames(void)
+{
+    emit("//---------------------------------------------------------------------------\n"
+         "//                           FRAMES\n"
+         "//---------------------------------------------------------------------------\n"
+         "// every message goes on the wire in a frame: message and CRC-16 (little\n"
+         "// endian) stuffed with COBS so no byte is 0, then the delimiter 0. A receiver\n"
+         "// that lost bytes is in sync again as soon as it sees the next delimiter\n\n");
+
+    // CRC-16/CCITT (poly 0x1021, init 0xFFFF), four bits at a time: the
+    // table of 16 entries fits the RAM of the firmware
+    emit("// CRC of every value of the 4 high bits\n"
+         "static const uint16_t protocol_crc_table[16] = {");
+    for (int n = 0; n < 16; n++)
+    {
+        unsigned int crc = (unsigned int)n << 12;
+
+        for (int bit = 0; bit < 4; bit++)
+        {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ CRC_POLY) : (crc << 1);
+        }
+        emit("%s0x%04X", (n == 0) ? "\n    " : (n % 8 == 0) ? ",\n    " : ", ", crc & 0xFFFF);
+    }
+    emit("};\n\n");
+
+    emit("/**********************************************************\n"
+         " *  Function: protocol_crc16\n"
+         " *********************************************************/\n"
+         "static inline uint16_t protocol_crc16(const unsigned char *data, int size)\n"
+         "{\n"
+         "    uint16_t crc = 0x%04X;\n"
+         "\n"
+         "    for (int i = 0; i < size; i++)\n"
+         "    {\n"
+         "        crc = (uint16_t)((crc << 4) ^ protocol_crc_table[((crc >> 12) ^ (data[i] >> 4)) & 0x0F]);\n"
+         "        crc = (uint16_t)((crc << 4) ^ protocol_crc_table[((crc >> 12) ^ data[i]) & 0x0F]);\n"
+         "    }\n"
+         "    return (crc);\n"
+         "}\n\n",
+         CRC_INIT);
+
+    emit("/**********************************************************\n"
+         " *  Function: frame_close\n"
+         " *********************************************************/\n"
+         "// frame holds the message from frame[1], returns the bytes of the frame\n"
+         "static inline int frame_close(unsigned char *frame, int size)\n"
+         "{\n"
+         "    int end = size + FRAME_CRC_SIZE + 1; // position of the delimiter\n"
+         "    int code = 0;                        // position of the last code byte\n"
+         "\n"
+         "    protocol_put_u16(frame + size + 1, protocol_crc16(frame + 1, size));\n"
+         "\n"
+         "    // every 0 becomes the distance to the next 0 (or to the delimiter)\n"
+         "    for (int i = 1; i < end; i++)\n"
+         "    {\n"
+         "        if (frame[i] == 0)\n"
+         "        {\n"
+         "            frame[code] = (unsigned char)(i - code);\n"
+         "            code = i;\n"
+         "        }\n"
+         "    }\n"
+         "    frame[code] = (unsigned char)(end - code);\n"
+         "    frame[end] = 0;\n"
+         "    return (size + FRAME_OVERHEAD);\n"
+         "}\n\n"
+         "/**********************************************************\n"
+         " *  Function: frame_open\n"
+         " *********************************************************/\n"
+         "// frame holds size bytes up to the delimiter included, leaves the message\n"
+         "// (and its CRC) in message, returns its size or -1 on a wrong frame\n"
+         "static inline int frame_open(const unsigned char *frame, int size, unsigned char *message)\n"
+         "{\n"
+         "    int code = 0; // position of the next code byte\n"
+         "\n"
+         "    if (size < FRAME_OVERHEAD + 1 || size > FRAME_MAX_SIZE || frame[size - 1] != 0)\n"
+         "    {\n"
+         "        return (-1);\n"
+         "    }\n"
+         "    size = size - 1;\n"
+         "\n"
+         "    for (int i = 0; i < size; i++)\n"
+         "    {\n"
+         "        if (i == code)\n"
+         "        {\n"
+         "            if (frame[i] == 0 || i + frame[i] > size)\n"
+         "            {\n"
+         "                return (-1);\n"
+         "            }\n"
+         "            code = i + frame[i];\n"
+         "            if (i > 0)\n"
+         "            {\n"
+         "                message[i - 1] = 0;\n"
+         "            }\n"
+         "            continue;\n"
+         "        }\n"
+         "        if (frame[i] == 0)\n"
+         "        {\n"
+         "            return (-1);\n"
+         "        }\n"
+         "        message[i - 1] = frame[i];\n"
+         "    }\n"
+         "    if (code != size)\n"
+         "    {\n"
+         "        return (-1);\n"
+         "    }\n"
+         "\n"
+         "    size = size - 1 - FRAME_CRC_SIZE;\n"
+         "    return ((protocol_crc16(message, size) == protocol_get_u16(message + size)) ? size : -1);\n"
+         "}\n\n"
+         "/**********************************************************\n"
+         " *  Function: frame_parse_byte\n"
+         " *********************************************************/\n"
+         "// feeds one received byte, returns FRAME_COMPLETE with the message of a\n"
+         "// whole frame in parser->message, FRAME_WRONG or FRAME_INCOMPLETE\n"
+         "static inline int frame_parse_byte(struct frame_parser *parser, unsigned char car)\n"
+         "{\n"
+         "    // bytes past FRAME_MAX_SIZE are dropped, so a frame too long never\n"
+         "    // ends with its delimiter and is taken as wrong\n"
+         "    if (parser->count < FRAME_MAX_SIZE)\n"
+         "    {\n"
+         "        parser->frame[parser->count++] = car;\n"
+         "    }\n"
+         "    if (car != 0)\n"
+         "    {\n"
+         "        return (FRAME_INCOMPLETE);\n"
+         "    }\n"
+         "\n"
+         "    // a delimiter always ends the frame, right or wrong\n"
+         "    parser->length = parser->count;\n"
+         "    parser->count = 0;\n"
+         "    if (parser->length == 1)\n"
+         "    {\n"
+         "        return (FRAME_INCOMPLETE);\n"
+         "    }\n"
+         "    parser->size = frame_open(parser->frame, parser->length, parser->message);\n"
+         "    return ((parser->size < 0) ? FRAME_WRONG : FRAME_COMPLETE);\n"
+         "}\n\n");
+}
+
+/**********************************************************
+ *  Function: generate
+ *********************************************************/
+static void generate(const char *schema)
+{
+    const char *base = strrchr(schema, '/');
+    int max_size = 0;
+
+    base = (base == NULL) ? schema : base + 1;
+
+    emit("/**********************************************************\n"
+         " *  Generated by protogen from %s, do not edit:\n"
+         " *  change the schema and run protogen again\n"
+         " *********************************************************/\n\n",
+         base);
+    emit("#ifndef PROTOCOL_H\n#define PROTOCOL_H\n\n");
+
+    emit("/**********************************************************\n"
+         " *  INCLUDES\n"
+         " *********************************************************/\n\n"
+         "#include <stdint.h>\n"
+         "#include <string.h>\n\n");
+
+    emit("/**********************************************************\n"
+         " *  CONSTANTS\n"
+         " *********************************************************/\n\n"
+         "// largest size of each message on the wire (little endian, no padding)\n");
+    for (int d = 0; d < decls_count; d++)
+    {
+        if (decls[d].kind == DECL_STRUCT)
+        {
+            emit("#define %s_WIRE_SIZE %d\n", upper(decls[d].name), wire_size(&decls[d]));
+            max_size = (wire_size(&decls[d]) > max_size) ? wire_size(&decls[d]) : max_size;
+        }
+    }
+    emit("#define PROTOCOL_MAX_WIRE_SIZE %d\n\n", max_size);
+    emit("// frame: code byte, message, CRC and delimiter\n"
+         "#define FRAME_CRC_SIZE 2\n"
+         "#define FRAME_OVERHEAD (FRAME_CRC_SIZE + 2)\n"
+         "#define FRAME_MAX_SIZE (PROTOCOL_MAX_WIRE_SIZE + FRAME_OVERHEAD)\n\n"
+         "// results of frame_parse_byte\n"
+         "#define FRAME_INCOMPLETE 0\n"
+         "#define FRAME_COMPLETE 1\n"
+         "#define FRAME_WRONG -1\n\n");
+
+    emit("/**********************************************************\n"
+         " *  TYPES\n"
+         " *********************************************************/\n\n");
+    emit_types();
+    emit("// receiver of frames byte by byte\n"
+         "struct frame_parser\n"
+         "{\n"
+         "    unsigned char frame[FRAME_MAX_SIZE];   // frame being received\n"
+         "    unsigned char message[FRAME_MAX_SIZE]; // message (and CRC) of the last frame\n"
+         "    int count;                             // bytes of the frame received\n"
+         "    int length;                            // bytes of the last frame\n"
+         "    int size;                              // size of the last message\n"
+         "};\n\n");
+
+    emit("/**********************************************************\n"
+         " *  COMPILE TIME CHECKS\n"
+         " *********************************************************/\n\n"
+         "#if defined(__cplusplus)\n"
+         "#define PROTOCOL_ASSERT(cond, msg) static_assert(cond, msg)\n"
+         "#else\n"
+         "#define PROTOCOL_ASSERT(cond, msg) _Static_assert(cond, msg)\n"
+         "#endif\n\n"
+         "PROTOCOL_ASSERT(sizeof(float) == 4, \"f32 fields need 32 bit floats\");\n"
+         "PROTOCOL_ASSERT(PROTOCOL_MAX_WIRE_SIZE <= 252, \"frames must fit a single COBS block\");\n");
+    for (int d = 0; d < decls_count; d++)
+    {
+        const struct decl *decl = &decls[d];
+
+        if (decl->kind == DECL_ENUM)
+        {
+            for (int i = 0; i < decl->count; i++)
+            {
+                if (decl->members[i].value < 0 || decl->members[i].value > 255)
+                {
+                    fprintf(stderr, "protogen: %s does not fit in a u8\n", decl->members[i].name);
+                    exit(1);
+                }
+            }
+            continue;
+        }
+        // the wire format never carries more than the struct in memory
+        emit("PROTOCOL_ASSERT(%s_WIRE_SIZE <= sizeof(struct %s), \"%s is padded on the wire\");\n",
+             upper(decl->name), decl->name, decl->name);
+    }
+    emit("\n");
+
+    emit("//---------------------------------------------------------------------------\n"
+         "//                           CODECS\n"
+         "//---------------------------------------------------------------------------\n\n");
+    emit_helpers();
+    for (int d = 0; d < decls_count; d++)
+    {
+        if (decls[d].kind == DECL_STRUCT)
+        {
+            if (decls[d].cases_count > 0)
+            {
+                emit_wire_size(&decls[d]);
+            }
+            emit_codec(&decls[d], 1);
+            emit_codec(&decls[d], 0);
+        }
+    }
+    emit_frames();
+
+    emit("#endif\n");
+}
+
+/**********************************************************
+ *  Function: write_file
+ *********************************************************/
+static int write_file(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL || fwrite(output, 1, output_size, file) != (size_t)output_size)
+    {
+        fprintf(stderr, "protogen: cannot write %s\n", path);
+        if (file != NULL)
+        {
+            fclose(file);
+        }
+        return (-1);
+    }
+    fclose(file);
+    return (0);
+}
+
+/**********************************************************
+ *  Function: check_file
+ *********************************************************/
+static int check_file(const char *path)
+{
+    static char current[MAX_OUTPUT];
+    FILE *file = fopen(path, "rb");
+    size_t size = 0;
+
+    if (file != NULL)
+    {
+        size = fread(current, 1, sizeof(current), file);
+        fclose(file);
+    }
+    if (file == NULL || size != (size_t)output_size || memcmp(current, output, size) != 0)
+    {
+        fprintf(stderr, "protogen: %s is out of date\n", path);
+        return (-1);
+    }
+    return (0);
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+// usage: protogen [-c] schema header [header ...]
+// writes the headers, or with -c checks they match the schema
+int main(int argc, char **argv)
+{
+    int check = 0;
+    int first = 1;
+    int ret = 0;
+    FILE *schema;
+
+    if (argc > 1 && strcmp(argv[1], "-c") == 0)
+    {
+        check = 1;
+        first = 2;
+    }
+    if (argc < first + 2)
+    {
+        fprintf(stderr, "usage: %s [-c] schema header [header ...]\n", argv[0]);
+        return (1);
+    }
+
+    schema = fopen(argv[first], "r");
+    if (schema == NULL)
+    {
+        fprintf(stderr, "protogen: cannot read %s\n", argv[first]);
+        return (1);
+    }
+    parse_schema(schema);
+    fclose(schema);
+    generate(argv[first]);
+
+    for (int i = first + 1; i < argc; i++)
+    {
+        if ((check ? check_file(argv[i]) : write_file(argv[i])) < 0)
+        {
+            ret = 1;
+        }
+    }
+    return (ret);
+}
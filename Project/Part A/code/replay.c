@@ -0,0 +1,119 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "capture.h"
+#include "clock.h"
+#include "link_io.h"
+#include "replay.h"
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: replay_default_config
+ *********************************************************/
+void replay_default_config(struct replay_config *config)
+{
+    config->target = REPLAY_SLAVE;
+    config->link = 0;
+    config->speed = 0.0;
+    config->timeout = 1000 * NS_PER_MS;
+}
+
+/**********************************************************
+ *  Function: replay_run
+ *********************************************************/
+int replay_run(const struct replay_config *config, const char *path, int fd,
+               struct replay_report *report)
+{
+    struct capture_reader reader;
+    struct capture_record record;
+    unsigned char buffer[CAPTURE_MAX_FRAME];
+    int64_t first = -1;
+    int64_t start;
+    int written;
+    int ret;
+
+    if (config->speed < 0.0 || config->timeout <= 0 ||
+        capture_reader_open(&reader, path) < 0)
+    {
+        return (-1);
+    }
+    memset(report, 0, sizeof(struct replay_report));
+
+    // frames sent by the side we play are written, the others are expected
+    written = (config->target == REPLAY_SLAVE) ? CAPTURE_TO_SLAVE : CAPTURE_TO_MASTER;
+
+    start = clock_now_ns();
+    while ((ret = capture_reader_next(&reader, &record)) > 0)
+    {
+        if (record.link != config->link)
+        {
+            continue;
+        }
+        if (first < 0)
+        {
+            first = record.time;
+        }
+
+        if (record.direction == written)
+        {
+            // keep the gaps of the capture, scaled by the speed
+            if (config->speed > 0.0)
+            {
+                clock_sleep_until(start + (int64_t)((double)(record.time - first) / config->speed));
+            }
+            if (link_write_all(fd, record.data, record.size) < 0)
+            {
+                ret = -1;
+                break;
+            }
+            report->sent++;
+        }
+        else
+        {
+            ret = link_read_all(fd, buffer, record.size, clock_now_ns() + config->timeout);
+            if (ret == LINK_READ_CLOSED)
+            {
+                ret = -1;
+                break;
+            }
+            if (ret == LINK_READ_TIMEOUT)
+            {
+                report->timeouts++;
+                link_drain(fd);
+                continue;
+            }
+            report->received++;
+            if (memcmp(buffer, record.data, record.size) != 0)
+            {
+                report->mismatches++;
+            }
+        }
+    }
+    capture_reader_close(&reader);
+
+    report->elapsed = clock_now_ns() - start;
+    if (report->elapsed > 0)
+    {
+        report->throughput = (double)(report->sent + report->received) * (double)NS_PER_S /
+                             (double)report->elapsed;
+    }
+
+    return ((ret < 0) ? -1 : 0);
+}
+
+/**********************************************************
+ *  Function: replay_print_report
+ *********************************************************/
+void replay_print_report(FILE *out, const struct replay_report *report)
+{
+    fprintf(out, "replay elapsed_s=%.3f sent=%lu received=%lu mismatches=%lu timeouts=%lu throughput=%.1f\n",
+            (double)report->elapsed / (double)NS_PER_S, report->sent, report->received,
+            report->mismatches, report->timeouts, report->throughput);
+}
@@ -0,0 +1,57 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// side of the protocol the capture is played against
+enum replay_target
+{
+    REPLAY_SLAVE = 0, // send the captured commands, check the answers
+    REPLAY_MASTER = 1 // check the commands, send the captured answers
+};
+
+// configuration of a replay
+struct replay_config
+{
+    enum replay_target target; // slave or master under test
+    int link;                  // link of the capture to play
+    double speed;              // 0 = as fast as possible, 1 = original timing, N = N times faster
+    int64_t timeout;           // time to wait for each frame (ns)
+};
+
+// results of a replay
+struct replay_report
+{
+    unsigned long sent;       // frames written
+    unsigned long received;   // frames read
+    unsigned long mismatches; // frames read different from the capture
+    unsigned long timeouts;   // frames not read in time
+    int64_t elapsed;          // time to play the capture (ns)
+    double throughput;        // frames/sec
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: replay_default_config
+ *********************************************************/
+void replay_default_config(struct replay_config *config);
+
+/**********************************************************
+ *  Function: replay_run
+ *********************************************************/
+int replay_run(const struct replay_config *config, const char *path, int fd,
+               struct replay_report *report);
+
+/**********************************************************
+ *  Function: replay_print_report
+ *********************************************************/
+void replay_print_report(FILE *out, const struct replay_report *report);
@@ -0,0 +1,137 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "link_io.h"
+#include "loadgen.h"
+#include "replay.h"
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: usage
+ *********************************************************/
+static void usage(const char *name)
+{
+    printf("usage: %s [options] capture [device]\n", name);
+    printf("  -p slave|master side under test (slave)\n");
+    printf("  -l link         link of the capture to play (0)\n");
+    printf("  -s speed        0 = as fast as possible, 1 = original timing (0)\n");
+    printf("  -t ms           time to wait for each frame (1000)\n");
+    printf("  -b baud         speed of the serial device (9600)\n");
+    printf("with no device the capture is played against an emulated slave\n");
+}
+
+/**********************************************************
+ *  Function: slave_thread
+ *********************************************************/
+static void *slave_thread(void *arg)
+{
+    int fd = *(int *)arg;
+
+    loadgen_slave(fd);
+    close(fd);
+    return (NULL);
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+int main(int argc, char **argv)
+{
+    struct replay_config config;
+    struct replay_report report;
+    pthread_t slave;
+    int slave_fd = -1;
+    long baud = 9600;
+    int fd;
+    int option;
+    int ret;
+
+    replay_default_config(&config);
+    while ((option = getopt(argc, argv, "p:l:s:t:b:h")) != -1)
+    {
+        switch (option)
+        {
+        case 'p':
+            config.target = (strcmp(optarg, "master") == 0) ? REPLAY_MASTER : REPLAY_SLAVE;
+            break;
+        case 'l':
+            config.link = atoi(optarg);
+            break;
+        case 's':
+            config.speed = atof(optarg);
+            break;
+        case 't':
+            config.timeout = (int64_t)(atof(optarg) * (double)NS_PER_MS);
+            break;
+        case 'b':
+            baud = atol(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return (-1);
+        }
+    }
+    if (optind >= argc)
+    {
+        usage(argv[0]);
+        return (-1);
+    }
+
+    // a closed link must not kill the process
+    signal(SIGPIPE, SIG_IGN);
+
+    if (optind + 1 < argc)
+    {
+        // real master or slave on a serial device
+        fd = link_open_serial(argv[optind + 1], baud);
+        if (fd < 0)
+        {
+            printf("open: error opening serial %s\n", argv[optind + 1]);
+            return (-1);
+        }
+    }
+    else
+    {
+        // emulated slave connected through a socket pair
+        int pair[2];
+
+        if (config.target != REPLAY_SLAVE || socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+        {
+            printf("ERROR: a master can only be replayed on a device\n");
+            return (-1);
+        }
+        fd = pair[0];
+        slave_fd = pair[1];
+        pthread_create(&slave, NULL, slave_thread, &slave_fd);
+    }
+
+    ret = replay_run(&config, argv[optind], fd, &report);
+    if (ret < 0)
+    {
+        printf("ERROR: cannot replay capture %s\n", argv[optind]);
+    }
+    else
+    {
+        replay_print_report(stdout, &report);
+    }
+
+    close(fd);
+    if (slave_fd >= 0)
+    {
+        pthread_join(slave, NULL);
+    }
+    return (ret);
+}
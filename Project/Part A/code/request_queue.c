@@ -0,0 +1,121 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <string.h>
+
+#include "request_queue.h"
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: request_before
+ *********************************************************/
+// earliest deadline first, the task of higher priority on a tie
+static int request_before(const struct link_request *a, const struct link_request *b)
+{
+    if (a->deadline != b->deadline)
+    {
+        return (a->deadline < b->deadline);
+    }
+    return (a->task < b->task);
+}
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: request_queue_init
+ *********************************************************/
+void request_queue_init(struct request_queue *queue)
+{
+    memset(queue, 0, sizeof(struct request_queue));
+}
+
+/**********************************************************
+ *  Function: request_queue_push
+ *********************************************************/
+// from any thread: a compare and swap on the top of the stack, retried if
+// another thread pushed first
+void request_queue_push(struct request_queue *queue, struct link_request *request)
+{
+    struct link_request *top = __atomic_load_n(&queue->pushed, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&request->done, 0, __ATOMIC_RELAXED);
+    do
+    {
+        request->next = top;
+    } while (!__atomic_compare_exchange_n(&queue->pushed, &top, request, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/**********************************************************
+ *  Function: request_queue_collect
+ *********************************************************/
+// from the owner only: takes every request pushed and puts it in order
+// among the ones taken before; returns the requests taken. With no room
+// left the rest is pushed again for later
+int request_queue_collect(struct request_queue *queue)
+{
+    struct link_request *request = __atomic_exchange_n(&queue->pushed, NULL, __ATOMIC_ACQUIRE);
+
+    while (request != NULL)
+    {
+        struct link_request *next = request->next;
+        int i = queue->count;
+
+        if (queue->count == REQUEST_QUEUE_SIZE)
+        {
+            request_queue_push(queue, request);
+            request = next;
+            continue;
+        }
+        while (i > 0 && request_before(request, queue->pending[i - 1]))
+        {
+            queue->pending[i] = queue->pending[i - 1];
+            i--;
+        }
+        queue->pending[i] = request;
+        queue->count++;
+        request = next;
+    }
+    return (queue->count);
+}
+
+/**********************************************************
+ *  Function: request_queue_pop
+ *********************************************************/
+// from the owner only: the request taken with the earliest deadline, NULL
+// if none
+struct link_request *request_queue_pop(struct request_queue *queue)
+{
+    struct link_request *first;
+
+    if (queue->count == 0)
+    {
+        return (NULL);
+    }
+    first = queue->pending[0];
+    queue->count--;
+    memmove(&queue->pending[0], &queue->pending[1], queue->count * sizeof(struct link_request *));
+    return (first);
+}
+
+/**********************************************************
+ *  Function: request_complete
+ *********************************************************/
+// the task sees the results of the exchange once it sees the request done
+void request_complete(struct link_request *request)
+{
+    __atomic_store_n(&request->done, 1, __ATOMIC_RELEASE);
+}
+
+/**********************************************************
+ *  Function: request_done
+ *********************************************************/
+int request_done(const struct link_request *request)
+{
+    return (__atomic_load_n(&request->done, __ATOMIC_ACQUIRE));
+}
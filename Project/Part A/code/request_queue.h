@@ -0,0 +1,77 @@
+#ifndef REQUEST_QUEUE_H
+#define REQUEST_QUEUE_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdint.h>
+
+#include "protocol.h"
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+// requests the owner of the link keeps in order
+#define REQUEST_QUEUE_SIZE 16
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// command of a task for the owner of the link, the task keeps it until
+// it is done
+struct link_request
+{
+    struct link_request *next; // next request pushed
+    int task;                  // task that asked, by TASK_X (lower first on a tie)
+    enum command cmd;          // command to exchange
+    int64_t deadline;          // time the task needs it done by (ns)
+    int done;                  // boolean set by the owner once exchanged
+};
+
+// requests pushed by any thread without locks, taken by the owner of the
+// link only in order of deadline
+struct request_queue
+{
+    struct link_request *pushed;                      // requests pushed, last first
+    struct link_request *pending[REQUEST_QUEUE_SIZE]; // requests taken, earliest first
+    int count;                                        // requests taken
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: request_queue_init
+ *********************************************************/
+void request_queue_init(struct request_queue *queue);
+
+/**********************************************************
+ *  Function: request_queue_push
+ *********************************************************/
+void request_queue_push(struct request_queue *queue, struct link_request *request);
+
+/**********************************************************
+ *  Function: request_queue_collect
+ *********************************************************/
+int request_queue_collect(struct request_queue *queue);
+
+/**********************************************************
+ *  Function: request_queue_pop
+ *********************************************************/
+struct link_request *request_queue_pop(struct request_queue *queue);
+
+/**********************************************************
+ *  Function: request_complete
+ *********************************************************/
+void request_complete(struct link_request *request);
+
+/**********************************************************
+ *  Function: request_done
+ *********************************************************/
+int request_done(const struct link_request *request);
+
+#endif
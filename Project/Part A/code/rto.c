@@ -0,0 +1,71 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include "rto.h"
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: rto_bound
+ *********************************************************/
+static int64_t rto_bound(int64_t rto)
+{
+    if (rto < RTO_MIN)
+    {
+        return (RTO_MIN);
+    }
+    if (rto > RTO_MAX)
+    {
+        return (RTO_MAX);
+    }
+    return (rto);
+}
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: rto_init
+ *********************************************************/
+void rto_init(struct rto_estimator *rto)
+{
+    rto->srtt = 0;
+    rto->rttvar = 0;
+    rto->rto = RTO_INITIAL;
+}
+
+/**********************************************************
+ *  Function: rto_sample
+ *********************************************************/
+// rtt of an answer to a request sent once only: the answer to a request
+// sent again could belong to any of its copies
+void rto_sample(struct rto_estimator *rto, int64_t rtt)
+{
+    if (rto->srtt == 0)
+    {
+        rto->srtt = rtt;
+        rto->rttvar = rtt / 2;
+    }
+    else
+    {
+        int64_t error = rtt - rto->srtt;
+
+        // gains of 1/8 for the mean and 1/4 for the deviation
+        rto->rttvar += ((error < 0 ? -error : error) - rto->rttvar) / 4;
+        rto->srtt += error / 8;
+    }
+    rto->rto = rto_bound(rto->srtt + 4 * rto->rttvar);
+}
+
+/**********************************************************
+ *  Function: rto_backoff
+ *********************************************************/
+// an answer did not arrive in time: wait twice as long until a new sample
+void rto_backoff(struct rto_estimator *rto)
+{
+    rto->rto = rto_bound(2 * rto->rto);
+}
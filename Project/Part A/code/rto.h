@@ -0,0 +1,52 @@
+#ifndef RTO_H
+#define RTO_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdint.h>
+
+#include "clock.h"
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define RTO_INITIAL (400 * NS_PER_MS) // wait before the first round trip is measured
+#define RTO_MIN (20 * NS_PER_MS)
+#define RTO_MAX (2 * NS_PER_S)
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// time to wait for an answer, adapted to the round trip times measured
+// (smoothed RTT plus four times its mean deviation, as TCP)
+struct rto_estimator
+{
+    int64_t srtt;   // smoothed round trip time (ns, 0 until the first sample)
+    int64_t rttvar; // mean deviation of the round trip time (ns)
+    int64_t rto;    // time to wait for an answer (ns)
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: rto_init
+ *********************************************************/
+void rto_init(struct rto_estimator *rto);
+
+/**********************************************************
+ *  Function: rto_sample
+ *********************************************************/
+void rto_sample(struct rto_estimator *rto, int64_t rtt);
+
+/**********************************************************
+ *  Function: rto_backoff
+ *********************************************************/
+void rto_backoff(struct rto_estimator *rto);
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef SATELLITE_HPP
+#define SATELLITE_HPP
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <coroutine>
+#include <exception>
+
+extern "C"
+{
+#include "async_link.h"
+}
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// end of a command: ASYNC_* and the answer (valid with ASYNC_DONE)
+struct command_result
+{
+    int result;
+    struct res_msg res;
+};
+
+// coroutine started at once and left to the event loop at every
+// co_await, nobody waits for its end
+struct sat_task
+{
+    struct promise_type
+    {
+        sat_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// satellite on a link driven by an event loop:
+//     struct command_result r = co_await sat.command(READ_TEMP_CMD);
+// suspends the coroutine until the answer, the thread goes on with the
+// event loop and the other links meanwhile
+class satellite
+{
+public:
+    explicit satellite(struct async_link *link) : link(link) {}
+
+    // state of the satellite updated by the answers
+    const struct ctrl_ctx &state() const { return link->ctx; }
+    struct ctrl_ctx &state() { return link->ctx; }
+
+    class command_awaiter
+    {
+    public:
+        command_awaiter(struct async_link *link, enum command cmd) : link(link), cmd(cmd) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        // without room for the request the coroutine goes on at once
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            waiter = handle;
+            if (execute_cmd_async(link, cmd, resume, this) < 0)
+            {
+                done.result = ASYNC_CLOSED;
+                return (false);
+            }
+            return (true);
+        }
+
+        struct command_result await_resume() const noexcept { return done; }
+
+    private:
+        static void resume(void *arg, int result, const struct res_msg *res)
+        {
+            command_awaiter *awaiter = static_cast<command_awaiter *>(arg);
+
+            awaiter->done.result = result;
+            if (res != NULL)
+            {
+                awaiter->done.res = *res;
+            }
+            awaiter->waiter.resume();
+        }
+
+        struct async_link *link;
+        enum command cmd;
+        std::coroutine_handle<> waiter;
+        struct command_result done = {ASYNC_CLOSED, {}};
+    };
+
+    command_awaiter command(enum command cmd) { return command_awaiter(link, cmd); }
+
+private:
+    struct async_link *link;
+};
+
+#endif
@@ -0,0 +1,528 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define MAX_TASKS 8 // a frame releases them in the bits of one byte
+#define MAX_FRAMES 1000
+#define MAX_NAME 32
+#define MAX_COMMENT 96
+#define MAX_LINE 256
+#define MAX_OUTPUT 65536
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// periodic task of the schedule
+struct task
+{
+    char name[MAX_NAME];       // name of the task
+    char comment[MAX_COMMENT]; // comment of the declaration
+    long period;               // time between releases, also the deadline (ms)
+    long execution_time;       // worst case execution time (ms)
+    int link;                  // boolean: the task sends a request to the owner of the link
+    long blocking;             // longest exchange in progress on the link before it (ms)
+    long response_time;        // worst case response time (ms)
+};
+
+/**********************************************************
+ *  PRIVATE STATUS (STATIC GLOBAL VARIABLES)
+ **********************************************************/
+
+// tasks in rate monotonic order once parsed
+static struct task tasks[MAX_TASKS];
+static int tasks_count = 0;
+
+// requests the owner of the link sends in one exchange
+static long link_window = 1;
+
+// cyclic schedule (ms)
+static long hyperperiod = 0;
+static long minor_frame = 0;
+
+// generated header
+static char output[MAX_OUTPUT];
+static int output_size = 0;
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: fail
+ *********************************************************/
+static void fail(int line, const char *message)
+{
+    fprintf(stderr, "schedgen: line %d: %s\n", line, message);
+    exit(1);
+}
+
+/**********************************************************
+ *  Function: emit
+ *********************************************************/
+static void emit(const char *format, ...)
+{
+    va_list args;
+    int ret;
+
+    va_start(args, format);
+    ret = vsnprintf(output + output_size, MAX_OUTPUT - output_size, format, args);
+    va_end(args);
+    if (ret < 0 || ret >= MAX_OUTPUT - output_size)
+    {
+        fprintf(stderr, "schedgen: generated header too long\n");
+        exit(1);
+    }
+    output_size += ret;
+}
+
+/**********************************************************
+ *  Function: upper
+ *********************************************************/
+static const char *upper(const char *text)
+{
+    static char name[MAX_NAME];
+    int i;
+
+    for (i = 0; text[i] != '\0' && i < MAX_NAME - 1; i++)
+    {
+        name[i] = (char)toupper((unsigned char)text[i]);
+    }
+    name[i] = '\0';
+    return (name);
+}
+
+/**********************************************************
+ *  Function: split_comment
+ *********************************************************/
+// cuts the line at '#' and keeps the text after it as comment
+static void split_comment(char *line, char *comment)
+{
+    char *mark = strchr(line, '#');
+    int size;
+
+    comment[0] = '\0';
+    if (mark == NULL)
+    {
+        return;
+    }
+    *mark = '\0';
+    mark++;
+    while (isspace((unsigned char)*mark))
+    {
+        mark++;
+    }
+    snprintf(comment, MAX_COMMENT, "%s", mark);
+    size = (int)strlen(comment);
+    while (size > 0 && isspace((unsigned char)comment[size - 1]))
+    {
+        comment[--size] = '\0';
+    }
+}
+
+/**********************************************************
+ *  Function: gcd
+ *********************************************************/
+static long gcd(long a, long b)
+{
+    while (b != 0)
+    {
+        long rest = a % b;
+
+        a = b;
+        b = rest;
+    }
+    return (a);
+}
+
+/**********************************************************
+ *  Function: parse_schedule
+ *********************************************************/
+static void parse_schedule(FILE *file)
+{
+    char line[MAX_LINE];
+    int number = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char comment[MAX_COMMENT];
+        char word[5][MAX_NAME];
+        struct task *task;
+        int words;
+
+        number++;
+        split_comment(line, comment);
+        words = sscanf(line, "%31s %31s %31s %31s %31s", word[0], word[1], word[2], word[3], word[4]);
+        if (words <= 0)
+        {
+            continue;
+        }
+        if (strcmp(word[0], "window") == 0)
+        {
+            link_window = (words == 2) ? strtol(word[1], NULL, 10) : 0;
+            if (link_window <= 0)
+            {
+                fail(number, "expected \"window REQUESTS\", at least one");
+            }
+            continue;
+        }
+        if (strcmp(word[0], "task") != 0 || words < 4 || (words == 5 && strcmp(word[4], "link") != 0))
+        {
+            fail(number, "expected \"task NAME PERIOD EXECUTION_TIME [link]\"");
+        }
+        if (tasks_count == MAX_TASKS)
+        {
+            fail(number, "too many tasks");
+        }
+
+        task = &tasks[tasks_count++];
+        memset(task, 0, sizeof(struct task));
+        snprintf(task->name, MAX_NAME, "%s", word[1]);
+        snprintf(task->comment, MAX_COMMENT, "%s", comment);
+        task->period = strtol(word[2], NULL, 10);
+        task->execution_time = strtol(word[3], NULL, 10);
+        task->link = (words == 5);
+        if (task->period <= 0 || task->execution_time <= 0)
+        {
+            fail(number, "periods and execution times are positive ms");
+        }
+        if (task->execution_time > task->period)
+        {
+            fail(number, "execution time longer than the period");
+        }
+        for (int i = 0; i < tasks_count - 1; i++)
+        {
+            if (strcmp(tasks[i].name, task->name) == 0)
+            {
+                fail(number, "task declared twice");
+            }
+        }
+    }
+    if (tasks_count == 0)
+    {
+        fail(number, "no tasks");
+    }
+}
+
+/**********************************************************
+ *  Function: order_tasks
+ *********************************************************/
+// rate monotonic priorities: the shortest period first, equal periods in
+// the order of the file
+static void order_tasks(void)
+{
+    for (int i = 1; i < tasks_count; i++)
+    {
+        struct task task = tasks[i];
+        int j = i;
+
+        while (j > 0 && tasks[j - 1].period > task.period)
+        {
+            tasks[j] = tasks[j - 1];
+            j--;
+        }
+        tasks[j] = task;
+    }
+}
+
+/**********************************************************
+ *  Function: build_frames
+ *********************************************************/
+// the hyperperiod repeats the schedule, the minor frame is the longest
+// time every release falls on
+static void build_frames(void)
+{
+    hyperperiod = tasks[0].period;
+    minor_frame = tasks[0].period;
+    for (int i = 1; i < tasks_count; i++)
+    {
+        minor_frame = gcd(minor_frame, tasks[i].period);
+        hyperperiod = hyperperiod / gcd(hyperperiod, tasks[i].period) * tasks[i].period;
+        if (hyperperiod / minor_frame > MAX_FRAMES)
+        {
+            fprintf(stderr, "schedgen: more than %d minor frames in the hyperperiod\n", MAX_FRAMES);
+            exit(1);
+        }
+    }
+}
+
+/**********************************************************
+ *  Function: analyse_response
+ *********************************************************/
+// response time analysis of fixed priorities on the processor and of a
+// single owner of the link: a task waits for every release of the tasks
+// above it that use the processor (a task of the link waits for its
+// exchange, the processor is free meanwhile); its request waits for the
+// exchange in progress, which is not cut, and then for the requests with
+// earlier deadlines, link_window per exchange: one of every task of the
+// link with a period as long or longer (a request each at most), and one
+// of a shorter period per release; an exchange takes the longest
+// execution time of a task of the link. The schedule fails if a task can
+// end after its next release
+static void analyse_response(void)
+{
+    long longest = 0;
+    int feasible = 1;
+
+    for (int i = 0; i < tasks_count; i++)
+    {
+        if (tasks[i].link && tasks[i].execution_time > longest)
+        {
+            longest = tasks[i].execution_time;
+        }
+    }
+
+    for (int i = 0; i < tasks_count; i++)
+    {
+        struct task *task = &tasks[i];
+        long response = 0;
+        long next;
+
+        task->blocking = 0;
+        for (int j = 0; j < tasks_count && task->link; j++)
+        {
+            if (j != i && tasks[j].link && tasks[j].execution_time > task->blocking)
+            {
+                task->blocking = tasks[j].execution_time;
+            }
+        }
+
+        next = task->execution_time + task->blocking;
+        while (next != response && next <= task->period)
+        {
+            long ahead = 0;
+
+            response = next;
+            next = task->execution_time + task->blocking;
+            for (int j = 0; j < tasks_count; j++)
+            {
+                long releases = (response + tasks[j].period - 1) / tasks[j].period;
+
+                if (j < i && !tasks[j].link)
+                {
+                    next += releases * tasks[j].execution_time;
+                }
+                if (task->link && j != i && tasks[j].link)
+                {
+                    ahead += (tasks[j].period < task->period) ? releases : 1;
+                }
+            }
+            // the requests that do not fit in the exchange of its own
+            next += ((ahead + link_window) / link_window - 1) * longest;
+        }
+        task->response_time = next;
+
+        if (task->response_time > task->period)
+        {
+            fprintf(stderr, "schedgen: task %s misses its deadline: response time over %ld ms, period %ld ms\n",
+                    task->name, task->response_time, task->period);
+            feasible = 0;
+        }
+    }
+    if (!feasible)
+    {
+        exit(1);
+    }
+}
+
+/**********************************************************
+ *  Function: generate
+ *********************************************************/
+static void generate(const char *schedule)
+{
+    const char *base = strrchr(schedule, '/');
+    long utilization = 0;
+
+    base = (base == NULL) ? schedule : base + 1;
+    for (int i = 0; i < tasks_count; i++)
+    {
+        utilization += tasks[i].execution_time * (hyperperiod / tasks[i].period);
+    }
+
+    emit("/**********************************************************\n"
+         " *  Generated by schedgen from %s, do not edit:\n"
+         " *  change the schedule and run schedgen again\n"
+         " *********************************************************/\n\n",
+         base);
+    emit("#ifndef SCHEDULE_H\n#define SCHEDULE_H\n\n");
+
+    emit("/**********************************************************\n"
+         " *  CONSTANTS\n"
+         " *********************************************************/\n\n"
+         "// tasks in rate monotonic order, the highest priority first\n"
+         "#define TASKS %d\n",
+         tasks_count);
+    for (int i = 0; i < tasks_count; i++)
+    {
+        emit("#define TASK_%s %d", upper(tasks[i].name), i);
+        emit((tasks[i].comment[0] != '\0') ? " // %s\n" : "%s\n", tasks[i].comment);
+    }
+    emit("\n// period, worst case execution time and worst case response time\n"
+         "// of every task (ms)\n");
+    for (int i = 0; i < tasks_count; i++)
+    {
+        emit("#define TASK_%s_PERIOD %ld\n", upper(tasks[i].name), tasks[i].period);
+        emit("#define TASK_%s_EXECUTION_TIME %ld\n", upper(tasks[i].name), tasks[i].execution_time);
+        emit("#define TASK_%s_RESPONSE_TIME %ld\n", upper(tasks[i].name), tasks[i].response_time);
+    }
+    emit("\n// cyclic schedule (ms): the releases of every minor frame repeat each\n"
+         "// hyperperiod, the tasks use %ld.%ld%% of the processor\n"
+         "#define SCHEDULE_HYPERPERIOD %ld\n"
+         "#define SCHEDULE_MINOR_FRAME %ld\n"
+         "#define SCHEDULE_FRAMES %ld\n\n"
+         "// requests the owner of the link sends in one exchange, as analysed\n"
+         "#define SCHEDULE_LINK_WINDOW %ld\n\n",
+         utilization * 100 / hyperperiod, (utilization * 1000 / hyperperiod) % 10,
+         hyperperiod, minor_frame, hyperperiod / minor_frame, link_window);
+
+    emit("/**********************************************************\n"
+         " *  COMPILE TIME CHECKS\n"
+         " *********************************************************/\n\n"
+         "#if defined(__cplusplus)\n"
+         "#define SCHEDULE_ASSERT(cond, msg) static_assert(cond, msg)\n"
+         "#else\n"
+         "#define SCHEDULE_ASSERT(cond, msg) _Static_assert(cond, msg)\n"
+         "#endif\n\n"
+         "SCHEDULE_ASSERT(SCHEDULE_FRAMES * SCHEDULE_MINOR_FRAME == SCHEDULE_HYPERPERIOD, "
+         "\"the frames fill the hyperperiod\");\n");
+    for (int i = 0; i < tasks_count; i++)
+    {
+        const char *name = tasks[i].name;
+
+        emit("SCHEDULE_ASSERT(TASK_%s_PERIOD %% SCHEDULE_MINOR_FRAME == 0, \"task %s is released between frames\");\n",
+             upper(name), name);
+        emit("SCHEDULE_ASSERT(TASK_%s_RESPONSE_TIME <= TASK_%s_PERIOD, \"task %s misses its deadline\");\n",
+             upper(name), upper(name), name);
+    }
+    emit("\n");
+
+    emit("/**********************************************************\n"
+         " *  TABLES\n"
+         " *********************************************************/\n\n"
+         "// tasks released at the start of every minor frame (bit 1 << TASK_X)\n"
+         "static const unsigned char schedule_releases[SCHEDULE_FRAMES] = {\n");
+    for (long frame = 0; frame < hyperperiod / minor_frame; frame++)
+    {
+        long time = frame * minor_frame;
+        unsigned int releases = 0;
+
+        for (int i = 0; i < tasks_count; i++)
+        {
+            if (time % tasks[i].period == 0)
+            {
+                releases |= 1u << i;
+            }
+        }
+        emit("    0x%02X, // %ld ms%s", releases, time, (releases != 0) ? ":" : "");
+        for (int i = 0; i < tasks_count; i++)
+        {
+            if (releases & (1u << i))
+            {
+                emit(" %s", tasks[i].name);
+            }
+        }
+        emit("\n");
+    }
+    emit("};\n\n");
+
+    emit("#endif\n");
+}
+
+/**********************************************************
+ *  Function: write_file
+ *********************************************************/
+static int write_file(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL || fwrite(output, 1, output_size, file) != (size_t)output_size)
+    {
+        fprintf(stderr, "schedgen: cannot write %s\n", path);
+        if (file != NULL)
+        {
+            fclose(file);
+        }
+        return (-1);
+    }
+    fclose(file);
+    return (0);
+}
+
+/**********************************************************
+ *  Function: check_file
+ *********************************************************/
+static int check_file(const char *path)
+{
+    static char current[MAX_OUTPUT];
+    FILE *file = fopen(path, "rb");
+    size_t size = 0;
+
+    if (file != NULL)
+    {
+        size = fread(current, 1, sizeof(current), file);
+        fclose(file);
+    }
+    if (file == NULL || size != (size_t)output_size || memcmp(current, output, size) != 0)
+    {
+        fprintf(stderr, "schedgen: %s is out of date\n", path);
+        return (-1);
+    }
+    return (0);
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+// usage: schedgen [-c] schedule header [header ...]
+// checks the schedule is feasible and writes the headers, or with -c
+// checks they match the schedule
+int main(int argc, char **argv)
+{
+    int check = 0;
+    int first = 1;
+    int ret = 0;
+    FILE *schedule;
+
+    if (argc > 1 && strcmp(argv[1], "-c") == 0)
+    {
+        check = 1;
+        first = 2;
+    }
+    if (argc < first + 1)
+    {
+        fprintf(stderr, "usage: %s [-c] schedule [header ...]\n", argv[0]);
+        return (1);
+    }
+
+    schedule = fopen(argv[first], "r");
+    if (schedule == NULL)
+    {
+        fprintf(stderr, "schedgen: cannot read %s\n", argv[first]);
+        return (1);
+    }
+    parse_schedule(schedule);
+    fclose(schedule);
+    order_tasks();
+    build_frames();
+    analyse_response();
+    generate(argv[first]);
+
+    for (int i = first + 1; i < argc; i++)
+    {
+        if ((check ? check_file(argv[i]) : write_file(argv[i])) < 0)
+        {
+            ret = 1;
+        }
+    }
+    return (ret);
+}
@@ -0,0 +1,104 @@
+/**********************************************************
+ *  Generated by schedgen from tasks.schedule, do not edit:
+ *  change the schedule and run schedgen again
+ *********************************************************/
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+// tasks in rate monotonic order, the highest priority first
+#define TASKS 6
+#define TASK_C 0 // reads the temperature
+#define TASK_B 1 // controls the heater from the temperature
+#define TASK_D 2 // sets the heater
+#define TASK_E 3 // reads the sunlight
+#define TASK_F 4 // reads the position
+#define TASK_A 5 // reads the sunlight
+
+// period, worst case execution time and worst case response time
+// of every task (ms)
+#define TASK_C_PERIOD 2000
+#define TASK_C_EXECUTION_TIME 400
+#define TASK_C_RESPONSE_TIME 1200
+#define TASK_B_PERIOD 2000
+#define TASK_B_EXECUTION_TIME 10
+#define TASK_B_RESPONSE_TIME 10
+#define TASK_D_PERIOD 2000
+#define TASK_D_EXECUTION_TIME 400
+#define TASK_D_RESPONSE_TIME 1210
+#define TASK_E_PERIOD 4000
+#define TASK_E_EXECUTION_TIME 400
+#define TASK_E_RESPONSE_TIME 1210
+#define TASK_F_PERIOD 4000
+#define TASK_F_EXECUTION_TIME 400
+#define TASK_F_RESPONSE_TIME 1210
+#define TASK_A_PERIOD 5000
+#define TASK_A_EXECUTION_TIME 10
+#define TASK_A_RESPONSE_TIME 820
+
+// cyclic schedule (ms): the releases of every minor frame repeat each
+// hyperperiod, the tasks use 60.7% of the processor
+#define SCHEDULE_HYPERPERIOD 20000
+#define SCHEDULE_MINOR_FRAME 1000
+#define SCHEDULE_FRAMES 20
+
+// requests the owner of the link sends in one exchange, as analysed
+#define SCHEDULE_LINK_WINDOW 4
+
+/**********************************************************
+ *  COMPILE TIME CHECKS
+ *********************************************************/
+
+#if defined(__cplusplus)
+#define SCHEDULE_ASSERT(cond, msg) static_assert(cond, msg)
+#else
+#define SCHEDULE_ASSERT(cond, msg) _Static_assert(cond, msg)
+#endif
+
+SCHEDULE_ASSERT(SCHEDULE_FRAMES * SCHEDULE_MINOR_FRAME == SCHEDULE_HYPERPERIOD, "the frames fill the hyperperiod");
+SCHEDULE_ASSERT(TASK_C_PERIOD % SCHEDULE_MINOR_FRAME == 0, "task C is released between frames");
+SCHEDULE_ASSERT(TASK_C_RESPONSE_TIME <= TASK_C_PERIOD, "task C misses its deadline");
+SCHEDULE_ASSERT(TASK_B_PERIOD % SCHEDULE_MINOR_FRAME == 0, "task B is released between frames");
+SCHEDULE_ASSERT(TASK_B_RESPONSE_TIME <= TASK_B_PERIOD, "task B misses its deadline");
+SCHEDULE_ASSERT(TASK_D_PERIOD % SCHEDULE_MINOR_FRAME == 0, "task D is released between frames");
+SCHEDULE_ASSERT(TASK_D_RESPONSE_TIME <= TASK_D_PERIOD, "task D misses its deadline");
+SCHEDULE_ASSERT(TASK_E_PERIOD % SCHEDULE_MINOR_FRAME == 0, "task E is released between frames");
+SCHEDULE_ASSERT(TASK_E_RESPONSE_TIME <= TASK_E_PERIOD, "task E misses its deadline");
+SCHEDULE_ASSERT(TASK_F_PERIOD % SCHEDULE_MINOR_FRAME == 0, "task F is released between frames");
+SCHEDULE_ASSERT(TASK_F_RESPONSE_TIME <= TASK_F_PERIOD, "task F misses its deadline");
+SCHEDULE_ASSERT(TASK_A_PERIOD % SCHEDULE_MINOR_FRAME == 0, "task A is released between frames");
+SCHEDULE_ASSERT(TASK_A_RESPONSE_TIME <= TASK_A_PERIOD, "task A misses its deadline");
+
+/**********************************************************
+ *  TABLES
+ *********************************************************/
+
+// tasks released at the start of every minor frame (bit 1 << TASK_X)
+static const unsigned char schedule_releases[SCHEDULE_FRAMES] = {
+    0x3F, // 0 ms: C B D E F A
+    0x00, // 1000 ms
+    0x07, // 2000 ms: C B D
+    0x00, // 3000 ms
+    0x1F, // 4000 ms: C B D E F
+    0x20, // 5000 ms: A
+    0x07, // 6000 ms: C B D
+    0x00, // 7000 ms
+    0x1F, // 8000 ms: C B D E F
+    0x00, // 9000 ms
+    0x27, // 10000 ms: C B D A
+    0x00, // 11000 ms
+    0x1F, // 12000 ms: C B D E F
+    0x00, // 13000 ms
+    0x07, // 14000 ms: C B D
+    0x20, // 15000 ms: A
+    0x1F, // 16000 ms: C B D E F
+    0x00, // 17000 ms
+    0x07, // 18000 ms: C B D
+    0x00, // 19000 ms
+};
+
+#endif
@@ -0,0 +1,66 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <string.h>
+
+#include "seqlock.h"
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: seqlock_init
+ *********************************************************/
+void seqlock_init(struct state_seqlock *lock, const struct spacecraft_state *state)
+{
+    memset(lock, 0, sizeof(struct state_seqlock));
+    memcpy(lock->words, state, sizeof(struct spacecraft_state));
+}
+
+/**********************************************************
+ *  Function: seqlock_publish
+ *********************************************************/
+// from the writer only: the version is odd while the words change, the
+// relaxed atomics keep every word whole
+void seqlock_publish(struct state_seqlock *lock, const struct spacecraft_state *state)
+{
+    uint64_t words[SEQLOCK_WORDS] = {0};
+    uint32_t seq = lock->seq;
+
+    memcpy(words, state, sizeof(struct spacecraft_state));
+    __atomic_store_n(&lock->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (unsigned i = 0; i < SEQLOCK_WORDS; i++)
+    {
+        __atomic_store_n(&lock->words[i], words[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&lock->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**********************************************************
+ *  Function: seqlock_read
+ *********************************************************/
+// copy of the last version whole, without locks; returns the version, it
+// grows by 2 with every publish
+uint32_t seqlock_read(const struct state_seqlock *lock, struct spacecraft_state *state)
+{
+    uint64_t words[SEQLOCK_WORDS];
+    uint32_t before;
+    uint32_t after;
+
+    do
+    {
+        before = __atomic_load_n(&lock->seq, __ATOMIC_ACQUIRE);
+        for (unsigned i = 0; i < SEQLOCK_WORDS; i++)
+        {
+            words[i] = __atomic_load_n(&lock->words[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&lock->seq, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+
+    memcpy(state, words, sizeof(struct spacecraft_state));
+    return (before);
+}
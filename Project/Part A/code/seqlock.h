@@ -0,0 +1,55 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdint.h>
+
+#include "protocol.h"
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// state of the satellite known by the master
+struct spacecraft_state
+{
+    double temperature;       // last temperature read
+    struct position position; // last position read
+    int sunlight_on;          // boolean with the last sunlight read
+    int heater_on;            // boolean with the heater confirmed by the slave
+};
+
+#define SEQLOCK_WORDS ((sizeof(struct spacecraft_state) + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+
+// versions of the state from a single writer to any number of readers:
+// the writer never waits, a reader tries again if it read while the state
+// changed
+struct state_seqlock
+{
+    uint32_t seq;                   // even with a version whole, odd while it changes
+    uint64_t words[SEQLOCK_WORDS];  // copy of the state
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: seqlock_init
+ *********************************************************/
+void seqlock_init(struct state_seqlock *lock, const struct spacecraft_state *state);
+
+/**********************************************************
+ *  Function: seqlock_publish
+ *********************************************************/
+void seqlock_publish(struct state_seqlock *lock, const struct spacecraft_state *state);
+
+/**********************************************************
+ *  Function: seqlock_read
+ *********************************************************/
+uint32_t seqlock_read(const struct state_seqlock *lock, struct spacecraft_state *state);
+
+#endif
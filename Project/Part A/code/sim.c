@@ -0,0 +1,1197 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "adaptive_sampler.h"
+#include "arduino_code.h"
+#include "binlog.h"
+#include "capture.h"
+#include "clock.h"
+#include "ctrl_ctx.h"
+#include "request_queue.h"
+#include "rto.h"
+#include "schedule.h"
+#include "sim.h"
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+// setpoint of the controller of Part C (control_temperature_ctx)
+#define AVG_TEMPERATURE 40.0
+
+#define MAX_RETRANSMITS 2 // requests sent again after a NACK
+#define MAX_WINDOW 8      // requests sent before their answers
+
+// handshake of the link: rates the master tries, fastest first, the wait
+// until the slave takes the rate agreed and until it goes back to the first
+#define MASTER_RATES_SIZE 7
+#define MASTER_FEATURES (FEATURE_BATCH | FEATURE_WINDOW | FEATURE_PUSH)
+#define HELLO_SWITCH_WAIT (300 * NS_PER_MS)
+#define HELLO_FALLBACK_WAIT (2500 * NS_PER_MS)
+
+// readings pushed by the slave: period of the pushes (ms), change of
+// temperature pushed at once and silence before subscribing again
+#define PUSH_PERIOD 2000
+#define PUSH_DELTA 5.0
+#define PUSH_TIMEOUT (3 * PUSH_PERIOD * NS_PER_MS)
+
+// overruns: releases a task keeps to catch up, and tasks shed at most to
+// degrade (the lowest priority first: A, F and E, never the temperature
+// and the heater), one more after every overrun and one less after a
+// hyperperiod without any
+#define OVERRUN_CATCH_UP_MAX 4
+#define OVERRUN_SHED_MAX 3
+
+// temperature polled when it could cross AVG_TEMPERATURE (adaptive): powers
+// and heat capacity of the model of arduino_code.c, and longest time
+// without a reading, which bounds a change of the sunlight unseen
+#define SLAVE_HEATER_POWER 150.0   // J/sec
+#define SLAVE_SUNLIGHT_POWER 50.0  // J/sec
+#define SLAVE_POWER_LOSS 100.0     // J/sec
+#define SLAVE_HEAT_CAPACITY 9.0    // J/C
+#define TEMP_MAX_PERIOD (4 * TASK_C_PERIOD * NS_PER_MS)
+
+// firmware of Part B
+#define SLAVE_LOOP_PERIOD (100 * NS_PER_MS) // delay(100) at the end of loop()
+#define HELLO_CONFIRM_TIMEOUT (2 * NS_PER_S) // at a new rate without a good frame
+
+// serial link
+#define LINK_BUFFER_SIZE 256
+#define BITS_PER_BYTE 10.0 // start bit + 8 data bits + stop bit
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// byte travelling on the serial link
+struct link_byte
+{
+    unsigned char data; // value of the byte
+    int64_t arrival;    // virtual time when the byte is fully received (ns)
+    double baud;        // rate the byte was sent at (bits/sec)
+};
+
+// periodic task of the controller
+struct sim_task
+{
+    enum command cmd;            // command sent every release (NO_CMD for none)
+    int period;                  // time between releases and deadline (ms)
+    int64_t release;             // virtual time of the last release (ns)
+    int64_t end;                 // virtual time the last release ended (ns)
+    int queued;                  // boolean: the release waits for the link
+    int late;                    // releases waiting for the last one to end (catch up)
+    int64_t late_release;        // virtual time of the first of them (ns)
+    struct link_request request; // request of the release to the owner of the link
+};
+
+// one direction of the serial link
+struct link
+{
+    struct link_byte buffer[LINK_BUFFER_SIZE];
+    int head;          // next byte to be read
+    int tail;          // next free position
+    int64_t line_free; // virtual time when the line ends sending (ns)
+    double tx_baud;    // rate of the UART of the sender (bits/sec)
+    double rx_baud;    // rate of the UART of the receiver (bits/sec)
+};
+
+// lines of the log of the master
+enum log_format
+{
+    LOG_POSITION, // x, y, z
+    LOG_STATE     // temperature, sunlight, heater
+};
+
+// state of a run: the serial link, the slave with the functions of
+// arduino_code.c and the master with those of ctrl_ctx.c, on the virtual
+// time
+struct sim_state
+{
+    struct sim_config cfg; // configuration of the run
+    struct sim_stats out;  // statistics of the run
+    int64_t now;           // current virtual time (ns)
+    int64_t end;           // virtual time when the run ends (ns)
+    int stopped;           // boolean to state if the end of the run has been reached
+    uint32_t noise;        // state of the generator of link errors
+    int64_t wall_start;    // monotonic time when the run started (real time runs)
+
+    struct link to_slave;  // link from master to slave
+    struct link to_master; // link from slave to master
+
+    // slave (Part B firmware)
+    struct sat_ctx slave;         // status of the satellite
+    struct cmd_queue slave_queue; // commands received in the last loop and their answers
+    int slave_heater;             // last heater state applied by the slave
+    int64_t slave_baud_time;      // virtual time of its last change of rate (ns)
+
+    // master (Part C controller)
+    struct ctrl_ctx master;               // state known, heater decided and messages
+    int master_heater_state;              // heater confirmed by the slave
+    int master_temperature_read;          // boolean: a temperature was read
+    unsigned char next_seq;               // sequence number of the next request
+    struct frame_parser master_parser;    // receiver of the frames of the slave (kept between reads)
+    struct hello master_hello;            // capabilities in the last HELLO answer
+    int link_features;                    // features agreed with the slave
+    struct rto_estimator master_rto;      // time the master waits for an answer
+    int master_subscribed;                // boolean: the slave pushes the readings
+    int64_t master_push_time;             // virtual time of the last push received (ns)
+    struct binlog_ring master_log;        // state logged, printed while the controller idles
+    struct sim_task tasks[TASKS];         // tasks of the controller by priority (schedule.h)
+    struct request_queue link_queue;      // requests of the tasks to the owner of the link
+    int shed_tasks;                       // lowest priority tasks shed (degrade)
+    int64_t last_overrun;                 // virtual time of the last overrun (ns)
+    struct adaptive_sampler temp_sampler; // releases of task C that read the temperature
+};
+
+/**********************************************************
+ *  PRIVATE STATUS (STATIC GLOBAL VARIABLES)
+ **********************************************************/
+
+// rates the master tries in the handshake (bits/sec)
+static const double master_rates[MASTER_RATES_SIZE] = {
+    1000000.0, 500000.0, 250000.0, 115200.0, 57600.0, 38400.0, 19200.0};
+// command and period of the tasks of the controller, as numbered in
+// schedule.h (task B only decides the heater)
+static const struct sim_task sim_task_table[TASKS] = {
+    [TASK_A] = {.cmd = READ_SUN_CMD, .period = TASK_A_PERIOD},
+    [TASK_B] = {.cmd = NO_CMD, .period = TASK_B_PERIOD},
+    [TASK_C] = {.cmd = READ_TEMP_CMD, .period = TASK_C_PERIOD},
+    [TASK_D] = {.cmd = SET_HEAT_CMD, .period = TASK_D_PERIOD},
+    [TASK_E] = {.cmd = READ_SUN_CMD, .period = TASK_E_PERIOD},
+    [TASK_F] = {.cmd = READ_POS_CMD, .period = TASK_F_PERIOD}};
+
+// the current run
+static struct sim_state sim;
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: sync_wall_clock
+ *********************************************************/
+static void sync_wall_clock()
+{
+    // as fast as possible
+    if (sim.cfg.speed <= 0.0)
+    {
+        return;
+    }
+
+    // sleep until the monotonic clock reaches the virtual time
+    clock_monotonic_sleep_until(sim.wall_start + (int64_t)(((double)sim.now) / sim.cfg.speed));
+}
+
+/**********************************************************
+ *  Function: link_noise
+ *********************************************************/
+// flips a bit of the byte with the probability of sim.cfg.error_rate, or
+// always if the rate is above the one the line carries
+static unsigned char link_noise(unsigned char data, double baud)
+{
+    int too_fast = (sim.cfg.line_baud_rate > 0.0) && (baud > sim.cfg.line_baud_rate);
+
+    if (sim.cfg.error_rate <= 0.0 && !too_fast)
+    {
+        return (data);
+    }
+
+    // xorshift, so the same run gets the same errors
+    sim.noise ^= sim.noise << 13;
+    sim.noise ^= sim.noise >> 17;
+    sim.noise ^= sim.noise << 5;
+    if (!too_fast && (double)(sim.noise >> 8) / 16777216.0 >= sim.cfg.error_rate)
+    {
+        return (data);
+    }
+    return ((unsigned char)(data ^ (1 << (sim.noise & 7))));
+}
+
+/**********************************************************
+ *  Function: link_write
+ *********************************************************/
+static void link_write(struct link *link, const unsigned char *data, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        int next = (link->tail + 1) % LINK_BUFFER_SIZE;
+
+        // the byte is lost if the receiver buffer is full
+        if (next == link->head)
+        {
+            continue;
+        }
+
+        // bytes are sent one after the other at the speed of the link
+        if (link->line_free < sim.now)
+        {
+            link->line_free = sim.now;
+        }
+        link->line_free += (int64_t)(BITS_PER_BYTE * (double)NS_PER_S / link->tx_baud);
+
+        link->buffer[link->tail].data = link_noise(data[i], link->tx_baud);
+        link->buffer[link->tail].arrival = link->line_free;
+        link->buffer[link->tail].baud = link->tx_baud;
+        link->tail = next;
+    }
+}
+
+/**********************************************************
+ *  Function: link_available
+ *********************************************************/
+static int link_available(const struct link *link)
+{
+    return (link->head != link->tail) &&
+           (link->buffer[link->head].arrival <= sim.now);
+}
+
+/**********************************************************
+ *  Function: link_read
+ *********************************************************/
+static unsigned char link_read(struct link *link)
+{
+    unsigned char data = link->buffer[link->head].data;
+
+    // a receiver at another rate than the sender reads garbage
+    if (link->buffer[link->head].baud != link->rx_baud)
+    {
+        data = (unsigned char)~data;
+    }
+    link->head = (link->head + 1) % LINK_BUFFER_SIZE;
+    return (data);
+}
+
+//---------------------------------------------------------------------------
+//                           SLAVE (PART B FIRMWARE)
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: set_slave_rate
+ *********************************************************/
+static void set_slave_rate(double rate)
+{
+    sim.to_master.tx_baud = rate;
+    sim.to_slave.rx_baud = rate;
+    sim.slave_queue.confirmed = (rate == sim.cfg.baud_rate);
+    sim.slave_baud_time = sim.now;
+    sim.slave_queue.parser.count = 0;
+}
+
+/**********************************************************
+ *  Function: comm_server
+ *********************************************************/
+static void comm_server()
+{
+    double next_rate = sim.to_slave.rx_baud;
+
+    // Send the answers of the commands received in the last loop, in the
+    // order of the requests, then queue the commands received since.
+    for (int i = 0; i < sim.slave_queue.count; i++)
+    {
+        unsigned char frame[FRAME_MAX_SIZE];
+        uint32_t rate = 0;
+        int size = cmd_queue_answer(&sim.slave_queue, i, frame, &rate);
+
+        link_write(&sim.to_master, frame, size);
+        sim.out.bytes_to_master += size;
+        if (rate > 0)
+        {
+            next_rate = (double)rate;
+        }
+    }
+    sim.slave_queue.count = 0;
+    if (next_rate != sim.to_slave.rx_baud)
+    {
+        set_slave_rate(next_rate);
+    }
+    // back to the first rate if the master never came to the new one
+    else if (!sim.slave_queue.confirmed && sim.now - sim.slave_baud_time > HELLO_CONFIRM_TIMEOUT)
+    {
+        set_slave_rate(sim.cfg.baud_rate);
+    }
+
+    while (link_available(&sim.to_slave) && sim.slave_queue.count < CMD_QUEUE_SIZE)
+    {
+        cmd_queue_byte_ctx(&sim.slave, &sim.slave_queue, link_read(&sim.to_slave));
+    }
+}
+
+/**********************************************************
+ *  Function: push_server
+ *********************************************************/
+static void push_server()
+{
+    struct res_msg push;
+
+    // push the readings subscribed when they are due, without a request
+    if (push_telemetry_ctx(&sim.slave, &push))
+    {
+        unsigned char frame[FRAME_MAX_SIZE];
+        int size = frame_close(frame, encode_res_msg(&push, frame + 1));
+        link_write(&sim.to_master, frame, size);
+        sim.out.bytes_to_master += size;
+    }
+}
+
+/**********************************************************
+ *  Function: slave_loop
+ *********************************************************/
+static void slave_loop()
+{
+    comm_server();
+    cmd_queue_exec_ctx(&sim.slave, &sim.slave_queue);
+    get_temperature_ctx(&sim.slave);
+    get_position_ctx(&sim.slave);
+
+    // the sun sensor is lit on the half of the orbit with x >= 0
+    sim.slave.sunlight_on = (sim.slave.position.x >= 0.0) ? 1 : 0;
+    push_server();
+
+    // account the changes of the heater output
+    if (sim.slave.heater_on != sim.slave_heater)
+    {
+        sim.slave_heater = sim.slave.heater_on;
+        sim.out.heater_switches++;
+    }
+
+    sim.out.slave_loops++;
+}
+
+//---------------------------------------------------------------------------
+//                           EVENT SCHEDULING
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: next_slave_loop
+ *********************************************************/
+static int64_t next_slave_loop()
+{
+    return ((int64_t)sim.out.slave_loops) * SLAVE_LOOP_PERIOD;
+}
+
+/**********************************************************
+ *  Function: sim_advance
+ *********************************************************/
+static void sim_advance(int64_t time)
+{
+    // never go further than the end of the run
+    if (time >= sim.end)
+    {
+        time = sim.end;
+        sim.stopped = 1;
+    }
+
+    // run the slave loops released until that time
+    while (next_slave_loop() <= time)
+    {
+        sim.now = next_slave_loop();
+        clock_virtual_set(sim.now);
+        sync_wall_clock();
+        slave_loop();
+    }
+
+    sim.now = time;
+    clock_virtual_set(sim.now);
+    sync_wall_clock();
+}
+
+/**********************************************************
+ *  Function: sim_delay
+ *********************************************************/
+static void sim_delay(int64_t time)
+{
+    sim_advance(sim.now + time);
+}
+
+/**********************************************************
+ *  Function: master_read
+ *********************************************************/
+static int master_read(unsigned char *data, int64_t deadline)
+{
+    // block until a byte has arrived, the deadline or the end of the run
+    while (!link_available(&sim.to_master))
+    {
+        int64_t next_event = next_slave_loop();
+
+        if (sim.stopped || sim.now >= deadline)
+        {
+            return (-1);
+        }
+        if ((sim.to_master.head != sim.to_master.tail) &&
+            (sim.to_master.buffer[sim.to_master.head].arrival < next_event))
+        {
+            next_event = sim.to_master.buffer[sim.to_master.head].arrival;
+        }
+        if (deadline < next_event)
+        {
+            next_event = deadline;
+        }
+        sim_advance(next_event);
+    }
+
+    *data = link_read(&sim.to_master);
+    return (0);
+}
+
+//---------------------------------------------------------------------------
+//                           MASTER (PART C CONTROLLER)
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: send_msg
+ *********************************************************/
+static void send_msg()
+{
+    // put the message in a frame
+    unsigned char frame[FRAME_MAX_SIZE];
+    int size = frame_close(frame, encode_cmd_msg(&sim.master.next_cmd_msg, frame + 1));
+
+    // send the frame to slave
+    link_write(&sim.to_slave, frame, size);
+    sim.out.bytes_to_slave += size;
+
+    // capture the frame as it goes on the wire
+    capture_frame(CAPTURE_TO_SLAVE, 0, frame, size);
+}
+
+/**********************************************************
+ *  Function: recv_msg
+ *********************************************************/
+static int recv_msg(int64_t deadline)
+{
+    unsigned char car_aux;
+    int ret = FRAME_INCOMPLETE;
+
+    // read bytes until the delimiter of a frame, up to the deadline (the
+    // bytes of a frame cut by the deadline stay in the parser)
+    while (ret == FRAME_INCOMPLETE)
+    {
+        if (master_read(&car_aux, deadline) < 0)
+        {
+            return (-1);
+        }
+        ret = frame_parse_byte(&sim.master_parser, car_aux);
+    }
+
+    // capture the frame as it came from the wire
+    capture_frame(CAPTURE_TO_MASTER, 0, sim.master_parser.frame, sim.master_parser.length);
+
+    if (ret == FRAME_WRONG ||
+        decode_res_msg(sim.master_parser.message, sim.master_parser.size, &sim.master.last_res_msg) < 0)
+    {
+        sim.out.frame_errors++;
+        sim.master.last_res_msg.cmd = NO_CMD;
+        sim.master.last_res_msg.status = STATUS_NACK;
+    }
+    return (0);
+}
+
+/**********************************************************
+ *  Function: update_temperature
+ *********************************************************/
+// the temperature read by the master goes to the extremes of the run
+static void update_temperature()
+{
+    double temperature = sim.master.temperature;
+
+    if (!sim.master_temperature_read || temperature < sim.out.min_temperature)
+    {
+        sim.out.min_temperature = temperature;
+    }
+    if (!sim.master_temperature_read || temperature > sim.out.max_temperature)
+    {
+        sim.out.max_temperature = temperature;
+    }
+    sim.master_temperature_read = 1;
+}
+
+/**********************************************************
+ *  Function: set_heater_state
+ *********************************************************/
+// heater confirmed by the slave
+static void set_heater_state(int heater_on)
+{
+    sim.master_heater_state = heater_on;
+    if (heater_on)
+    {
+        sim.out.heater_confirmed++;
+    }
+}
+
+/**********************************************************
+ *  Function: recv_res_msg
+ *********************************************************/
+// the answers about the link are applied here, the state of the satellite
+// by recv_res_msg_ctx; a SET_HEAT_CMD is answered for the heater of the
+// request in next_cmd_msg
+static void recv_res_msg()
+{
+    const struct res_msg *res = &sim.master.last_res_msg;
+    enum command cmd = res->cmd;
+    int batch = (cmd == BATCH_CMD || cmd == TELEMETRY_CMD) ? res->data.batch.batch : 0;
+    int heater = (res->status == STATUS_DONE) && (cmd == SET_HEAT_CMD || (batch & BATCH_SET_HEAT));
+    int temperature = (cmd == READ_TEMP_CMD) || (batch & BATCH_READ_TEMP);
+
+    if (cmd == HELLO_CMD)
+    {
+        // capabilities agreed by the slave
+        sim.master_hello = res->data.hello;
+    }
+    else if (cmd == SUBSCRIBE_CMD)
+    {
+        // the readings are pushed from now on
+        sim.master_subscribed = (res->status == STATUS_DONE);
+        sim.master_push_time = sim.now;
+    }
+    else if (cmd == TELEMETRY_CMD)
+    {
+        sim.master_push_time = sim.now;
+        sim.out.pushes++;
+    }
+
+    recv_res_msg_ctx(&sim.master);
+    if (heater)
+    {
+        set_heater_state(sim.master.heater_on);
+    }
+    if (temperature)
+    {
+        update_temperature();
+    }
+}
+
+/**********************************************************
+ *  Function: recv_answer
+ *********************************************************/
+// reads frames up to the next answer, the readings pushed on the way are
+// applied as they come
+static int recv_answer(int64_t deadline)
+{
+    while (recv_msg(deadline) == 0)
+    {
+        if (sim.master.last_res_msg.cmd != TELEMETRY_CMD)
+        {
+            return (0);
+        }
+        recv_res_msg();
+    }
+    return (-1);
+}
+
+/**********************************************************
+ *  Function: recv_pending
+ *********************************************************/
+// applies the readings pushed up to the given time, the answers that came
+// too late for their request are dropped
+static void recv_pending(int64_t until)
+{
+    while (recv_answer(until) == 0)
+    {
+        sim.master.last_res_msg.cmd = NO_CMD;
+    }
+}
+
+/**********************************************************
+ *  Function: format_position
+ *********************************************************/
+static void format_position(FILE *file, const struct binlog_record *record)
+{
+    fprintf(file, "Time: %.3f\n", ((double)record->time) / ((double)NS_PER_S));
+    fprintf(file, "Position: (%.2f, %.2f, %.2f)\n", record->args[0], record->args[1], record->args[2]);
+}
+
+/**********************************************************
+ *  Function: format_state
+ *********************************************************/
+static void format_state(FILE *file, const struct binlog_record *record)
+{
+    fprintf(file, "Temperature: %.2f\n", record->args[0]);
+    fprintf(file, "Sunlight: %s\n", (record->args[1] != 0.0 ? "ON" : "OFF"));
+    fprintf(file, "Heater: %s\n", (record->args[2] != 0.0 ? "ON" : "OFF"));
+}
+
+// by enum log_format
+static const binlog_formatter log_formatters[] = {
+    [LOG_POSITION] = format_position,
+    [LOG_STATE] = format_state};
+
+/**********************************************************
+ *  Function: print_state
+ *********************************************************/
+// the values only, formatted by drain_log
+static void print_state()
+{
+    const struct ctrl_ctx *master = &sim.master;
+
+    binlog_write(&sim.master_log, sim.now, LOG_POSITION, master->position.x, master->position.y, master->position.z, 0.0);
+    binlog_write(&sim.master_log, sim.now, LOG_STATE, master->temperature, master->sunlight_on,
+                 sim.master_heater_state, 0.0);
+}
+
+/**********************************************************
+ *  Function: drain_log
+ *********************************************************/
+static void drain_log()
+{
+    binlog_drain(&sim.master_log, log_formatters, stdout);
+}
+
+/**********************************************************
+ *  Function: execute_window
+ *********************************************************/
+static void execute_window(const enum command *cmds, int count)
+{
+    struct cmd_msg window[MAX_WINDOW];
+    int answered[MAX_WINDOW];
+    int sends[MAX_WINDOW];
+    int64_t sent_time[MAX_WINDOW];
+    int pending = count;
+
+    // prepare request buffers
+    for (int i = 0; i < count; i++)
+    {
+        send_cmd_msg_ctx(&sim.master, cmds[i]);
+        sim.master.next_cmd_msg.seq = sim.next_seq++;
+        window[i] = sim.master.next_cmd_msg;
+        answered[i] = 0;
+        sends[i] = 0;
+    }
+
+    // a request or an answer received wrong costs one more round trip,
+    // every command can be sent again safely
+    for (int attempt = 0; attempt <= MAX_RETRANSMITS && pending > 0; attempt++)
+    {
+        int64_t deadline;
+        int sent = 0;
+
+        recv_pending(sim.now);
+
+        // send the requests still without answer one after the other
+        for (int i = 0; i < count; i++)
+        {
+            if (answered[i])
+            {
+                continue;
+            }
+            if (attempt > 0)
+            {
+                sim.out.retransmits++;
+            }
+            sim.master.next_cmd_msg = window[i];
+            send_msg();
+            sent_time[i] = sim.now;
+            sends[i]++;
+            sent++;
+        }
+
+        // the answers (or NACKs) come back in order, one per request, and
+        // are read as soon as they arrive; a late answer of an earlier
+        // request does not count
+        deadline = sim.now + sim.master_rto.rto;
+        while (sent > 0)
+        {
+            if (recv_answer(deadline) < 0)
+            {
+                if (sim.stopped)
+                {
+                    return;
+                }
+                rto_backoff(&sim.master_rto);
+                break;
+            }
+            if (sim.master.last_res_msg.status == STATUS_NACK)
+            {
+                sent--;
+                continue;
+            }
+            for (int i = 0; i < count; i++)
+            {
+                if (!answered[i] && window[i].seq == sim.master.last_res_msg.seq)
+                {
+                    // parse response
+                    answered[i] = 1;
+                    pending--;
+                    sent--;
+                    if (sends[i] == 1)
+                    {
+                        rto_sample(&sim.master_rto, sim.now - sent_time[i]);
+                    }
+                    sim.master.next_cmd_msg = window[i];
+                    recv_res_msg();
+                    sim.out.commands++;
+                    break;
+                }
+            }
+        }
+    }
+
+    // the data is missing until the next period
+    sim.out.failed_commands += pending;
+    sim.master.last_res_msg.cmd = NO_CMD;
+}
+
+/**********************************************************
+ *  Function: execute_cmds
+ *********************************************************/
+// sends up to sim.cfg.window requests before reading their answers, which
+// are matched by sequence number
+static void execute_cmds(const enum command *cmds, int count)
+{
+    // a slave without the queue answers a single request per loop
+    int window = (sim.link_features & FEATURE_WINDOW) ? sim.cfg.window : 1;
+
+    for (int first = 0; first < count && !sim.stopped; first += window)
+    {
+        int size = count - first;
+
+        execute_window(cmds + first, (size < window) ? size : window);
+    }
+}
+
+/**********************************************************
+ *  Function: execute_batch
+ *********************************************************/
+// executes all the commands in a single BATCH_CMD, one round trip (a
+// single command goes as it is, its answer is shorter)
+static void execute_batch(const enum command *cmds, int count)
+{
+    enum command batch_cmd = BATCH_CMD;
+
+    if (count <= 1)
+    {
+        execute_cmds(cmds, count);
+        return;
+    }
+
+    // the bit of each command is 1 << (command - 1)
+    sim.master.next_cmd_msg.batch = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sim.master.next_cmd_msg.batch |= (unsigned char)(1 << (cmds[i] - 1));
+    }
+    execute_cmds(&batch_cmd, 1);
+}
+
+/**********************************************************
+ *  Function: set_master_rate
+ *********************************************************/
+static void set_master_rate(double rate)
+{
+    sim.to_slave.tx_baud = rate;
+    sim.to_master.rx_baud = rate;
+    sim.out.baud_rate = rate;
+    sim.master_parser.count = 0;
+}
+
+/**********************************************************
+ *  Function: send_hello
+ *********************************************************/
+// returns 0 if the slave answered the HELLO_CMD, -1 otherwise
+static int send_hello(double rate)
+{
+    enum command hello_cmd = HELLO_CMD;
+
+    sim.master.next_cmd_msg.data.hello.version = PROTOCOL_VERSION;
+    sim.master.next_cmd_msg.data.hello.features = MASTER_FEATURES;
+    sim.master.next_cmd_msg.data.hello.baud = (uint32_t)rate;
+    memset(&sim.master_hello, 0, sizeof(struct hello));
+    execute_cmds(&hello_cmd, 1);
+
+    return (sim.master_hello.version == PROTOCOL_VERSION) ? 0 : -1;
+}
+
+/**********************************************************
+ *  Function: negotiate_link
+ *********************************************************/
+// agrees with the slave on the features and on the fastest rate that
+// works: each rate is taken by both ends and checked with another HELLO,
+// on errors both go back to the first rate and try the next one
+static void negotiate_link()
+{
+    for (int i = 0; i < MASTER_RATES_SIZE && !sim.stopped; i++)
+    {
+        double rate = master_rates[i];
+
+        if (rate > sim.cfg.max_baud_rate || rate <= sim.cfg.baud_rate)
+        {
+            continue;
+        }
+
+        // a slave without the handshake stays at the first rate
+        if (send_hello(rate) < 0)
+        {
+            return;
+        }
+        sim.link_features = sim.master_hello.features;
+        rate = (double)sim.master_hello.baud;
+        if (rate <= sim.cfg.baud_rate)
+        {
+            return;
+        }
+
+        // both ends take the new rate, a good answer confirms it
+        set_master_rate(rate);
+        sim_delay(HELLO_SWITCH_WAIT);
+        if (send_hello(rate) == 0 && (double)sim.master_hello.baud == rate)
+        {
+            return;
+        }
+        set_master_rate(sim.cfg.baud_rate);
+        sim_delay(HELLO_FALLBACK_WAIT);
+
+        // try the rates below the one that failed
+        while (i + 1 < MASTER_RATES_SIZE && master_rates[i + 1] >= rate)
+        {
+            i++;
+        }
+    }
+}
+
+/**********************************************************
+ *  Function: subscribe
+ *********************************************************/
+// asks the slave to push the readings of the tasks A, C, E and F, which
+// are not polled while the pushes keep coming
+static void subscribe()
+{
+    enum command subscribe_cmd = SUBSCRIBE_CMD;
+
+    sim.master.next_cmd_msg.data.subscription.parts = BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS;
+    sim.master.next_cmd_msg.data.subscription.period = PUSH_PERIOD;
+    sim.master.next_cmd_msg.data.subscription.delta = PUSH_DELTA;
+    sim.master_subscribed = 0;
+    execute_cmds(&subscribe_cmd, 1);
+}
+
+/**********************************************************
+ *  Function: start_release
+ *********************************************************/
+static void start_release(struct sim_task *task, int64_t release)
+{
+    task->release = release;
+    task->queued = 1;
+    if (task->cmd != NO_CMD)
+    {
+        task->request.task = (int)(task - sim.tasks);
+        task->request.cmd = task->cmd;
+        task->request.deadline = release + task->period * NS_PER_MS;
+        request_queue_push(&sim.link_queue, &task->request);
+    }
+}
+
+/**********************************************************
+ *  Function: note_overrun
+ *********************************************************/
+// a task ran late: to degrade, one more of the lowest priority tasks is
+// shed
+static void note_overrun(int64_t time)
+{
+    sim.last_overrun = time;
+    if (sim.cfg.overrun_policy == OVERRUN_DEGRADE && sim.shed_tasks < OVERRUN_SHED_MAX)
+    {
+        sim.shed_tasks++;
+    }
+}
+
+/**********************************************************
+ *  Function: complete_task
+ *********************************************************/
+static void complete_task(struct sim_task *task)
+{
+    int64_t deadline = task->release + task->period * NS_PER_MS;
+    double response = ((double)(sim.now - task->release)) / ((double)NS_PER_S);
+
+    task->queued = 0;
+    task->end = sim.now;
+    // only whole releases are accounted
+    if (sim.stopped)
+    {
+        return;
+    }
+    sim.out.jobs++;
+    if (response > sim.out.max_response)
+    {
+        sim.out.max_response = response;
+    }
+    histogram_record(&sim.out.response[task - sim.tasks], sim.now - task->release);
+    if (task == &sim.tasks[TASK_C] && sim.cfg.adaptive)
+    {
+        // below the setpoint the heater is on, above it off
+        double sunlight = sim.master.sunlight_on ? SLAVE_SUNLIGHT_POWER : 0.0;
+        double rise = (SLAVE_HEATER_POWER + sunlight - SLAVE_POWER_LOSS) / SLAVE_HEAT_CAPACITY;
+        double fall = (SLAVE_POWER_LOSS - sunlight) / SLAVE_HEAT_CAPACITY;
+
+        adaptive_sampler_update(&sim.temp_sampler, sim.master.temperature, rise, fall, task->release);
+    }
+    if (sim.now > deadline)
+    {
+        sim.out.overruns++;
+        note_overrun(sim.now);
+    }
+
+    // to catch up the releases lost meanwhile run at once, one after other
+    if (task->late > 0)
+    {
+        task->late--;
+        start_release(task, task->late_release);
+        task->late_release += task->period * NS_PER_MS;
+    }
+}
+
+/**********************************************************
+ *  Function: release_tasks
+ *********************************************************/
+// releases the tasks of a minor frame as the table of schedule.h says; a
+// task that has not ended its last release by then misses the new one,
+// which is lost or kept as sim.cfg.overrun_policy says
+static void release_tasks(int frame, int64_t frame_time)
+{
+    // the tasks shed come back one by one while there are no overruns
+    if (sim.shed_tasks > 0 && frame_time - sim.last_overrun >= SCHEDULE_HYPERPERIOD * NS_PER_MS)
+    {
+        sim.shed_tasks--;
+        sim.last_overrun = frame_time;
+    }
+
+    for (int i = 0; i < TASKS; i++)
+    {
+        struct sim_task *task = &sim.tasks[i];
+
+        if (!(schedule_releases[frame] & (1 << i)))
+        {
+            continue;
+        }
+        if (i >= TASKS - sim.shed_tasks)
+        {
+            sim.out.shed_releases++;
+            continue;
+        }
+        // far from the setpoint every reading gives the same heater; the
+        // readings pushed cost no request, so only the polled are skipped
+        if (i == TASK_C && sim.cfg.adaptive && !sim.master_subscribed && !task->queued &&
+            task->end <= frame_time && !adaptive_sampler_due(&sim.temp_sampler, frame_time))
+        {
+            sim.out.skipped_reads++;
+            continue;
+        }
+        if (task->queued || task->end > frame_time)
+        {
+            sim.out.deadline_misses++;
+            note_overrun(frame_time);
+            if (sim.cfg.overrun_policy == OVERRUN_CATCH_UP && task->late < OVERRUN_CATCH_UP_MAX)
+            {
+                task->late_release = (task->late == 0) ? frame_time : task->late_release;
+                task->late++;
+            }
+            continue;
+        }
+        start_release(task, frame_time);
+    }
+}
+
+/**********************************************************
+ *  Function: serve_link
+ *********************************************************/
+// the owner of the link: sends the requests with the earliest deadlines,
+// all of them in a single batch or a window of them, returns 0 if none
+// was waiting; a request released meanwhile goes before the routine
+// ones still waiting
+static int serve_link()
+{
+    struct link_request *served[REQUEST_QUEUE_SIZE];
+    enum command cmds[REQUEST_QUEUE_SIZE];
+    int count = 0;
+    int waiting;
+    int pushed = sim.cfg.subscribe && (sim.link_features & FEATURE_PUSH);
+    int batch = sim.cfg.batch && (sim.link_features & FEATURE_BATCH);
+    int window = (sim.link_features & FEATURE_WINDOW) ? sim.cfg.window : 1;
+    int64_t start = sim.now;
+
+    if (request_queue_collect(&sim.link_queue) == 0)
+    {
+        return (0);
+    }
+
+    // subscribe again if the pushes stopped (the slave was reset)
+    if (pushed && (!sim.master_subscribed || sim.now - sim.master_push_time > PUSH_TIMEOUT))
+    {
+        subscribe();
+    }
+    recv_pending(sim.now);
+
+    // the readings pushed are not requested
+    for (waiting = 0; sim.link_queue.count > 0 && (batch || waiting < window); waiting++)
+    {
+        served[waiting] = request_queue_pop(&sim.link_queue);
+        if (!(pushed && sim.master_subscribed && served[waiting]->cmd != SET_HEAT_CMD))
+        {
+            cmds[count++] = served[waiting]->cmd;
+        }
+    }
+    if (batch)
+    {
+        execute_batch(cmds, count);
+    }
+    else
+    {
+        execute_cmds(cmds, count);
+    }
+
+    for (int i = 0; i < waiting; i++)
+    {
+        struct sim_task *task = &sim.tasks[served[i]->task];
+
+        request_complete(served[i]);
+        histogram_record(&sim.out.jitter[served[i]->task], start - task->release);
+        histogram_record(&sim.out.round_trip[served[i]->task], sim.now - start);
+        complete_task(task);
+    }
+    return (1);
+}
+
+/**********************************************************
+ *  Function: controller
+ *********************************************************/
+// tasks of Part C on one processor, released every minor frame by the
+// table of schedule.h and run by priority
+static void controller()
+{
+    int64_t frame_time;
+    int frame = 0;
+
+    if (sim.cfg.max_baud_rate > 0.0)
+    {
+        negotiate_link();
+    }
+
+    // the first frame starts after the handshake
+    frame_time = sim.now;
+    for (int i = 0; i < TASKS; i++)
+    {
+        sim.tasks[i].release = 0;
+        sim.tasks[i].end = 0;
+        sim.tasks[i].queued = 0;
+        sim.tasks[i].late = 0;
+    }
+    request_queue_init(&sim.link_queue);
+    sim.shed_tasks = 0;
+    sim.last_overrun = 0;
+    adaptive_sampler_init(&sim.temp_sampler, AVG_TEMPERATURE, TASK_C_PERIOD * NS_PER_MS, TEMP_MAX_PERIOD);
+
+    while (!sim.stopped)
+    {
+        // the frames gone by while the link was busy release their tasks late
+        while (frame_time <= sim.now)
+        {
+            release_tasks(frame, frame_time);
+            frame_time += SCHEDULE_MINOR_FRAME * NS_PER_MS;
+            frame = (frame + 1 == SCHEDULE_FRAMES) ? 0 : frame + 1;
+        }
+
+        // task B runs before the tasks below it wait for the link
+        if (sim.tasks[TASK_B].queued)
+        {
+            histogram_record(&sim.out.jitter[TASK_B], sim.now - sim.tasks[TASK_B].release);
+            control_temperature_ctx(&sim.master);
+            if (sim.cfg.verbose)
+            {
+                print_state();
+            }
+            complete_task(&sim.tasks[TASK_B]);
+        }
+
+        // idle until the next frame, applying the readings pushed meanwhile
+        if (!serve_link())
+        {
+            drain_log();
+            recv_pending(frame_time);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: sim_default_config
+ *********************************************************/
+void sim_default_config(struct sim_config *config)
+{
+    config->duration = 3600.0;
+    config->baud_rate = 9600.0;
+    config->speed = 0.0;
+    config->verbose = 0;
+    config->capture = NULL;
+    config->error_rate = 0.0;
+    config->window = 4;
+    config->batch = 1;
+    config->max_baud_rate = 115200.0;
+    config->line_baud_rate = 0.0;
+    config->subscribe = 1;
+    config->overrun_policy = OVERRUN_SKIP;
+    config->adaptive = 0;
+}
+
+/**********************************************************
+ *  Function: sim_run
+ *********************************************************/
+int sim_run(const struct sim_config *config, struct sim_stats *stats)
+{
+    if ((config->duration <= 0.0) || (config->baud_rate <= 0.0) ||
+        (config->speed < 0.0) || (config->error_rate < 0.0) || (config->error_rate > 1.0) ||
+        (config->window < 1) || (config->window > MAX_WINDOW) ||
+        (config->max_baud_rate < 0.0) || (config->line_baud_rate < 0.0) ||
+        (config->overrun_policy < OVERRUN_SKIP) || (config->overrun_policy > OVERRUN_DEGRADE))
+    {
+        return (-1);
+    }
+
+    // reset the simulation
+    memset(&sim, 0, sizeof(struct sim_state));
+    sim.cfg = *config;
+    sim.end = (int64_t)(config->duration * (double)NS_PER_S);
+    sim.noise = 2463534242u;
+    sim.wall_start = clock_monotonic_ns();
+
+    // reset the slave
+    sat_ctx_init(&sim.slave);
+    cmd_queue_init(&sim.slave_queue);
+    set_slave_rate(config->baud_rate);
+
+    // reset the master
+    ctrl_ctx_init(&sim.master);
+    rto_init(&sim.master_rto);
+    // without the handshake the slave is taken to have every feature
+    sim.link_features = (config->max_baud_rate > 0.0) ? 0 : MASTER_FEATURES;
+    set_master_rate(config->baud_rate);
+    binlog_init(&sim.master_log);
+    memcpy(sim.tasks, sim_task_table, sizeof(sim.tasks));
+
+    // run master and slave on the virtual time
+    clock_virtual_start(0);
+    if (config->capture != NULL && capture_start(config->capture) < 0)
+    {
+        clock_virtual_stop();
+        return (-1);
+    }
+    controller();
+    drain_log();
+    capture_stop();
+    clock_virtual_stop();
+
+    sim.out.sim_time = ((double)sim.now) / ((double)NS_PER_S);
+    sim.out.temperature = sim.master.temperature;
+    sim.out.srtt = ((double)sim.master_rto.srtt) / ((double)NS_PER_S);
+    sim.out.rto = ((double)sim.master_rto.rto) / ((double)NS_PER_S);
+    sim.out.heater_on = sim.slave.heater_on;
+    sim.out.sunlight_on = sim.slave.sunlight_on;
+    *stats = sim.out;
+
+    return (0);
+}
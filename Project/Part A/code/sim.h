@@ -0,0 +1,88 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdio.h>
+
+#include "histogram.h"
+#include "schedule.h"
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// what the controller does with a release that finds the last one of its
+// task still running
+enum overrun_policy
+{
+    OVERRUN_SKIP = 0,     // the release is lost
+    OVERRUN_CATCH_UP = 1, // it runs as soon as the last one ends
+    OVERRUN_DEGRADE = 2   // it is lost and the lowest priority tasks are shed for a while
+};
+
+// configuration of a simulation run
+struct sim_config
+{
+    double duration;       // simulated time to run (sec)
+    double baud_rate;      // speed of the serial link at startup (bits/sec)
+    double speed;          // 0 = as fast as possible, 1 = real time, N = N times faster
+    int verbose;           // boolean to print the master state every control
+    const char *capture;   // file to capture the serial traffic (NULL for none)
+    double error_rate;     // probability of a bit error in each byte on the link
+    int window;            // requests sent before reading their answers (1 to 8)
+    int batch;             // boolean to send the requests waiting together in one BATCH_CMD
+    double max_baud_rate;  // fastest rate asked in the HELLO handshake (0 = no handshake)
+    double line_baud_rate; // fastest rate the line carries without errors (0 = any)
+    int subscribe;         // boolean to get the readings pushed instead of polled
+    int overrun_policy;    // enum overrun_policy
+    int adaptive;          // boolean to poll the temperature only when it could cross the setpoint (not pushed)
+};
+
+// results of a simulation run
+struct sim_stats
+{
+    double sim_time;                 // simulated time reached (sec)
+    unsigned long jobs;              // releases of the controller tasks completed
+    unsigned long deadline_misses;   // releases that found the previous one still running
+    unsigned long overruns;          // releases that ended after their deadline
+    unsigned long shed_releases;     // releases not run to keep the faster tasks on time
+    unsigned long skipped_reads;     // releases of task C too far from the setpoint to read
+    double max_response;             // longest time from a release to its end (sec)
+    unsigned long commands;          // commands exchanged with the slave
+    unsigned long slave_loops;       // iterations of the slave loop
+    unsigned long bytes_to_slave;    // bytes sent by the master
+    unsigned long bytes_to_master;   // bytes sent by the slave
+    unsigned long frame_errors;      // responses received wrong
+    unsigned long retransmits;       // requests sent again after a NACK or error
+    unsigned long failed_commands;   // commands without answer after all retries
+    unsigned long pushes;            // readings pushed by the slave and received
+    unsigned long heater_switches;   // times the slave heater changed state
+    unsigned long heater_confirmed;  // answers that confirmed the heater on to the master
+    double min_temperature;          // lowest temperature seen by the master
+    double max_temperature;          // highest temperature seen by the master
+    double temperature;              // last temperature seen by the master
+    double srtt;                     // smoothed round trip time of the master (sec)
+    double rto;                      // last time the master waited for an answer (sec)
+    double baud_rate;                // rate of the link after the handshake (bits/sec)
+    int heater_on;                   // last state of the heater on the slave
+    int sunlight_on;                 // last state of the sunlight on the slave
+    // latencies of every task (by TASK_X of schedule.h): from the release
+    // to the start, to the end, and of its exchange with the slave
+    struct histogram jitter[TASKS];
+    struct histogram response[TASKS];
+    struct histogram round_trip[TASKS];
+};
+
+//---------------------------------------------------------------------------
+//                           MAIN FUNCTIONS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: sim_default_config
+ *********************************************************/
+void sim_default_config(struct sim_config *config);
+
+/**********************************************************
+ *  Function: sim_run
+ *********************************************************/
+int sim_run(const struct sim_config *config, struct sim_stats *stats);
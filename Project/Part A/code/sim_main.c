@@ -0,0 +1,134 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim.h"
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+#define SECONDS_PER_DAY 86400.0
+
+/**********************************************************
+ *  PRIVATE STATUS (STATIC GLOBAL VARIABLES)
+ **********************************************************/
+
+// names of the tasks of schedule.h
+static const char *task_names[TASKS] = {
+    [TASK_A] = "Task A", [TASK_B] = "Task B", [TASK_C] = "Task C",
+    [TASK_D] = "Task D", [TASK_E] = "Task E", [TASK_F] = "Task F"};
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+// usage: sim_mission [days] [baud rate] [speed] [verbose] [capture file] [error rate]
+//                    [window] [batch] [max baud rate] [line baud rate] [subscribe]
+//                    [overrun policy: 0 skip, 1 catch up, 2 degrade] [adaptive]
+int main(int argc, char **argv)
+{
+    struct sim_config config;
+    struct sim_stats stats;
+
+    sim_default_config(&config);
+    if (argc > 1)
+    {
+        config.duration = atof(argv[1]) * SECONDS_PER_DAY;
+    }
+    if (argc > 2)
+    {
+        config.baud_rate = atof(argv[2]);
+    }
+    if (argc > 3)
+    {
+        config.speed = atof(argv[3]);
+    }
+    if (argc > 4)
+    {
+        config.verbose = atoi(argv[4]);
+    }
+    if (argc > 5)
+    {
+        config.capture = (argv[5][0] != '\0') ? argv[5] : NULL;
+    }
+    if (argc > 6)
+    {
+        config.error_rate = atof(argv[6]);
+    }
+    if (argc > 7)
+    {
+        config.window = atoi(argv[7]);
+    }
+    if (argc > 8)
+    {
+        config.batch = atoi(argv[8]);
+    }
+    if (argc > 9)
+    {
+        config.max_baud_rate = atof(argv[9]);
+    }
+    if (argc > 10)
+    {
+        config.line_baud_rate = atof(argv[10]);
+    }
+    if (argc > 11)
+    {
+        config.subscribe = atoi(argv[11]);
+    }
+    if (argc > 12)
+    {
+        config.overrun_policy = atoi(argv[12]);
+    }
+    if (argc > 13)
+    {
+        config.adaptive = atoi(argv[13]);
+    }
+
+    if (sim_run(&config, &stats) < 0)
+    {
+        printf("ERROR: wrong simulation parameters\n");
+        return (-1);
+    }
+
+    printf("Simulated time: %.3f sec\n", stats.sim_time);
+    printf("Jobs: %lu\n", stats.jobs);
+    printf("Deadline misses: %lu\n", stats.deadline_misses);
+    printf("Overruns: %lu\n", stats.overruns);
+    printf("Shed releases: %lu\n", stats.shed_releases);
+    printf("Skipped reads: %lu\n", stats.skipped_reads);
+    printf("Max response: %.3f sec\n", stats.max_response);
+    printf("Commands: %lu\n", stats.commands);
+    printf("Slave loops: %lu\n", stats.slave_loops);
+    printf("Bytes to slave: %lu\n", stats.bytes_to_slave);
+    printf("Bytes to master: %lu\n", stats.bytes_to_master);
+    printf("Frame errors: %lu\n", stats.frame_errors);
+    printf("Retransmits: %lu\n", stats.retransmits);
+    printf("Failed commands: %lu\n", stats.failed_commands);
+    printf("Pushes: %lu\n", stats.pushes);
+    printf("Heater switches: %lu\n", stats.heater_switches);
+    printf("Heater confirmed on: %lu\n", stats.heater_confirmed);
+    printf("Baud rate: %.0f\n", stats.baud_rate);
+    printf("Round trip: %.3f sec (timeout %.3f sec)\n", stats.srtt, stats.rto);
+    printf("Temperature: %.2f (min %.2f, max %.2f)\n", stats.temperature,
+           stats.min_temperature, stats.max_temperature);
+    printf("Heater: %s\n", (stats.heater_on ? "ON" : "OFF"));
+    printf("Sunlight: %s\n", (stats.sunlight_on ? "ON" : "OFF"));
+
+    // latencies of every task, highest priority first
+    for (int i = 0; i < TASKS; i++)
+    {
+        char name[32];
+
+        snprintf(name, sizeof(name), "%s jitter", task_names[i]);
+        histogram_print(stdout, name, &stats.jitter[i]);
+        snprintf(name, sizeof(name), "%s response", task_names[i]);
+        histogram_print(stdout, name, &stats.response[i]);
+        snprintf(name, sizeof(name), "%s round trip", task_names[i]);
+        histogram_print(stdout, name, &stats.round_trip[i]);
+    }
+
+    return (0);
+}
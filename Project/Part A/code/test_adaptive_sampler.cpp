@@ -0,0 +1,104 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+
+extern "C"
+{
+#include "adaptive_sampler.h"
+}
+
+/**********************************************************
+ *  Test: adaptive_sampler_crossing -> rates
+ *********************************************************/
+TEST(test_adaptive_sampler_crossing, rates)
+{
+    struct adaptive_sampler sampler;
+
+    ASSERT_EQ(0, adaptive_sampler_init(&sampler, 40.0, 2 * NS_PER_S, 8 * NS_PER_S));
+
+    // below the setpoint it rises, above it falls
+    ASSERT_EQ(4 * NS_PER_S, adaptive_sampler_crossing(&sampler, 20.0, 5.0, 10.0));
+    ASSERT_EQ(2 * NS_PER_S, adaptive_sampler_crossing(&sampler, 60.0, 5.0, 10.0));
+    ASSERT_EQ(0, adaptive_sampler_crossing(&sampler, 40.0, 5.0, 10.0));
+
+    // never moving towards it
+    ASSERT_EQ(INT64_MAX, adaptive_sampler_crossing(&sampler, 20.0, -5.0, 10.0));
+    ASSERT_EQ(INT64_MAX, adaptive_sampler_crossing(&sampler, 60.0, 5.0, 0.0));
+
+    ASSERT_EQ(-1, adaptive_sampler_init(&sampler, 40.0, 0, 8 * NS_PER_S));
+    ASSERT_EQ(-1, adaptive_sampler_init(&sampler, 40.0, 2 * NS_PER_S, NS_PER_S));
+}
+
+/**********************************************************
+ *  Test: adaptive_sampler_due -> period
+ *********************************************************/
+TEST(test_adaptive_sampler_due, period)
+{
+    struct adaptive_sampler sampler;
+
+    ASSERT_EQ(0, adaptive_sampler_init(&sampler, 40.0, 2 * NS_PER_S, 8 * NS_PER_S));
+
+    // the first release always reads
+    ASSERT_EQ(1, adaptive_sampler_due(&sampler, 0));
+
+    // 5 s to cross: the release at 2 s reads nothing and the one at 4 s,
+    // the last before the crossing, reads
+    adaptive_sampler_update(&sampler, 15.0, 5.0, 10.0, 0);
+    ASSERT_EQ(5 * NS_PER_S, sampler.period);
+    ASSERT_EQ(0, adaptive_sampler_due(&sampler, 2 * NS_PER_S));
+    ASSERT_EQ(1, adaptive_sampler_due(&sampler, 4 * NS_PER_S));
+
+    // close to the setpoint every release reads
+    adaptive_sampler_update(&sampler, 39.0, 5.0, 10.0, 4 * NS_PER_S);
+    ASSERT_EQ(2 * NS_PER_S, sampler.period);
+    ASSERT_EQ(1, adaptive_sampler_due(&sampler, 6 * NS_PER_S));
+
+    // far from it, never longer than the maximum
+    adaptive_sampler_update(&sampler, 20.0, -5.0, 10.0, 6 * NS_PER_S);
+    ASSERT_EQ(8 * NS_PER_S, sampler.period);
+    for (int i = 1; i < 4; i++)
+    {
+        ASSERT_EQ(0, adaptive_sampler_due(&sampler, (6 + 2 * i) * NS_PER_S));
+    }
+    ASSERT_EQ(1, adaptive_sampler_due(&sampler, 14 * NS_PER_S));
+    ASSERT_EQ(4UL, sampler.reads);
+    ASSERT_EQ(4UL, sampler.skips);
+}
+
+/**********************************************************
+ *  Test: adaptive_sampler_due -> no_late_reading
+ *********************************************************/
+TEST(test_adaptive_sampler_due, no_late_reading)
+{
+    struct adaptive_sampler sampler;
+
+    ASSERT_EQ(0, adaptive_sampler_init(&sampler, 40.0, 2 * NS_PER_S, 60 * NS_PER_S));
+
+    // whatever the distance, no release after the crossing is skipped
+    for (double temperature = -50.0; temperature <= 130.0; temperature += 0.7)
+    {
+        int64_t crossing = adaptive_sampler_crossing(&sampler, temperature, 5.0, 10.0);
+        int64_t release = 2 * NS_PER_S;
+
+        adaptive_sampler_update(&sampler, temperature, 5.0, 10.0, 0);
+        while (!adaptive_sampler_due(&sampler, release))
+        {
+            ASSERT_LT(release, crossing);
+            release += 2 * NS_PER_S;
+        }
+        ASSERT_LE(release, (crossing > 2 * NS_PER_S) ? crossing : 2 * NS_PER_S);
+    }
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <thread>
+#include <vector>
 
 extern "C"
 {
@@ -113,6 +115,275 @@ TEST(ArduinoTest, ExecCmdMsgTest)
     EXPECT_EQ(next_res_msg.cmd, READ_TEMP_CMD);
 }
 
+/**********************************************************
+ *  Batch command test
+ *********************************************************/
+TEST(ArduinoTest, BatchCmd)
+{
+    // Test setting the heater and reading the state at once
+    last_cmd_msg.cmd = BATCH_CMD;
+    last_cmd_msg.set_heater = 0;
+    last_cmd_msg.batch = BATCH_SET_HEAT | BATCH_READ_TEMP | BATCH_READ_POS | 0x80;
+    heater_on = 1;
+
+    exec_cmd_msg();
+
+    // Check if the heater is turned off
+    EXPECT_EQ(heater_on, 0);
+    // Check if a single answer carries every part known
+    EXPECT_EQ(next_res_msg.status, 1);
+    EXPECT_EQ(next_res_msg.cmd, BATCH_CMD);
+    EXPECT_EQ(next_res_msg.data.batch.batch, BATCH_SET_HEAT | BATCH_READ_TEMP | BATCH_READ_POS);
+    EXPECT_EQ(next_res_msg.data.batch.heater_on, 0);
+    EXPECT_FLOAT_EQ(next_res_msg.data.batch.temperature, (float)temperature);
+    EXPECT_FLOAT_EQ(next_res_msg.data.batch.position.z, position.z);
+    last_cmd_msg.batch = 0;
+}
+
+/**********************************************************
+ *  Hello command test
+ *********************************************************/
+TEST(ArduinoTest, HelloCmd)
+{
+    // Test agreeing on the capabilities of the link
+    last_cmd_msg.cmd = HELLO_CMD;
+    last_cmd_msg.data.hello.version = PROTOCOL_VERSION;
+    last_cmd_msg.data.hello.features = FEATURE_BATCH | FEATURE_WINDOW | 0x80;
+    last_cmd_msg.data.hello.baud = 200000;
+
+    exec_cmd_msg();
+
+    // Check if the fastest rate not above the one asked is agreed
+    EXPECT_EQ(next_res_msg.status, 1);
+    EXPECT_EQ(next_res_msg.cmd, HELLO_CMD);
+    EXPECT_EQ(next_res_msg.data.hello.version, PROTOCOL_VERSION);
+    EXPECT_EQ(next_res_msg.data.hello.features, FEATURE_BATCH | FEATURE_WINDOW);
+    EXPECT_EQ(next_res_msg.data.hello.baud, 115200U);
+
+    // Check if a master of another version keeps the first rate
+    last_cmd_msg.data.hello.version = PROTOCOL_VERSION + 1;
+
+    exec_cmd_msg();
+
+    EXPECT_EQ(next_res_msg.data.hello.features, 0);
+    EXPECT_EQ(next_res_msg.data.hello.baud, 9600U);
+    memset(&last_cmd_msg, 0, sizeof(struct cmd_msg));
+}
+
+/**********************************************************
+ *  Telemetry push test
+ *********************************************************/
+TEST(ArduinoTest, PushTelemetry)
+{
+    struct sat_ctx ctx;
+    struct res_msg push;
+
+    // Test subscribing to the sunlight and the temperature
+    sat_ctx_init(&ctx);
+    ctx.temperature = 20.0;
+    ctx.last_cmd_msg.cmd = SUBSCRIBE_CMD;
+    ctx.last_cmd_msg.data.subscription.parts = BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_SET_HEAT;
+    ctx.last_cmd_msg.data.subscription.period = 60000;
+    ctx.last_cmd_msg.data.subscription.delta = 1.0;
+
+    exec_cmd_msg_ctx(&ctx);
+
+    EXPECT_EQ(ctx.next_res_msg.status, 1);
+    EXPECT_EQ(ctx.next_res_msg.cmd, SUBSCRIBE_CMD);
+    EXPECT_EQ(ctx.subscription.parts, BATCH_READ_SUN | BATCH_READ_TEMP);
+
+    // Check if the first push goes out at once and then waits for a change
+    ASSERT_EQ(1, push_telemetry_ctx(&ctx, &push));
+    EXPECT_EQ(push.cmd, TELEMETRY_CMD);
+    EXPECT_EQ(push.data.batch.batch, BATCH_READ_SUN | BATCH_READ_TEMP);
+    EXPECT_FLOAT_EQ(push.data.batch.temperature, 20.0);
+    EXPECT_EQ(0, push_telemetry_ctx(&ctx, &push));
+    ctx.temperature = 20.5;
+    EXPECT_EQ(0, push_telemetry_ctx(&ctx, &push));
+    ctx.temperature = 21.5;
+    ASSERT_EQ(1, push_telemetry_ctx(&ctx, &push));
+    EXPECT_FLOAT_EQ(push.data.batch.temperature, 21.5);
+    ctx.sunlight_on = 1;
+    ASSERT_EQ(1, push_telemetry_ctx(&ctx, &push));
+    EXPECT_EQ(push.data.batch.sunlight_on, 1);
+
+    // Check if nothing is pushed without a subscription
+    ctx.last_cmd_msg.data.subscription.parts = 0;
+    exec_cmd_msg_ctx(&ctx);
+    ctx.temperature = 30.0;
+    EXPECT_EQ(0, push_telemetry_ctx(&ctx, &push));
+}
+
+/**********************************************************
+ *  NACK answer test
+ *********************************************************/
+TEST(ArduinoTest, KeepNack)
+{
+    // comm_server received a wrong frame and prepared a NACK
+    last_cmd_msg.cmd = NO_CMD;
+    next_res_msg.cmd = NO_CMD;
+    next_res_msg.status = STATUS_NACK;
+
+    exec_cmd_msg();
+
+    // Check if the NACK is not overwritten
+    EXPECT_EQ(next_res_msg.status, STATUS_NACK);
+    EXPECT_EQ(next_res_msg.cmd, NO_CMD);
+    next_res_msg.status = 0;
+}
+
+/**********************************************************
+ *  Command queue test
+ *********************************************************/
+static void queue_frame(const struct sat_ctx *ctx, struct cmd_queue *queue, const struct cmd_msg *msg, int wrong)
+{
+    unsigned char frame[FRAME_MAX_SIZE];
+    int size = frame_close(frame, encode_cmd_msg(msg, frame + 1));
+
+    // a byte flipped on the wire
+    if (wrong)
+    {
+        frame[size - 2] = (frame[size - 2] == 0x55) ? 0x56 : 0x55;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        cmd_queue_byte_ctx(ctx, queue, frame[i]);
+    }
+}
+
+TEST(ArduinoTest, CmdQueue)
+{
+    struct sat_ctx ctx;
+    struct cmd_queue queue;
+    struct cmd_msg msg = {};
+    struct res_msg res;
+    struct frame_parser parser = {};
+    unsigned char frame[FRAME_MAX_SIZE];
+    uint32_t rate = 0;
+    int size;
+
+    sat_ctx_init(&ctx);
+    cmd_queue_init(&queue);
+    ctx.sunlight_on = 1;
+
+    // Test a request for the slave, then one for another slave and a wrong
+    // frame of that talk, which is not NACKed
+    msg.addr = DEFAULT_ADDR;
+    msg.cmd = READ_SUN_CMD;
+    msg.seq = 5;
+    queue_frame(&ctx, &queue, &msg, 0);
+    msg.addr = DEFAULT_ADDR + 1;
+    queue_frame(&ctx, &queue, &msg, 0);
+    queue_frame(&ctx, &queue, &msg, 1);
+    EXPECT_EQ(1, queue.count);
+    EXPECT_EQ(0, queue.addressed);
+
+    // Check if a wrong frame is NACKed once the master talks to the slave
+    msg.addr = DEFAULT_ADDR;
+    msg.cmd = HELLO_CMD;
+    msg.seq = 6;
+    msg.data.hello.version = PROTOCOL_VERSION;
+    msg.data.hello.baud = 115200;
+    queue_frame(&ctx, &queue, &msg, 0);
+    queue_frame(&ctx, &queue, &msg, 1);
+    ASSERT_EQ(3, queue.count);
+
+    // Check if the answers keep the order and the seq of the requests
+    cmd_queue_exec_ctx(&ctx, &queue);
+    size = cmd_queue_answer(&queue, 0, frame, &rate);
+    for (int i = 0; i < size - 1; i++)
+    {
+        frame_parse_byte(&parser, frame[i]);
+    }
+    ASSERT_EQ(FRAME_COMPLETE, frame_parse_byte(&parser, frame[size - 1]));
+    ASSERT_EQ(parser.size, decode_res_msg(parser.message, parser.size, &res));
+    EXPECT_EQ(res.cmd, READ_SUN_CMD);
+    EXPECT_EQ(res.seq, 5);
+    EXPECT_EQ(res.data.sunlight_on, 1);
+    EXPECT_EQ(0U, rate);
+    ASSERT_GT(cmd_queue_answer(&queue, 1, frame, &rate), 0);
+    EXPECT_EQ(115200U, rate);
+    EXPECT_EQ(queue.res[2].status, STATUS_NACK);
+
+    // Check if a broadcast is executed but never answered
+    queue.count = 0;
+    msg.addr = BROADCAST_ADDR;
+    msg.cmd = SET_HEAT_CMD;
+    msg.set_heater = 1;
+    queue_frame(&ctx, &queue, &msg, 0);
+    cmd_queue_exec_ctx(&ctx, &queue);
+    EXPECT_EQ(ctx.heater_on, 1);
+    EXPECT_EQ(0, cmd_queue_answer(&queue, 0, frame, &rate));
+}
+
+/**********************************************************
+ *  Independent contexts test
+ *********************************************************/
+TEST(ArduinoTest, IndependentContexts)
+{
+    struct sat_ctx first;
+    struct sat_ctx second;
+
+    sat_ctx_init(&first);
+    sat_ctx_init(&second);
+
+    // Set the heater on only in the first satellite
+    first.last_cmd_msg.cmd = SET_HEAT_CMD;
+    first.last_cmd_msg.set_heater = 1;
+    exec_cmd_msg_ctx(&first);
+
+    EXPECT_EQ(first.heater_on, 1);
+    EXPECT_EQ(first.next_res_msg.cmd, SET_HEAT_CMD);
+    EXPECT_EQ(second.heater_on, 0);
+    EXPECT_EQ(second.next_res_msg.cmd, NO_CMD);
+
+    // Read the sunlight of the second satellite only
+    second.sunlight_on = 1;
+    second.last_cmd_msg.cmd = READ_SUN_CMD;
+    exec_cmd_msg_ctx(&second);
+
+    EXPECT_EQ(second.next_res_msg.data.sunlight_on, 1);
+    EXPECT_EQ(first.next_res_msg.cmd, SET_HEAT_CMD);
+}
+
+/**********************************************************
+ *  Contexts in parallel threads test
+ *********************************************************/
+TEST(ArduinoTest, ParallelContexts)
+{
+    const int satellites = 8;
+    std::vector<struct sat_ctx> ctx(satellites);
+    std::vector<std::thread> threads;
+
+    // Each thread switches the heater of its own satellite many times
+    for (int i = 0; i < satellites; i++)
+    {
+        sat_ctx_init(&ctx[i]);
+        threads.push_back(std::thread([&ctx, i]()
+                                      {
+            for (int n = 0; n < 10000; n++)
+            {
+                ctx[i].last_cmd_msg.cmd = SET_HEAT_CMD;
+                ctx[i].last_cmd_msg.set_heater = (n + i) % 2;
+                exec_cmd_msg_ctx(&ctx[i]);
+                ctx[i].last_cmd_msg.cmd = READ_POS_CMD;
+                exec_cmd_msg_ctx(&ctx[i]);
+            } }));
+    }
+    for (int i = 0; i < satellites; i++)
+    {
+        threads[i].join();
+    }
+
+    // Every satellite ends with the state of its own last command
+    for (int i = 0; i < satellites; i++)
+    {
+        EXPECT_EQ(ctx[i].heater_on, (9999 + i) % 2);
+        EXPECT_EQ(ctx[i].next_res_msg.cmd, READ_POS_CMD);
+        EXPECT_EQ(ctx[i].next_res_msg.status, 1);
+    }
+}
+
 /**********************************************************
  *  Main function
  *********************************************************/
@@ -0,0 +1,318 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+#include "satellite.hpp"
+
+extern "C"
+{
+#include "clock.h"
+}
+
+/**********************************************************
+ *  Emulated slaves of the tests
+ *********************************************************/
+// answers every request in order with fixed readings, until the link is
+// closed (the model of the slave cannot be linked with the master): the
+// temperature is cold and hot in turns, cold first; the first nacks
+// requests are NACKed as if received wrong
+static void emulated_slave(int fd, int nacks = 0)
+{
+    struct link_reader reader;
+    int temps = 0;
+    int ret;
+
+    link_reader_init(&reader, fd);
+    while ((ret = link_read_frame(&reader, -1)) != LINK_READ_CLOSED)
+    {
+        struct cmd_msg cmd;
+        struct res_msg res;
+        unsigned char frame[FRAME_MAX_SIZE];
+
+        if (ret == LINK_READ_WRONG || decode_cmd_msg(reader.parser.message, ret, &cmd) < 0)
+        {
+            continue;
+        }
+        memset(&res, 0, sizeof(struct res_msg));
+        res.addr = cmd.addr;
+        if (nacks > 0)
+        {
+            nacks--;
+            res.status = STATUS_NACK;
+        }
+        else
+        {
+            res.seq = cmd.seq;
+            res.cmd = cmd.cmd;
+            res.status = STATUS_DONE;
+        }
+        if (res.cmd == READ_TEMP_CMD)
+        {
+            res.data.temperature = (temps++ % 2 == 0) ? 21.5f : 60.0f;
+        }
+        else if (res.cmd == READ_POS_CMD)
+        {
+            res.data.position = {1.0f, 2.0f, 3.0f};
+        }
+        if (link_write_all(fd, frame, frame_close(frame, encode_res_msg(&res, frame + 1))) < 0)
+        {
+            return;
+        }
+    }
+}
+
+struct slaves
+{
+    std::vector<int> fds;
+    std::vector<int> slave_fds;
+    std::vector<std::thread> threads;
+
+    explicit slaves(int links)
+    {
+        for (int l = 0; l < links; l++)
+        {
+            int pair[2];
+
+            EXPECT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+            fds.push_back(pair[0]);
+            slave_fds.push_back(pair[1]);
+            threads.push_back(std::thread([fd = pair[1]]()
+                                          { emulated_slave(fd); }));
+        }
+    }
+
+    ~slaves()
+    {
+        for (size_t l = 0; l < fds.size(); l++)
+        {
+            close(fds[l]);
+            threads[l].join();
+            close(slave_fds[l]);
+        }
+    }
+};
+
+// results of the callbacks
+struct ended
+{
+    int count;
+    int result;
+    unsigned char cmd;
+};
+
+static void count_end(void *arg, int result, const struct res_msg *res)
+{
+    struct ended *ended = (struct ended *)arg;
+
+    ended->count++;
+    ended->result = result;
+    ended->cmd = (res != NULL) ? res->cmd : (unsigned char)NO_CMD;
+}
+
+/**********************************************************
+ *  Test: execute_cmd_async -> callbacks
+ *********************************************************/
+TEST(test_execute_cmd_async, callbacks)
+{
+    struct slaves slave(1);
+    struct async_link link;
+    struct event_loop loop;
+    struct ended temp = {0, 0, 0};
+    struct ended pos = {0, 0, 0};
+
+    async_link_init(&link, slave.fds[0], NS_PER_S);
+    event_loop_init(&loop);
+    ASSERT_EQ(0, event_loop_add(&loop, &link));
+
+    // both requests out before any answer
+    ASSERT_EQ(0, execute_cmd_async(&link, READ_TEMP_CMD, count_end, &temp));
+    ASSERT_EQ(0, execute_cmd_async(&link, READ_POS_CMD, count_end, &pos));
+    ASSERT_EQ(2, event_loop_pending(&loop));
+    event_loop_run(&loop);
+
+    ASSERT_EQ(1, temp.count);
+    ASSERT_EQ(ASYNC_DONE, temp.result);
+    ASSERT_EQ(READ_TEMP_CMD, temp.cmd);
+    ASSERT_EQ(1, pos.count);
+    ASSERT_EQ(READ_POS_CMD, pos.cmd);
+    ASSERT_EQ(21.5, link.ctx.temperature);
+    ASSERT_EQ(3.0f, link.ctx.position.z);
+
+    // no room beyond the queue of the slave
+    for (int i = 0; i < ASYNC_MAX_PENDING; i++)
+    {
+        ASSERT_EQ(0, execute_cmd_async(&link, READ_SUN_CMD, count_end, &temp));
+    }
+    ASSERT_EQ(-1, execute_cmd_async(&link, READ_SUN_CMD, count_end, &temp));
+    event_loop_run(&loop);
+    ASSERT_EQ(1 + ASYNC_MAX_PENDING, temp.count);
+}
+
+/**********************************************************
+ *  Test: execute_cmd_async -> timeout_and_close
+ *********************************************************/
+TEST(test_execute_cmd_async, timeout_and_close)
+{
+    struct async_link link;
+    struct event_loop loop;
+    struct ended ended = {0, 0, 0};
+    int pair[2];
+
+    // a slave that never answers
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    async_link_init(&link, pair[0], 50 * NS_PER_MS);
+    event_loop_init(&loop);
+    event_loop_add(&loop, &link);
+
+    int64_t start = clock_now_ns();
+    ASSERT_EQ(0, execute_cmd_async(&link, READ_TEMP_CMD, count_end, &ended));
+    event_loop_run(&loop);
+    ASSERT_EQ(1, ended.count);
+    ASSERT_EQ(ASYNC_TIMEOUT, ended.result);
+    ASSERT_GE(clock_now_ns() - start, 50 * NS_PER_MS);
+
+    // its answer comes too late and changes nothing
+    struct res_msg late;
+    unsigned char frame[FRAME_MAX_SIZE];
+
+    memset(&late, 0, sizeof(struct res_msg));
+    late.addr = DEFAULT_ADDR;
+    late.cmd = READ_TEMP_CMD;
+    late.status = STATUS_DONE;
+    late.data.temperature = 21.5f;
+    ASSERT_EQ(0, link_write_all(pair[1], frame, frame_close(frame, encode_res_msg(&late, frame + 1))));
+    event_loop_run_once(&loop, clock_now_ns() + 50 * NS_PER_MS);
+    ASSERT_EQ(1, ended.count);
+    ASSERT_NE(21.5, link.ctx.temperature);
+
+    // and then goes away
+    ASSERT_EQ(0, execute_cmd_async(&link, READ_TEMP_CMD, count_end, &ended));
+    close(pair[1]);
+    event_loop_run(&loop);
+    ASSERT_EQ(2, ended.count);
+    ASSERT_EQ(ASYNC_CLOSED, ended.result);
+    close(pair[0]);
+}
+
+/**********************************************************
+ *  Test: execute_cmd_async -> nack
+ *********************************************************/
+TEST(test_execute_cmd_async, nack)
+{
+    struct async_link link;
+    struct event_loop loop;
+    struct ended ended = {0, 0, 0};
+    int pair[2];
+
+    // a slave that gets the first request wrong: it is sent again
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    std::thread slave([fd = pair[1]]()
+                      { emulated_slave(fd, 1); });
+    async_link_init(&link, pair[0], NS_PER_S);
+    event_loop_init(&loop);
+    event_loop_add(&loop, &link);
+    ASSERT_EQ(0, execute_cmd_async(&link, READ_TEMP_CMD, count_end, &ended));
+    event_loop_run(&loop);
+    ASSERT_EQ(1, ended.count);
+    ASSERT_EQ(ASYNC_DONE, ended.result);
+    ASSERT_EQ(READ_TEMP_CMD, ended.cmd);
+    ASSERT_EQ(21.5, link.ctx.temperature);
+    close(pair[0]);
+    slave.join();
+    close(pair[1]);
+
+    // and one that gets it wrong every time: it fails, never done
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    slave = std::thread([fd = pair[1]]()
+                        { emulated_slave(fd, 1 + ASYNC_MAX_RESENDS); });
+    async_link_init(&link, pair[0], NS_PER_S);
+    event_loop_init(&loop);
+    event_loop_add(&loop, &link);
+    ASSERT_EQ(0, execute_cmd_async(&link, READ_TEMP_CMD, count_end, &ended));
+    event_loop_run(&loop);
+    ASSERT_EQ(2, ended.count);
+    ASSERT_EQ(ASYNC_NACK, ended.result);
+    close(pair[0]);
+    slave.join();
+    close(pair[1]);
+}
+
+/**********************************************************
+ *  Coroutine of the tests: controls the heater of a satellite
+ *********************************************************/
+static sat_task control(satellite &sat, int cycles, int *done)
+{
+    for (int i = 0; i < cycles; i++)
+    {
+        struct command_result temp = co_await sat.command(READ_TEMP_CMD);
+        if (temp.result != ASYNC_DONE)
+        {
+            co_return;
+        }
+        control_temperature_ctx(&sat.state());
+        int heater = sat.state().heater_on;
+        struct command_result heat = co_await sat.command(SET_HEAT_CMD);
+        if (heat.result != ASYNC_DONE)
+        {
+            co_return;
+        }
+        // the heater as sent, off too, once the slave has done it (40 C is
+        // the setpoint of ctrl_ctx.c)
+        EXPECT_EQ((sat.state().temperature < 40.0) ? 1 : 0, heater);
+        EXPECT_EQ(heater, sat.state().heater_on);
+        (*done)++;
+    }
+}
+
+/**********************************************************
+ *  Test: satellite_command -> coroutines
+ *********************************************************/
+TEST(test_satellite_command, coroutines)
+{
+    const int links = 4;
+    const int cycles = 20;
+    struct slaves slave(links);
+    struct async_link link[links];
+    std::vector<satellite> sats;
+    struct event_loop loop;
+    int done[links] = {0};
+
+    // a single thread keeps a command out on every link at once
+    event_loop_init(&loop);
+    for (int l = 0; l < links; l++)
+    {
+        async_link_init(&link[l], slave.fds[l], NS_PER_S);
+        event_loop_add(&loop, &link[l]);
+        sats.push_back(satellite(&link[l]));
+    }
+    for (int l = 0; l < links; l++)
+    {
+        control(sats[l], cycles, &done[l]);
+    }
+    ASSERT_EQ(links, event_loop_pending(&loop));
+    event_loop_run(&loop);
+
+    for (int l = 0; l < links; l++)
+    {
+        ASSERT_EQ(cycles, done[l]);
+        // the last cycle read it hot
+        ASSERT_EQ(60.0, link[l].ctx.temperature);
+        ASSERT_EQ(0, link[l].ctx.heater_on);
+    }
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
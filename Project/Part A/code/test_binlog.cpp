@@ -0,0 +1,162 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <thread>
+
+extern "C"
+{
+#include "clock.h"
+#include "binlog.h"
+}
+
+/**********************************************************
+ *  Formatters of the tests
+ *********************************************************/
+static void format_value(FILE *file, const struct binlog_record *record)
+{
+    fprintf(file, "%lld:%.1f\n", (long long)record->time, record->args[0]);
+}
+
+static void format_sum(FILE *file, const struct binlog_record *record)
+{
+    fprintf(file, "%.1f\n", record->args[0] + record->args[1] + record->args[2] + record->args[3]);
+}
+
+static const binlog_formatter formatters[] = {format_value, format_sum};
+
+/**********************************************************
+ *  Test: binlog_drain -> formats_in_order
+ *********************************************************/
+TEST(test_binlog_drain, formats_in_order)
+{
+    static struct binlog_ring ring;
+    char *text;
+    size_t size;
+    FILE *file = open_memstream(&text, &size);
+
+    binlog_init(&ring);
+    ASSERT_EQ(1, binlog_write(&ring, 10, 0, 1.5, 0, 0, 0));
+    ASSERT_EQ(1, binlog_write(&ring, 20, 1, 1, 2, 3, 4));
+    ASSERT_EQ(2, binlog_drain(&ring, formatters, file));
+    ASSERT_EQ(0, binlog_drain(&ring, formatters, file));
+    fclose(file);
+
+    ASSERT_STREQ("10:1.5\n10.0\n", text);
+    free(text);
+}
+
+/**********************************************************
+ *  Test: binlog_write -> drops_when_full
+ *********************************************************/
+TEST(test_binlog_write, drops_when_full)
+{
+    static struct binlog_ring ring;
+    FILE *file = fopen("/dev/null", "w");
+
+    // the thread that logs never waits for the drain
+    binlog_init(&ring);
+    for (int i = 0; i < BINLOG_RING_SIZE; i++)
+    {
+        ASSERT_EQ(1, binlog_write(&ring, i, 0, i, 0, 0, 0));
+    }
+    ASSERT_EQ(0U, ring.dropped);
+    ASSERT_EQ(0, binlog_write(&ring, 0, 0, 0, 0, 0, 0));
+    ASSERT_EQ(1U, ring.dropped);
+
+    // room again once drained
+    ASSERT_EQ(BINLOG_RING_SIZE, binlog_drain(&ring, formatters, file));
+    ASSERT_EQ(1, binlog_write(&ring, 0, 0, 0, 0, 0, 0));
+    fclose(file);
+}
+
+/**********************************************************
+ *  Test: binlog_write -> concurrent_drain
+ *********************************************************/
+TEST(test_binlog_write, concurrent_drain)
+{
+    static struct binlog_ring ring;
+    const int records = 200000;
+    int written = 0;
+    int drained = 0;
+    char *text;
+    size_t size;
+    FILE *file = open_memstream(&text, &size);
+
+    binlog_init(&ring);
+    std::thread drain([&]()
+    {
+        while (drained + (int)__atomic_load_n(&ring.dropped, __ATOMIC_RELAXED) < records)
+        {
+            drained += binlog_drain(&ring, formatters, file);
+        }
+    });
+
+    // every record logged is drained whole and in order, or counted as dropped
+    for (int i = 0; i < records; i++)
+    {
+        written += binlog_write(&ring, i, 0, i, 0, 0, 0);
+    }
+    drain.join();
+    fclose(file);
+
+    ASSERT_EQ(written, drained);
+    ASSERT_EQ((unsigned)(records - written), ring.dropped);
+    long long last = -1;
+    for (char *line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n"))
+    {
+        long long time;
+        double value;
+
+        ASSERT_EQ(2, sscanf(line, "%lld:%lf", &time, &value));
+        ASSERT_GT(time, last);
+        ASSERT_EQ((double)time, value);
+        last = time;
+    }
+    free(text);
+}
+
+/**********************************************************
+ *  Test: binlog_write -> cost
+ *********************************************************/
+TEST(test_binlog_write, cost)
+{
+    static struct binlog_ring ring;
+    FILE *file = fopen("/dev/null", "w");
+    int64_t best = INT64_MAX;
+
+    // the best of many rounds of a whole ring, a loaded machine only
+    // slows down some of them
+    for (int round = 0; round < 100; round++)
+    {
+        binlog_init(&ring);
+        int64_t start = clock_now_ns();
+        for (int i = 0; i < BINLOG_RING_SIZE; i++)
+        {
+            binlog_write(&ring, i, 0, i, 0, 0, 0);
+        }
+        int64_t elapsed = clock_now_ns() - start;
+        best = (elapsed < best) ? elapsed : best;
+        ASSERT_EQ(BINLOG_RING_SIZE, binlog_drain(&ring, formatters, file));
+    }
+    fclose(file);
+
+    // well under 100 ns per record, ten times that without optimizations
+#if defined(__OPTIMIZE__)
+    ASSERT_LT(best / BINLOG_RING_SIZE, 100);
+#else
+    ASSERT_LT(best / BINLOG_RING_SIZE, 1000);
+#endif
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,105 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+
+extern "C"
+{
+#include "clock.h"
+}
+
+/**********************************************************
+ *  Test: clock_now_ns -> monotonic
+ *********************************************************/
+TEST(test_clock_now_ns, monotonic)
+{
+    int64_t first = clock_now_ns();
+    int64_t second = clock_now_ns();
+
+    ASSERT_GT(first, 0);
+    ASSERT_GE(second, first);
+}
+
+/**********************************************************
+ *  Test: clock_sleep -> real_time
+ *********************************************************/
+TEST(test_clock_sleep, real_time)
+{
+    int64_t start = clock_now_ns();
+
+    clock_sleep(2 * NS_PER_MS);
+
+    ASSERT_GE(clock_now_ns() - start, 2 * NS_PER_MS);
+}
+
+/**********************************************************
+ *  Test: clock_thread_cpu_ns -> counts_work_not_sleep
+ *********************************************************/
+TEST(test_clock_thread_cpu_ns, counts_work_not_sleep)
+{
+    int64_t start = clock_thread_cpu_ns();
+    volatile unsigned long sum = 0;
+
+    clock_sleep(20 * NS_PER_MS);
+    ASSERT_LT(clock_thread_cpu_ns() - start, 10 * NS_PER_MS);
+
+    // a busy loop is counted
+    start = clock_thread_cpu_ns();
+    for (unsigned long i = 0; i < 10000000UL; i++)
+    {
+        sum += i;
+    }
+    ASSERT_GT(clock_thread_cpu_ns() - start, 0);
+}
+
+/**********************************************************
+ *  Test: clock_virtual -> sleep_advances_time
+ *********************************************************/
+TEST(test_clock_virtual, sleep_advances_time)
+{
+    int64_t start = clock_monotonic_ns();
+
+    clock_virtual_start(0);
+    ASSERT_EQ(0, clock_now_ns());
+
+    // a virtual day passes without waiting
+    clock_sleep(86400LL * NS_PER_S);
+    ASSERT_EQ(86400LL * NS_PER_S, clock_now_ns());
+
+    // virtual time never goes backwards
+    clock_virtual_set(NS_PER_S);
+    ASSERT_EQ(86400LL * NS_PER_S, clock_now_ns());
+
+    clock_virtual_stop();
+    ASSERT_LT(clock_monotonic_ns() - start, NS_PER_S);
+    ASSERT_GE(clock_now_ns(), start);
+}
+
+/**********************************************************
+ *  Test: clock_set_source -> custom_source
+ *********************************************************/
+static int64_t fixed_source(void)
+{
+    return (42);
+}
+
+TEST(test_clock_set_source, custom_source)
+{
+    clock_set_source(fixed_source);
+    ASSERT_EQ(42, clock_now_ns());
+
+    clock_set_source(NULL);
+    ASSERT_NE(42, clock_now_ns());
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,91 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+
+extern "C"
+{
+#include "clock.h"
+#include "histogram.h"
+}
+
+/**********************************************************
+ *  Test: histogram_bucket -> log_buckets
+ *********************************************************/
+TEST(test_histogram_bucket, log_buckets)
+{
+    // a bucket per value below 8, then 8 buckets per power of two
+    ASSERT_EQ(0, histogram_bucket(-5));
+    ASSERT_EQ(7, histogram_bucket(7));
+    ASSERT_EQ(8, histogram_bucket(8));
+    ASSERT_EQ(15, histogram_bucket(15));
+    ASSERT_EQ(16, histogram_bucket(16));
+    ASSERT_EQ(16, histogram_bucket(17));
+    ASSERT_EQ(HISTOGRAM_BUCKETS - 1, histogram_bucket(INT64_MAX));
+
+    // the buckets follow each other with 12.5% of precision at most
+    for (int i = 1; i < HISTOGRAM_BUCKETS; i++)
+    {
+        int64_t low = histogram_bucket_value(i);
+        int64_t high = histogram_bucket_value(i + 1) - 1;
+
+        ASSERT_EQ(i, histogram_bucket(low));
+        ASSERT_EQ(i - 1, histogram_bucket(low - 1));
+        ASSERT_LE((high - low) * 8, low);
+    }
+}
+
+/**********************************************************
+ *  Test: histogram_percentile -> latencies
+ *********************************************************/
+TEST(test_histogram_percentile, latencies)
+{
+    struct histogram histogram;
+
+    histogram_init(&histogram);
+    ASSERT_EQ(0, histogram_percentile(&histogram, 50.0));
+
+    // 99 exchanges of 200 ms and one of 2 s
+    for (int i = 0; i < 99; i++)
+    {
+        histogram_record(&histogram, 200 * NS_PER_MS);
+    }
+    histogram_record(&histogram, 2 * NS_PER_S);
+
+    ASSERT_EQ(100UL, histogram_count(&histogram));
+    ASSERT_EQ(2 * NS_PER_S, histogram.max);
+    ASSERT_GE(histogram_percentile(&histogram, 50.0), 200 * NS_PER_MS);
+    ASSERT_LT(histogram_percentile(&histogram, 99.0), 225 * NS_PER_MS);
+    ASSERT_EQ(2 * NS_PER_S, histogram_percentile(&histogram, 100.0));
+}
+
+/**********************************************************
+ *  Test: histogram_snapshot -> copy
+ *********************************************************/
+TEST(test_histogram_snapshot, copy)
+{
+    struct histogram histogram;
+    struct histogram copy;
+
+    histogram_init(&histogram);
+    histogram_record(&histogram, 1000);
+    histogram_snapshot(&histogram, &copy);
+
+    // the copy stays as it was while the histogram goes on
+    histogram_record(&histogram, 5000);
+    ASSERT_EQ(1UL, histogram_count(&copy));
+    ASSERT_EQ(1000, copy.max);
+    ASSERT_EQ(2UL, histogram_count(&histogram));
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
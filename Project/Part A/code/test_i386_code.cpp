@@ -98,6 +98,102 @@ TEST(test_send_cmd_msg, read_pos_cmd)
     next_cmd_msg.cmd = original_cmd;
 }
 
+/**********************************************************
+ *  Test: recv_res_msg -> batch_cmd
+ *********************************************************/
+TEST(test_recv_res_msg, batch_cmd)
+{
+    struct ctrl_ctx ctx;
+
+    ctrl_ctx_init(&ctx);
+    ctx.heater_on = 1;
+    ctx.temperature = 20.0;
+
+    // the heater goes with the reads in a single request
+    ctx.next_cmd_msg.batch = BATCH_SET_HEAT | BATCH_READ_SUN | BATCH_READ_POS;
+    send_cmd_msg_ctx(&ctx, BATCH_CMD);
+    ASSERT_EQ(BATCH_CMD, ctx.next_cmd_msg.cmd);
+    ASSERT_EQ(1, ctx.next_cmd_msg.set_heater);
+
+    // only the parts executed update the state
+    ctx.last_res_msg.cmd = BATCH_CMD;
+    ctx.last_res_msg.status = STATUS_DONE;
+    ctx.last_res_msg.data.batch.batch = BATCH_READ_SUN | BATCH_READ_POS;
+    ctx.last_res_msg.data.batch.sunlight_on = 1;
+    ctx.last_res_msg.data.batch.temperature = 45.0;
+    ctx.last_res_msg.data.batch.position.x = 3000.0;
+    recv_res_msg_ctx(&ctx);
+    ASSERT_EQ(1, ctx.sunlight_on);
+    ASSERT_DOUBLE_EQ(3000.0, ctx.position.x);
+    ASSERT_DOUBLE_EQ(20.0, ctx.temperature);
+    ASSERT_EQ(NO_CMD, ctx.last_res_msg.cmd);
+
+    // the heater is the one the answer carries, and only if it was done
+    ctx.last_res_msg.cmd = BATCH_CMD;
+    ctx.last_res_msg.status = STATUS_FAILED;
+    ctx.last_res_msg.data.batch.batch = BATCH_SET_HEAT;
+    ctx.last_res_msg.data.batch.heater_on = 0;
+    recv_res_msg_ctx(&ctx);
+    ASSERT_EQ(1, ctx.heater_on);
+    ctx.last_res_msg.cmd = BATCH_CMD;
+    ctx.last_res_msg.status = STATUS_DONE;
+    recv_res_msg_ctx(&ctx);
+    ASSERT_EQ(0, ctx.heater_on);
+
+    // a SET_HEAT_CMD done leaves the heater as it was sent, off too
+    ctx.heater_on = 1;
+    ctx.next_cmd_msg.set_heater = 0;
+    ctx.last_res_msg.cmd = SET_HEAT_CMD;
+    ctx.last_res_msg.status = STATUS_DONE;
+    recv_res_msg_ctx(&ctx);
+    ASSERT_EQ(0, ctx.heater_on);
+
+    // and one NACKed or failed leaves it alone
+    ctx.next_cmd_msg.set_heater = 1;
+    ctx.last_res_msg.cmd = SET_HEAT_CMD;
+    ctx.last_res_msg.status = STATUS_NACK;
+    recv_res_msg_ctx(&ctx);
+    ASSERT_EQ(0, ctx.heater_on);
+    ctx.last_res_msg.cmd = SET_HEAT_CMD;
+    ctx.last_res_msg.status = STATUS_FAILED;
+    recv_res_msg_ctx(&ctx);
+    ASSERT_EQ(0, ctx.heater_on);
+}
+
+/**********************************************************
+ *  Test: ctx -> independent_contexts
+ *********************************************************/
+TEST(test_ctx, independent_contexts)
+{
+    struct ctrl_ctx first;
+    struct ctrl_ctx second;
+
+    ctrl_ctx_init(&first);
+    ctrl_ctx_init(&second);
+
+    // only the first controller is cold
+    first.temperature = 20;
+    second.temperature = 60;
+    control_temperature_ctx(&first);
+    control_temperature_ctx(&second);
+    ASSERT_EQ(1, first.heater_on);
+    ASSERT_EQ(0, second.heater_on);
+
+    // each controller sends its own heater state
+    send_cmd_msg_ctx(&first, SET_HEAT_CMD);
+    send_cmd_msg_ctx(&second, SET_HEAT_CMD);
+    ASSERT_EQ(1, first.next_cmd_msg.set_heater);
+    ASSERT_EQ(0, second.next_cmd_msg.set_heater);
+
+    // a response only updates the controller that received it
+    first.last_res_msg.cmd = READ_TEMP_CMD;
+    first.last_res_msg.data.temperature = 45.0;
+    recv_res_msg_ctx(&first);
+    ASSERT_DOUBLE_EQ(45.0, first.temperature);
+    ASSERT_DOUBLE_EQ(60.0, second.temperature);
+    ASSERT_EQ(NO_CMD, first.last_res_msg.cmd);
+}
+
 /**********************************************************
  *  Function: main
  *********************************************************/
@@ -0,0 +1,214 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#include "arduino_code.h"
+#include "clock.h"
+#include "link_io.h"
+#include "loadgen.h"
+}
+
+/**********************************************************
+ *  Function: run_emulated
+ *********************************************************/
+// runs the load against emulated slaves connected by socket pairs
+static int run_emulated(const struct loadgen_config *config, int links,
+                        struct loadgen_report *report)
+{
+    std::vector<int> fds(links);
+    std::vector<int> slave_fds(links);
+    std::vector<std::thread> slaves;
+    int ret;
+
+    for (int l = 0; l < links; l++)
+    {
+        int pair[2];
+
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+        {
+            return (-1);
+        }
+        fds[l] = pair[0];
+        slave_fds[l] = pair[1];
+        slaves.push_back(std::thread([fd = pair[1]]()
+                                     { loadgen_slave(fd); }));
+    }
+
+    ret = loadgen_run(config, fds.data(), links, report);
+
+    for (int l = 0; l < links; l++)
+    {
+        close(fds[l]);
+        slaves[l].join();
+        close(slave_fds[l]);
+    }
+    return (ret);
+}
+
+/**********************************************************
+ *  Test: loadgen_parse_mix -> basic
+ *********************************************************/
+TEST(test_loadgen_parse_mix, basic)
+{
+    struct loadgen_config config;
+
+    loadgen_default_config(&config);
+    ASSERT_EQ(0, loadgen_parse_mix("temp=4,pos=1", &config));
+    ASSERT_EQ(0U, config.mix[SET_HEAT_CMD]);
+    ASSERT_EQ(4U, config.mix[READ_TEMP_CMD]);
+    ASSERT_EQ(1U, config.mix[READ_POS_CMD]);
+
+    ASSERT_EQ(-1, loadgen_parse_mix("heat=1", &config));
+    ASSERT_EQ(-1, loadgen_parse_mix("set=0", &config));
+    ASSERT_EQ(4U, config.mix[READ_TEMP_CMD]);
+}
+
+/**********************************************************
+ *  Test: loadgen_run -> closed_loop
+ *********************************************************/
+TEST(test_loadgen_run, closed_loop)
+{
+    struct loadgen_config config;
+    struct loadgen_report report;
+
+    loadgen_default_config(&config);
+    config.duration = 200 * NS_PER_MS;
+    ASSERT_EQ(0, run_emulated(&config, 4, &report));
+
+    ASSERT_EQ(4, report.links);
+    ASSERT_GT(report.received, 0UL);
+    ASSERT_EQ(report.sent, report.received);
+    ASSERT_EQ(0UL, report.parity_errors);
+    ASSERT_EQ(0UL, report.timeouts);
+    ASSERT_GT(report.throughput, 0.0);
+
+    // percentiles are ordered
+    ASSERT_EQ(report.received, report.total.count);
+    ASSERT_LE(report.total.p50, report.total.p99);
+    ASSERT_LE(report.total.p99, report.total.p999);
+    ASSERT_LE(report.total.p999, report.total.max);
+}
+
+/**********************************************************
+ *  Test: loadgen_run -> open_loop
+ *********************************************************/
+TEST(test_loadgen_run, open_loop)
+{
+    struct loadgen_config config;
+    struct loadgen_report report;
+
+    // 500 requests/sec on each link during 200 ms
+    loadgen_default_config(&config);
+    config.mode = LOADGEN_OPEN;
+    config.rate = 500.0;
+    config.duration = 200 * NS_PER_MS;
+    ASSERT_EQ(0, loadgen_parse_mix("temp=1", &config));
+    ASSERT_EQ(0, run_emulated(&config, 2, &report));
+
+    ASSERT_EQ(200UL, report.sent);
+    ASSERT_EQ(200UL, report.received);
+
+    // only the commands in the mix are sent
+    ASSERT_EQ(200UL, report.per_cmd[READ_TEMP_CMD].count);
+    ASSERT_EQ(0UL, report.per_cmd[SET_HEAT_CMD].count);
+}
+
+/**********************************************************
+ *  Test: loadgen_run -> timeout
+ *********************************************************/
+TEST(test_loadgen_run, timeout)
+{
+    struct loadgen_config config;
+    struct loadgen_report report;
+    int pair[2];
+
+    // nobody answers on the other end
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    loadgen_default_config(&config);
+    config.duration = 50 * NS_PER_MS;
+    config.timeout = 20 * NS_PER_MS;
+    ASSERT_EQ(0, loadgen_run(&config, pair, 1, &report));
+
+    ASSERT_GT(report.timeouts, 0UL);
+    ASSERT_EQ(0UL, report.received);
+
+    close(pair[0]);
+    close(pair[1]);
+}
+
+/**********************************************************
+ *  Test: loadgen_slave -> addressed
+ *********************************************************/
+TEST(test_loadgen_slave, addressed)
+{
+    struct cmd_msg msg;
+    struct res_msg res;
+    struct link_reader reader;
+    unsigned char frame[FRAME_MAX_SIZE];
+    int pair[2];
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    std::thread slave([fd = pair[1]]()
+                      { loadgen_slave(fd); });
+    link_reader_init(&reader, pair[0]);
+
+    // a request for another slave and a broadcast get no answer, the
+    // request for this one does
+    memset(&msg, 0, sizeof(struct cmd_msg));
+    msg.cmd = READ_SUN_CMD;
+    msg.addr = DEFAULT_ADDR + 1;
+    msg.seq = 1;
+    ASSERT_EQ(0, link_write_all(pair[0], frame, frame_close(frame, encode_cmd_msg(&msg, frame + 1))));
+    msg.addr = BROADCAST_ADDR;
+    msg.seq = 2;
+    ASSERT_EQ(0, link_write_all(pair[0], frame, frame_close(frame, encode_cmd_msg(&msg, frame + 1))));
+    msg.addr = DEFAULT_ADDR;
+    msg.seq = 3;
+    ASSERT_EQ(0, link_write_all(pair[0], frame, frame_close(frame, encode_cmd_msg(&msg, frame + 1))));
+
+    int ret = link_read_frame(&reader, clock_now_ns() + NS_PER_S);
+    ASSERT_GT(ret, 0);
+    ASSERT_EQ(ret, decode_res_msg(reader.parser.message, ret, &res));
+    ASSERT_EQ(DEFAULT_ADDR, res.addr);
+    ASSERT_EQ(3, res.seq);
+    ASSERT_EQ(LINK_READ_TIMEOUT, link_read_frame(&reader, clock_now_ns() + 20 * NS_PER_MS));
+
+    close(pair[0]);
+    slave.join();
+    close(pair[1]);
+}
+
+/**********************************************************
+ *  Test: loadgen_run -> wrong_config
+ *********************************************************/
+TEST(test_loadgen_run, wrong_config)
+{
+    struct loadgen_config config;
+    struct loadgen_report report;
+    int fd = 0;
+
+    loadgen_default_config(&config);
+    ASSERT_EQ(-1, loadgen_run(&config, &fd, 0, &report));
+
+    config.mode = LOADGEN_OPEN;
+    config.rate = 0.0;
+    ASSERT_EQ(-1, loadgen_run(&config, &fd, 1, &report));
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
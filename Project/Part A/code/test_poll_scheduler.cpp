@@ -0,0 +1,108 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+
+extern "C"
+{
+#include "poll_scheduler.h"
+#include "protocol.h"
+}
+
+/**********************************************************
+ *  Test: poll_scheduler_next -> spread
+ *********************************************************/
+TEST(test_poll_scheduler_next, spread)
+{
+    struct poll_scheduler scheduler;
+    const unsigned char addrs[] = {8, 9, 10};
+
+    ASSERT_EQ(0, poll_scheduler_init(&scheduler, addrs, 3, 2));
+
+    // a request for every node before a second one for any
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(i, poll_scheduler_next(&scheduler, 0));
+        poll_scheduler_sent(&scheduler, i);
+    }
+
+    // the first to answer takes the next request
+    poll_scheduler_answered(&scheduler, 1);
+    ASSERT_EQ(1, poll_scheduler_next(&scheduler, 0));
+
+    // none with more than max_outstanding requests
+    for (int i = 0; i < 4; i++)
+    {
+        poll_scheduler_sent(&scheduler, poll_scheduler_next(&scheduler, 0));
+    }
+    ASSERT_EQ(-1, poll_scheduler_next(&scheduler, 0));
+    ASSERT_EQ(3UL, scheduler.nodes[1].polls);
+
+    ASSERT_EQ(2, poll_scheduler_find(&scheduler, 10));
+    ASSERT_EQ(-1, poll_scheduler_find(&scheduler, BROADCAST_ADDR));
+}
+
+/**********************************************************
+ *  Test: poll_scheduler_failed -> backoff
+ *********************************************************/
+TEST(test_poll_scheduler_failed, backoff)
+{
+    struct poll_scheduler scheduler;
+    const unsigned char addrs[] = {8, 9};
+
+    ASSERT_EQ(0, poll_scheduler_init(&scheduler, addrs, 2, 1));
+
+    // a node that does not answer rests while the other takes the requests
+    poll_scheduler_sent(&scheduler, 0);
+    poll_scheduler_failed(&scheduler, 0, 0);
+    ASSERT_EQ(1, poll_scheduler_next(&scheduler, 0));
+    poll_scheduler_sent(&scheduler, 1);
+    poll_scheduler_answered(&scheduler, 1);
+    ASSERT_EQ(1, poll_scheduler_next(&scheduler, POLL_BACKOFF_MIN - 1));
+    ASSERT_EQ(0, poll_scheduler_next(&scheduler, POLL_BACKOFF_MIN));
+
+    // twice as long after every failure in a row, up to the maximum
+    for (int i = 0; i < 10; i++)
+    {
+        poll_scheduler_sent(&scheduler, 0);
+        poll_scheduler_failed(&scheduler, 0, 0);
+    }
+    ASSERT_EQ(POLL_BACKOFF_MAX, scheduler.nodes[0].ready);
+    ASSERT_EQ(11UL, scheduler.nodes[0].failures);
+
+    // an answer ends the rest
+    poll_scheduler_sent(&scheduler, 0);
+    poll_scheduler_answered(&scheduler, 0);
+    ASSERT_EQ(0, scheduler.nodes[0].ready);
+    ASSERT_EQ(POLL_BACKOFF_MIN, scheduler.nodes[0].backoff);
+}
+
+/**********************************************************
+ *  Test: poll_scheduler_next -> lone_node
+ *********************************************************/
+TEST(test_poll_scheduler_next, lone_node)
+{
+    struct poll_scheduler scheduler;
+    const unsigned char addr = DEFAULT_ADDR;
+
+    ASSERT_EQ(-1, poll_scheduler_init(&scheduler, &addr, 0, 1));
+    ASSERT_EQ(-1, poll_scheduler_init(&scheduler, &addr, POLL_MAX_NODES + 1, 1));
+    ASSERT_EQ(0, poll_scheduler_init(&scheduler, &addr, 1, 4));
+
+    // a single slave is still polled while it rests
+    poll_scheduler_sent(&scheduler, 0);
+    poll_scheduler_failed(&scheduler, 0, 0);
+    ASSERT_EQ(0, poll_scheduler_next(&scheduler, 0));
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,292 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+extern "C"
+{
+#include "protocol.h"
+}
+
+/**********************************************************
+ *  Test: protocol -> wire_size
+ *********************************************************/
+TEST(test_protocol, wire_size)
+{
+    // no padding on the wire, whatever the compiler does in memory
+    ASSERT_EQ(12, CMD_MSG_WIRE_SIZE);
+    ASSERT_EQ(17, RES_MSG_WIRE_SIZE);
+    ASSERT_LE((size_t)RES_MSG_WIRE_SIZE, sizeof(struct res_msg));
+}
+
+/**********************************************************
+ *  Test: protocol -> cmd_msg
+ *********************************************************/
+TEST(test_protocol, cmd_msg)
+{
+    struct cmd_msg msg = {DEFAULT_ADDR, 200, BATCH_CMD, 1, BATCH_SET_HEAT | BATCH_READ_TEMP, {}};
+    struct cmd_msg decoded;
+    unsigned char buffer[CMD_MSG_WIRE_SIZE];
+
+    ASSERT_EQ(5, encode_cmd_msg(&msg, buffer));
+    ASSERT_EQ(DEFAULT_ADDR, buffer[0]);
+    ASSERT_EQ(200, buffer[1]);
+    ASSERT_EQ(BATCH_CMD, buffer[2]);
+    ASSERT_EQ(1, buffer[3]);
+    ASSERT_EQ(BATCH_SET_HEAT | BATCH_READ_TEMP, buffer[4]);
+
+    ASSERT_EQ(5, decode_cmd_msg(buffer, 5, &decoded));
+    ASSERT_EQ(DEFAULT_ADDR, decoded.addr);
+    ASSERT_EQ(200, decoded.seq);
+    ASSERT_EQ(BATCH_CMD, decoded.cmd);
+    ASSERT_EQ(1, decoded.set_heater);
+    ASSERT_EQ(BATCH_SET_HEAT | BATCH_READ_TEMP, decoded.batch);
+
+    // only the HELLO_CMD carries the capabilities
+    msg.cmd = HELLO_CMD;
+    msg.data.hello.version = PROTOCOL_VERSION;
+    msg.data.hello.features = FEATURE_BATCH;
+    msg.data.hello.baud = 115200;
+    ASSERT_EQ(11, encode_cmd_msg(&msg, buffer));
+    ASSERT_EQ(0x00, buffer[7]);
+    ASSERT_EQ(0xC2, buffer[8]);
+    ASSERT_EQ(0x01, buffer[9]);
+    ASSERT_EQ(-1, decode_cmd_msg(buffer, 5, &decoded));
+    ASSERT_EQ(11, decode_cmd_msg(buffer, 11, &decoded));
+    ASSERT_EQ(PROTOCOL_VERSION, decoded.data.hello.version);
+    ASSERT_EQ(FEATURE_BATCH, decoded.data.hello.features);
+    ASSERT_EQ(115200U, decoded.data.hello.baud);
+
+    // the SUBSCRIBE_CMD carries the readings to push
+    msg.cmd = SUBSCRIBE_CMD;
+    msg.data.subscription.parts = BATCH_READ_TEMP;
+    msg.data.subscription.period = 1000;
+    msg.data.subscription.delta = 0.5f;
+    ASSERT_EQ(CMD_MSG_WIRE_SIZE, encode_cmd_msg(&msg, buffer));
+    ASSERT_EQ(0xE8, buffer[6]);
+    ASSERT_EQ(0x03, buffer[7]);
+    ASSERT_EQ(CMD_MSG_WIRE_SIZE, decode_cmd_msg(buffer, CMD_MSG_WIRE_SIZE, &decoded));
+    ASSERT_EQ(BATCH_READ_TEMP, decoded.data.subscription.parts);
+    ASSERT_EQ(1000, decoded.data.subscription.period);
+    ASSERT_FLOAT_EQ(0.5f, decoded.data.subscription.delta);
+}
+
+/**********************************************************
+ *  Test: protocol -> res_msg
+ *********************************************************/
+TEST(test_protocol, res_msg)
+{
+    struct res_msg msg;
+    struct res_msg decoded;
+    unsigned char buffer[RES_MSG_WIRE_SIZE];
+
+    // the temperature goes in steps of 0.01 as a little endian i16
+    memset(&msg, 0, sizeof(struct res_msg));
+    msg.seq = 7;
+    msg.cmd = READ_TEMP_CMD;
+    msg.data.temperature = -1.0f;
+    ASSERT_EQ(6, encode_res_msg(&msg, buffer));
+    ASSERT_EQ(0x9C, buffer[4]);
+    ASSERT_EQ(0xFF, buffer[5]);
+    ASSERT_EQ(6, decode_res_msg(buffer, 6, &decoded));
+    ASSERT_EQ(7, decoded.seq);
+    ASSERT_FLOAT_EQ(-1.0f, decoded.data.temperature);
+
+    // the position in steps of 0.1 as a little endian i24
+    msg.cmd = READ_POS_CMD;
+    msg.status = 0;
+    msg.data.position.x = -1.5f;
+    msg.data.position.y = 2.25f;
+    msg.data.position.z = 12000.0f;
+    ASSERT_EQ(13, encode_res_msg(&msg, buffer));
+    ASSERT_EQ(0xF1, buffer[4]);
+    ASSERT_EQ(0xFF, buffer[6]);
+    ASSERT_EQ(13, decode_res_msg(buffer, 13, &decoded));
+    ASSERT_EQ(READ_POS_CMD, decoded.cmd);
+    ASSERT_NEAR(-1.5f, decoded.data.position.x, 0.05f);
+    ASSERT_NEAR(2.3f, decoded.data.position.y, 0.05f);
+    ASSERT_NEAR(12000.0f, decoded.data.position.z, 0.05f);
+
+    // the whole state in a single answer, the booleans in one byte
+    memset(&msg.data, 0, sizeof(msg.data));
+    msg.cmd = BATCH_CMD;
+    msg.data.batch.batch = BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS;
+    msg.data.batch.heater_on = 0;
+    msg.data.batch.sunlight_on = 1;
+    msg.data.batch.temperature = 40.0f;
+    msg.data.batch.position.z = -3.5f;
+    ASSERT_EQ(RES_MSG_WIRE_SIZE, encode_res_msg(&msg, buffer));
+    ASSERT_EQ(0x02, buffer[5]);
+    ASSERT_EQ(RES_MSG_WIRE_SIZE, decode_res_msg(buffer, RES_MSG_WIRE_SIZE, &decoded));
+    ASSERT_EQ(BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS, decoded.data.batch.batch);
+    ASSERT_EQ(0, decoded.data.batch.heater_on);
+    ASSERT_EQ(1, decoded.data.batch.sunlight_on);
+    ASSERT_FLOAT_EQ(40.0f, decoded.data.batch.temperature);
+    ASSERT_FLOAT_EQ(-3.5f, decoded.data.batch.position.z);
+
+    // only the member selected by the command goes on the wire
+    msg.cmd = READ_SUN_CMD;
+    msg.status = 1;
+    msg.data.sunlight_on = 1;
+    ASSERT_EQ(5, encode_res_msg(&msg, buffer));
+    ASSERT_EQ(1, buffer[4]);
+    ASSERT_EQ(5, decode_res_msg(buffer, 5, &decoded));
+    ASSERT_EQ(1, decoded.status);
+    ASSERT_EQ(1, decoded.data.sunlight_on);
+
+    msg.cmd = SET_HEAT_CMD;
+    ASSERT_EQ(4, encode_res_msg(&msg, buffer));
+
+    // the size must match the command
+    ASSERT_EQ(-1, decode_res_msg(buffer, 5, &decoded));
+    ASSERT_EQ(-1, decode_res_msg(buffer, 3, &decoded));
+}
+
+/**********************************************************
+ *  Test: protocol -> fixed_point
+ *********************************************************/
+TEST(test_protocol, fixed_point)
+{
+    unsigned char buffer[3];
+
+    // rounded to the nearest step, away from zero at the half
+    protocol_put_q16(buffer, 21.456f, 0.01f);
+    ASSERT_FLOAT_EQ(21.46f, protocol_get_q16(buffer, 0.01f));
+    protocol_put_q16(buffer, -0.005f, 0.01f);
+    ASSERT_FLOAT_EQ(-0.01f, protocol_get_q16(buffer, 0.01f));
+
+    // saturated at the limits of the field, NaN as 0
+    protocol_put_q16(buffer, 1000.0f, 0.01f);
+    ASSERT_FLOAT_EQ(327.67f, protocol_get_q16(buffer, 0.01f));
+    protocol_put_q24(buffer, -1e9f, 0.1f);
+    ASSERT_NEAR(-838860.7f, protocol_get_q24(buffer, 0.1f), 0.1f);
+    protocol_put_q24(buffer, NAN, 0.1f);
+    ASSERT_EQ(0.0f, protocol_get_q24(buffer, 0.1f));
+
+    // bits packed from the lowest one
+    protocol_put_bit(buffer, 0, 1);
+    protocol_put_bit(buffer, 1, 0);
+    protocol_put_bit(buffer, 2, 5);
+    ASSERT_EQ(0x05, buffer[0]);
+    ASSERT_EQ(1, protocol_get_bit(buffer, 2));
+    ASSERT_EQ(0, protocol_get_bit(buffer, 1));
+}
+
+/**********************************************************
+ *  Test: protocol -> crc
+ *********************************************************/
+TEST(test_protocol, crc)
+{
+    const unsigned char check[] = "123456789";
+
+    // check value of CRC-16/CCITT-FALSE
+    ASSERT_EQ(0x29B1, protocol_crc16(check, 9));
+    ASSERT_EQ(0xFFFF, protocol_crc16(check, 0));
+}
+
+/**********************************************************
+ *  Test: protocol -> frame
+ *********************************************************/
+TEST(test_protocol, frame)
+{
+    struct frame_parser parser;
+    struct res_msg msg;
+    unsigned char frame[FRAME_MAX_SIZE];
+    unsigned char message[FRAME_MAX_SIZE];
+    int size;
+
+    // 2.56 (256 steps) has a zero byte to stuff, as addr, seq and status
+    memset(&msg, 0, sizeof(struct res_msg));
+    msg.cmd = READ_TEMP_CMD;
+    msg.data.temperature = 2.56f;
+    size = frame_close(frame, encode_res_msg(&msg, frame + 1));
+    ASSERT_EQ(6 + FRAME_OVERHEAD, size);
+    for (int i = 0; i < size - 1; i++)
+    {
+        ASSERT_NE(0, frame[i]);
+    }
+    ASSERT_EQ(0, frame[size - 1]);
+    ASSERT_EQ(6, frame_open(frame, size, message));
+    ASSERT_EQ(READ_TEMP_CMD, message[2]);
+    ASSERT_EQ(0, message[4]);
+    ASSERT_EQ(0x01, message[5]);
+
+    // empty frames between delimiters are skipped
+    memset(&parser, 0, sizeof(struct frame_parser));
+    ASSERT_EQ(FRAME_INCOMPLETE, frame_parse_byte(&parser, 0));
+    for (int i = 0; i < size - 1; i++)
+    {
+        ASSERT_EQ(FRAME_INCOMPLETE, frame_parse_byte(&parser, frame[i]));
+    }
+    ASSERT_EQ(FRAME_COMPLETE, frame_parse_byte(&parser, frame[size - 1]));
+    ASSERT_EQ(6, parser.size);
+    ASSERT_EQ(size, parser.length);
+    ASSERT_EQ(0, memcmp(frame, parser.frame, size));
+    ASSERT_EQ(0, memcmp(message, parser.message, 6));
+
+    // a corrupted byte is detected
+    frame[3] ^= 0x10;
+    ASSERT_EQ(-1, frame_open(frame, size, message));
+    for (int i = 0; i < size - 1; i++)
+    {
+        frame_parse_byte(&parser, frame[i]);
+    }
+    ASSERT_EQ(FRAME_WRONG, frame_parse_byte(&parser, frame[size - 1]));
+    frame[3] ^= 0x10;
+}
+
+/**********************************************************
+ *  Test: protocol -> resync
+ *********************************************************/
+TEST(test_protocol, resync)
+{
+    struct frame_parser parser;
+    struct cmd_msg msg;
+    unsigned char frame[FRAME_MAX_SIZE];
+    int size;
+
+    memset(&msg, 0, sizeof(struct cmd_msg));
+    msg.cmd = SET_HEAT_CMD;
+    size = frame_close(frame, encode_cmd_msg(&msg, frame + 1));
+    memset(&parser, 0, sizeof(struct frame_parser));
+
+    // a frame that lost a byte is dropped at its own delimiter
+    for (int i = 1; i < size - 1; i++)
+    {
+        ASSERT_EQ(FRAME_INCOMPLETE, frame_parse_byte(&parser, frame[i]));
+    }
+    ASSERT_EQ(FRAME_WRONG, frame_parse_byte(&parser, frame[size - 1]));
+
+    // and the next one is received whole
+    for (int i = 0; i < size - 1; i++)
+    {
+        ASSERT_EQ(FRAME_INCOMPLETE, frame_parse_byte(&parser, frame[i]));
+    }
+    ASSERT_EQ(FRAME_COMPLETE, frame_parse_byte(&parser, frame[size - 1]));
+    ASSERT_EQ(5, parser.size);
+
+    // so does a burst of noise longer than any frame
+    for (int i = 0; i < 3 * FRAME_MAX_SIZE; i++)
+    {
+        ASSERT_EQ(FRAME_INCOMPLETE, frame_parse_byte(&parser, 0x55));
+    }
+    ASSERT_EQ(FRAME_WRONG, frame_parse_byte(&parser, 0));
+    for (int i = 0; i < size - 1; i++)
+    {
+        frame_parse_byte(&parser, frame[i]);
+    }
+    ASSERT_EQ(FRAME_COMPLETE, frame_parse_byte(&parser, frame[size - 1]));
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,169 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+
+extern "C"
+{
+#include "arduino_code.h"
+#include "capture.h"
+#include "clock.h"
+#include "link_io.h"
+#include "loadgen.h"
+#include "replay.h"
+}
+
+#define CAPTURE_PATH "test_replay.scap"
+
+/**********************************************************
+ *  Test: capture -> round_trip
+ *********************************************************/
+TEST(test_capture, round_trip)
+{
+    struct capture_reader reader;
+    struct capture_record record;
+    unsigned char request[5] = {1, 0, 0, 0, 1};
+    unsigned char answer[CAPTURE_MAX_FRAME];
+    int64_t last;
+
+    memset(answer, 0xA5, sizeof(answer));
+
+    // nothing is written without a capture in progress
+    capture_frame(CAPTURE_TO_SLAVE, 0, request, sizeof(request));
+
+    ASSERT_EQ(0, capture_start(CAPTURE_PATH));
+    capture_frame(CAPTURE_TO_SLAVE, 3, request, sizeof(request));
+    capture_frame(CAPTURE_TO_MASTER, 3, answer, sizeof(answer));
+    capture_frame(CAPTURE_TO_MASTER, CAPTURE_MAX_LINK + 1, answer, 1);
+    capture_stop();
+
+    ASSERT_EQ(0, capture_reader_open(&reader, CAPTURE_PATH));
+    ASSERT_EQ(1, capture_reader_next(&reader, &record));
+    ASSERT_EQ(CAPTURE_TO_SLAVE, record.direction);
+    ASSERT_EQ(3, record.link);
+    ASSERT_EQ(5, record.size);
+    ASSERT_EQ(0, memcmp(request, record.data, sizeof(request)));
+    last = record.time;
+
+    ASSERT_EQ(1, capture_reader_next(&reader, &record));
+    ASSERT_EQ(CAPTURE_TO_MASTER, record.direction);
+    ASSERT_EQ(CAPTURE_MAX_FRAME, record.size);
+    ASSERT_EQ(0, memcmp(answer, record.data, sizeof(answer)));
+    ASSERT_GE(record.time, last);
+
+    // the frame on a wrong link was not captured
+    ASSERT_EQ(0, capture_reader_next(&reader, &record));
+    capture_reader_close(&reader);
+
+    unlink(CAPTURE_PATH);
+}
+
+/**********************************************************
+ *  Test: replay_run -> slave
+ *********************************************************/
+TEST(test_replay_run, slave)
+{
+    struct loadgen_config config;
+    struct loadgen_report load;
+    struct replay_config replay;
+    struct replay_report report;
+    int pair[2];
+
+    // capture a closed loop run; these answers do not depend on the time
+    loadgen_default_config(&config);
+    config.duration = 100 * NS_PER_MS;
+    ASSERT_EQ(0, loadgen_parse_mix("set=1,sun=1", &config));
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    std::thread slave([fd = pair[1]]()
+                      { loadgen_slave(fd); });
+    ASSERT_EQ(0, capture_start(CAPTURE_PATH));
+    ASSERT_EQ(0, loadgen_run(&config, pair, 1, &load));
+    capture_stop();
+    close(pair[0]);
+    slave.join();
+    close(pair[1]);
+
+    // play it against a new slave
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    std::thread replayed([fd = pair[1]]()
+                         { loadgen_slave(fd); });
+    replay_default_config(&replay);
+    ASSERT_EQ(0, replay_run(&replay, CAPTURE_PATH, pair[0], &report));
+    close(pair[0]);
+    replayed.join();
+    close(pair[1]);
+
+    ASSERT_EQ(load.sent, report.sent);
+    ASSERT_EQ(load.received, report.received);
+    ASSERT_EQ(0UL, report.mismatches);
+    ASSERT_EQ(0UL, report.timeouts);
+    ASSERT_GT(report.throughput, 0.0);
+
+    unlink(CAPTURE_PATH);
+}
+
+/**********************************************************
+ *  Test: replay_run -> master
+ *********************************************************/
+TEST(test_replay_run, master)
+{
+    struct replay_config replay;
+    struct replay_report report;
+    unsigned char request[4 + FRAME_OVERHEAD] = {0, 1, READ_SUN_CMD, 0};
+    unsigned char answer[4 + FRAME_OVERHEAD] = {0, 1, READ_SUN_CMD, 1, 1};
+    unsigned char received[4 + FRAME_OVERHEAD];
+    int pair[2];
+
+    frame_close(request, 4);
+    frame_close(answer, 4);
+    ASSERT_EQ(0, capture_start(CAPTURE_PATH));
+    capture_frame(CAPTURE_TO_SLAVE, 0, request, sizeof(request));
+    capture_frame(CAPTURE_TO_MASTER, 0, answer, sizeof(answer));
+    capture_frame(CAPTURE_TO_SLAVE, 0, request, sizeof(request));
+    capture_frame(CAPTURE_TO_MASTER, 0, answer, sizeof(answer));
+    capture_stop();
+
+    // the master sends one right and one wrong request
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    std::thread master([&]()
+                       {
+                           unsigned char wrong[4 + FRAME_OVERHEAD] = {0, 2, READ_TEMP_CMD, 0};
+                           link_write_all(pair[1], request, sizeof(request));
+                           link_read_all(pair[1], received, sizeof(received), -1);
+                           frame_close(wrong, 4);
+                           link_write_all(pair[1], wrong, sizeof(wrong));
+                           link_read_all(pair[1], received, sizeof(received), -1); });
+
+    replay_default_config(&replay);
+    replay.target = REPLAY_MASTER;
+    ASSERT_EQ(0, replay_run(&replay, CAPTURE_PATH, pair[0], &report));
+    master.join();
+    close(pair[0]);
+    close(pair[1]);
+
+    ASSERT_EQ(2UL, report.sent);
+    ASSERT_EQ(2UL, report.received);
+    ASSERT_EQ(1UL, report.mismatches);
+    ASSERT_EQ(0, memcmp(answer, received, sizeof(answer)));
+
+    // a missing file is an error
+    ASSERT_EQ(-1, replay_run(&replay, "missing.scap", pair[0], &report));
+
+    unlink(CAPTURE_PATH);
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,130 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#include "request_queue.h"
+}
+
+/**********************************************************
+ *  Test: request_queue_pop -> deadline_order
+ *********************************************************/
+TEST(test_request_queue_pop, deadline_order)
+{
+    struct request_queue queue;
+    struct link_request pos = {NULL, 4, READ_POS_CMD, 3000, 0};
+    struct link_request heat = {NULL, 3, SET_HEAT_CMD, 2000, 0};
+    struct link_request temp = {NULL, 2, READ_TEMP_CMD, 2000, 0};
+
+    request_queue_init(&queue);
+    ASSERT_EQ(NULL, request_queue_pop(&queue));
+
+    // the routine reading pushed first goes after the urgent ones
+    request_queue_push(&queue, &pos);
+    ASSERT_EQ(1, request_queue_collect(&queue));
+    request_queue_push(&queue, &heat);
+    request_queue_push(&queue, &temp);
+    ASSERT_EQ(3, request_queue_collect(&queue));
+
+    // the same deadline by priority
+    ASSERT_EQ(&temp, request_queue_pop(&queue));
+    ASSERT_EQ(&heat, request_queue_pop(&queue));
+    ASSERT_EQ(&pos, request_queue_pop(&queue));
+    ASSERT_EQ(NULL, request_queue_pop(&queue));
+
+    ASSERT_FALSE(request_done(&heat));
+    request_complete(&heat);
+    ASSERT_TRUE(request_done(&heat));
+}
+
+/**********************************************************
+ *  Test: request_queue_collect -> full
+ *********************************************************/
+TEST(test_request_queue_collect, full)
+{
+    struct request_queue queue;
+    struct link_request requests[REQUEST_QUEUE_SIZE + 2];
+
+    // the requests without room wait pushed for the next collect
+    request_queue_init(&queue);
+    for (int i = 0; i < REQUEST_QUEUE_SIZE + 2; i++)
+    {
+        requests[i] = {NULL, 0, READ_TEMP_CMD, (int64_t)i, 0};
+        request_queue_push(&queue, &requests[i]);
+    }
+    ASSERT_EQ(REQUEST_QUEUE_SIZE, request_queue_collect(&queue));
+    ASSERT_NE((struct link_request *)NULL, queue.pushed);
+    request_queue_pop(&queue);
+    request_queue_pop(&queue);
+    ASSERT_EQ(REQUEST_QUEUE_SIZE, request_queue_collect(&queue));
+    ASSERT_EQ(NULL, queue.pushed);
+}
+
+/**********************************************************
+ *  Test: request_queue_push -> concurrent_producers
+ *********************************************************/
+TEST(test_request_queue_push, concurrent_producers)
+{
+    static struct request_queue queue;
+    const int producers = 4;
+    const int rounds = 20000;
+    std::vector<std::thread> threads;
+    int served = 0;
+
+    // every task waits for its request, the owner serves them all once
+    request_queue_init(&queue);
+    for (int p = 0; p < producers; p++)
+    {
+        threads.push_back(std::thread([p]()
+        {
+            struct link_request request;
+
+            for (int i = 0; i < rounds; i++)
+            {
+                request = {NULL, p, READ_TEMP_CMD, (int64_t)i, 0};
+                request_queue_push(&queue, &request);
+                while (!request_done(&request))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+    while (served < producers * rounds)
+    {
+        struct link_request *request;
+
+        if (request_queue_collect(&queue) == 0)
+        {
+            std::this_thread::yield();
+        }
+        while ((request = request_queue_pop(&queue)) != NULL)
+        {
+            ASSERT_EQ(READ_TEMP_CMD, request->cmd);
+            request_complete(request);
+            served++;
+        }
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    ASSERT_EQ(0, queue.count);
+    ASSERT_EQ(NULL, queue.pushed);
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
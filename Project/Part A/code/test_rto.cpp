@@ -0,0 +1,85 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+
+extern "C"
+{
+#include "rto.h"
+}
+
+/**********************************************************
+ *  Test: rto_sample -> first_sample
+ *********************************************************/
+TEST(test_rto_sample, first_sample)
+{
+    struct rto_estimator rto;
+
+    rto_init(&rto);
+    ASSERT_EQ(RTO_INITIAL, rto.rto);
+
+    // srtt = rtt, rttvar = rtt / 2
+    rto_sample(&rto, 100 * NS_PER_MS);
+    ASSERT_EQ(100 * NS_PER_MS, rto.srtt);
+    ASSERT_EQ(50 * NS_PER_MS, rto.rttvar);
+    ASSERT_EQ(300 * NS_PER_MS, rto.rto);
+}
+
+/**********************************************************
+ *  Test: rto_sample -> converges
+ *********************************************************/
+TEST(test_rto_sample, converges)
+{
+    struct rto_estimator rto;
+
+    // a steady link ends waiting little more than its round trip
+    rto_init(&rto);
+    for (int i = 0; i < 100; i++)
+    {
+        rto_sample(&rto, 120 * NS_PER_MS);
+    }
+    ASSERT_NEAR(120 * NS_PER_MS, rto.srtt, NS_PER_MS);
+    ASSERT_LT(rto.rto, 130 * NS_PER_MS);
+
+    // never below the minimum
+    for (int i = 0; i < 100; i++)
+    {
+        rto_sample(&rto, NS_PER_MS);
+    }
+    ASSERT_EQ(RTO_MIN, rto.rto);
+}
+
+/**********************************************************
+ *  Test: rto_backoff -> doubles
+ *********************************************************/
+TEST(test_rto_backoff, doubles)
+{
+    struct rto_estimator rto;
+
+    rto_init(&rto);
+    rto_backoff(&rto);
+    ASSERT_EQ(2 * RTO_INITIAL, rto.rto);
+
+    // up to the maximum
+    for (int i = 0; i < 10; i++)
+    {
+        rto_backoff(&rto);
+    }
+    ASSERT_EQ(RTO_MAX, rto.rto);
+
+    // a new sample computes it again
+    rto_sample(&rto, 100 * NS_PER_MS);
+    ASSERT_EQ(300 * NS_PER_MS, rto.rto);
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,68 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+
+extern "C"
+{
+#include "schedule.h"
+}
+
+/**********************************************************
+ *  Test: schedule_releases -> every_period
+ *********************************************************/
+TEST(test_schedule_releases, every_period)
+{
+    const int periods[TASKS] = {TASK_C_PERIOD, TASK_B_PERIOD, TASK_D_PERIOD,
+                                TASK_E_PERIOD, TASK_F_PERIOD, TASK_A_PERIOD};
+    const int order[TASKS] = {TASK_C, TASK_B, TASK_D, TASK_E, TASK_F, TASK_A};
+
+    // all the tasks start together, then each one once per period
+    ASSERT_EQ(20000, SCHEDULE_HYPERPERIOD);
+    ASSERT_EQ(1000, SCHEDULE_MINOR_FRAME);
+    ASSERT_EQ((1 << TASKS) - 1, schedule_releases[0]);
+    for (int i = 0; i < TASKS; i++)
+    {
+        for (int frame = 0; frame < SCHEDULE_FRAMES; frame++)
+        {
+            int released = (schedule_releases[frame] >> order[i]) & 1;
+
+            ASSERT_EQ((frame * SCHEDULE_MINOR_FRAME) % periods[i] == 0, released);
+        }
+    }
+}
+
+/**********************************************************
+ *  Test: schedule_releases -> rate_monotonic
+ *********************************************************/
+TEST(test_schedule_releases, rate_monotonic)
+{
+    // the shortest period first, the reading before the control and the
+    // control before the heater
+    ASSERT_EQ(0, TASK_C);
+    ASSERT_EQ(1, TASK_B);
+    ASSERT_EQ(2, TASK_D);
+    ASSERT_LT(TASK_D, TASK_E);
+    ASSERT_LT(TASK_F, TASK_A);
+
+    // every task ends before its next release: the request of the first
+    // one waits for the exchange in progress and for one more with the
+    // other four requests, a window holds four; the control waits for no
+    // one on the processor
+    ASSERT_EQ(4, SCHEDULE_LINK_WINDOW);
+    ASSERT_EQ(TASK_C_EXECUTION_TIME + 2 * TASK_D_EXECUTION_TIME, TASK_C_RESPONSE_TIME);
+    ASSERT_EQ(TASK_B_EXECUTION_TIME, TASK_B_RESPONSE_TIME);
+    ASSERT_LE(TASK_A_RESPONSE_TIME, TASK_A_PERIOD);
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
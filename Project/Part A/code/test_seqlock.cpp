@@ -0,0 +1,97 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#include "seqlock.h"
+}
+
+/**********************************************************
+ *  Test: seqlock_read -> last_version
+ *********************************************************/
+TEST(test_seqlock_read, last_version)
+{
+    struct state_seqlock lock;
+    struct spacecraft_state state = {21.5, {1.0f, 2.0f, 3.0f}, 1, 0};
+    struct spacecraft_state copy;
+
+    seqlock_init(&lock, &state);
+    ASSERT_EQ(0U, seqlock_read(&lock, &copy));
+    ASSERT_EQ(21.5, copy.temperature);
+    ASSERT_EQ(3.0f, copy.position.z);
+
+    // every publish is a new even version
+    state.heater_on = 1;
+    seqlock_publish(&lock, &state);
+    ASSERT_EQ(2U, seqlock_read(&lock, &copy));
+    ASSERT_EQ(1, copy.heater_on);
+    ASSERT_EQ(1, copy.sunlight_on);
+}
+
+/**********************************************************
+ *  Test: seqlock_read -> never_torn
+ *********************************************************/
+TEST(test_seqlock_read, never_torn)
+{
+    struct state_seqlock lock;
+    struct spacecraft_state state = {0.0, {0.0f, 0.0f, 0.0f}, 0, 0};
+    const int versions = 200000;
+    std::vector<std::thread> readers;
+    int done = 0;
+
+    // the writer publishes states with every field equal, the readers
+    // must never see two versions mixed
+    seqlock_init(&lock, &state);
+    for (int r = 0; r < 3; r++)
+    {
+        readers.push_back(std::thread([&lock, &done]()
+        {
+            uint32_t last = 0;
+
+            while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE))
+            {
+                struct spacecraft_state copy;
+                uint32_t version = seqlock_read(&lock, &copy);
+
+                ASSERT_EQ(0U, version & 1);
+                ASSERT_GE(version, last);
+                ASSERT_EQ(copy.temperature, (double)copy.position.x);
+                ASSERT_EQ(copy.position.x, copy.position.y);
+                ASSERT_EQ(copy.position.y, copy.position.z);
+                ASSERT_EQ((int)copy.temperature, copy.sunlight_on);
+                ASSERT_EQ(copy.sunlight_on, copy.heater_on);
+                last = version;
+            }
+        }));
+    }
+    for (int i = 1; i <= versions; i++)
+    {
+        state.temperature = i;
+        state.position.x = state.position.y = state.position.z = (float)i;
+        state.sunlight_on = state.heater_on = i;
+        seqlock_publish(&lock, &state);
+    }
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+
+    ASSERT_EQ((uint32_t)(2 * versions), lock.seq);
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,395 @@
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdio.h>
+
+extern "C"
+{
+#include "clock.h"
+#include "protocol.h"
+#include "sim.h"
+}
+
+/**********************************************************
+ *  Test: sim_run -> wrong_config
+ *********************************************************/
+TEST(test_sim_run, wrong_config)
+{
+    struct sim_config config;
+    struct sim_stats stats;
+
+    sim_default_config(&config);
+    config.duration = 0.0;
+    ASSERT_EQ(-1, sim_run(&config, &stats));
+
+    sim_default_config(&config);
+    config.baud_rate = 0.0;
+    ASSERT_EQ(-1, sim_run(&config, &stats));
+}
+
+/**********************************************************
+ *  Test: sim_run -> one_hour
+ *********************************************************/
+TEST(test_sim_run, one_hour)
+{
+    struct sim_config config;
+    struct sim_stats stats;
+
+    sim_default_config(&config);
+    ASSERT_EQ(0, sim_run(&config, &stats));
+
+    // the whole hour is simulated
+    ASSERT_DOUBLE_EQ(3600.0, stats.sim_time);
+    ASSERT_EQ(36001UL, stats.slave_loops);
+
+    // every task runs at its own rate: 1800 releases of B, C and D, 900 of
+    // E and F and 720 of A, all of them before the next one
+    ASSERT_GE(stats.jobs, 7920UL - 6);
+    ASSERT_LE(stats.jobs, 7920UL + 6);
+    ASSERT_EQ(0UL, stats.deadline_misses);
+    ASSERT_EQ(0UL, stats.overruns);
+    ASSERT_LT(stats.max_response, 2.0);
+
+    // with the latencies of each release
+    uint64_t responses = 0;
+    for (int i = 0; i < TASKS; i++)
+    {
+        responses += histogram_count(&stats.response[i]);
+        ASSERT_EQ(histogram_count(&stats.response[i]), histogram_count(&stats.jitter[i]));
+    }
+    ASSERT_EQ(stats.jobs, responses);
+    ASSERT_EQ(0UL, histogram_count(&stats.round_trip[TASK_B]));
+    ASSERT_LT(histogram_percentile(&stats.response[TASK_C], 99.0), TASK_C_PERIOD * NS_PER_MS);
+    ASSERT_EQ(0UL, stats.frame_errors);
+    ASSERT_EQ(0UL, stats.retransmits);
+
+    // every command gets its answer (but those cut by the end of the run)
+    ASSERT_GE(stats.bytes_to_slave, stats.commands * (wire_size_cmd_msg(BATCH_CMD) + FRAME_OVERHEAD));
+    ASSERT_LT(stats.bytes_to_slave, (stats.commands + config.window) * (CMD_MSG_WIRE_SIZE + FRAME_OVERHEAD));
+    ASSERT_GE(stats.bytes_to_master, stats.commands * (2 + FRAME_OVERHEAD));
+    ASSERT_LE(stats.bytes_to_master, (stats.commands + stats.pushes + config.window) * (RES_MSG_WIRE_SIZE + FRAME_OVERHEAD));
+
+    // the heater keeps the temperature around the average
+    ASSERT_GT(stats.heater_switches, 0UL);
+    ASSERT_GT(stats.max_temperature, 40.0);
+    ASSERT_LT(stats.max_temperature, 90.0);
+}
+
+/**********************************************************
+ *  Test: sim_run -> noisy_link
+ *********************************************************/
+TEST(test_sim_run, noisy_link)
+{
+    struct sim_config config;
+    struct sim_stats clean;
+    struct sim_stats noisy;
+
+    sim_default_config(&config);
+    ASSERT_EQ(0, sim_run(&config, &clean));
+    config.error_rate = 0.002;
+    ASSERT_EQ(0, sim_run(&config, &noisy));
+
+    // the exchanges received wrong are sent again at once
+    ASSERT_GT(noisy.retransmits, 0UL);
+    ASSERT_GT(noisy.frame_errors, 0UL);
+    ASSERT_LT(noisy.failed_commands, noisy.retransmits / 10 + 1);
+
+    // and only cost a few periods over the hour
+    ASSERT_GT(noisy.commands + noisy.failed_commands, clean.commands * 90 / 100);
+    ASSERT_GT(noisy.heater_switches, clean.heater_switches * 80 / 100);
+
+    config.error_rate = 1.5;
+    ASSERT_EQ(-1, sim_run(&config, &noisy));
+}
+
+/**********************************************************
+ *  Test: sim_run -> window
+ *********************************************************/
+TEST(test_sim_run, window)
+{
+    struct sim_config config;
+    struct sim_stats single;
+    struct sim_stats windowed;
+
+    sim_default_config(&config);
+    config.subscribe = 0;
+    config.batch = 0;
+    config.window = 1;
+    ASSERT_EQ(0, sim_run(&config, &single));
+    config.window = 4;
+    ASSERT_EQ(0, sim_run(&config, &windowed));
+
+    // the requests waiting together share the wait for the answers
+    ASSERT_EQ(single.commands, windowed.commands);
+    ASSERT_LT(windowed.max_response, single.max_response / 2);
+    ASSERT_EQ(0UL, windowed.failed_commands);
+    ASSERT_EQ(0UL, windowed.retransmits);
+
+    config.window = 9;
+    ASSERT_EQ(-1, sim_run(&config, &windowed));
+}
+
+/**********************************************************
+ *  Test: sim_run -> deadline_order
+ *********************************************************/
+TEST(test_sim_run, deadline_order)
+{
+    struct sim_config config;
+    struct sim_stats stats;
+
+    sim_default_config(&config);
+    config.subscribe = 0;
+    config.batch = 0;
+    config.window = 1;
+    ASSERT_EQ(0, sim_run(&config, &stats));
+
+    // the heater waits for a single exchange at most, never behind the
+    // position released with it
+    ASSERT_LT(stats.jitter[TASK_D].max, 2 * stats.round_trip[TASK_C].max);
+    ASSERT_LT(stats.jitter[TASK_D].max, stats.jitter[TASK_F].max);
+    ASSERT_EQ(0UL, stats.deadline_misses);
+}
+
+/**********************************************************
+ *  Test: sim_run -> overrun_policy
+ *********************************************************/
+TEST(test_sim_run, overrun_policy)
+{
+    struct sim_config config;
+    struct sim_stats skip;
+    struct sim_stats catch_up;
+    struct sim_stats degrade;
+
+    // a noisy link at the slowest settings overloads the tasks
+    sim_default_config(&config);
+    config.error_rate = 0.05;
+    config.subscribe = 0;
+    config.batch = 0;
+    config.window = 1;
+    config.max_baud_rate = 0.0;
+    ASSERT_EQ(0, sim_run(&config, &skip));
+    config.overrun_policy = OVERRUN_CATCH_UP;
+    ASSERT_EQ(0, sim_run(&config, &catch_up));
+    config.overrun_policy = OVERRUN_DEGRADE;
+    ASSERT_EQ(0, sim_run(&config, &degrade));
+
+    // the releases missed are lost, run late or make room for the others
+    ASSERT_GT(skip.deadline_misses, 0UL);
+    ASSERT_GT(skip.overruns, 0UL);
+    ASSERT_EQ(0UL, skip.shed_releases);
+    ASSERT_GT(catch_up.jobs, skip.jobs);
+    ASSERT_GT(degrade.shed_releases, 0UL);
+    ASSERT_LT(degrade.deadline_misses, skip.deadline_misses);
+    ASSERT_LT(degrade.overruns, skip.overruns);
+
+    config.overrun_policy = 3;
+    ASSERT_EQ(-1, sim_run(&config, &skip));
+}
+
+/**********************************************************
+ *  Test: sim_run -> adaptive
+ *********************************************************/
+TEST(test_sim_run, adaptive)
+{
+    struct sim_config config;
+    struct sim_stats fixed;
+    struct sim_stats adaptive;
+
+    // the temperature polled, one request each
+    sim_default_config(&config);
+    config.subscribe = 0;
+    config.batch = 0;
+    ASSERT_EQ(0, sim_run(&config, &fixed));
+    config.adaptive = 1;
+    ASSERT_EQ(0, sim_run(&config, &adaptive));
+
+    // fewer readings far from the setpoint, the same control
+    ASSERT_EQ(0UL, fixed.skipped_reads);
+    ASSERT_GT(adaptive.skipped_reads, 0UL);
+    ASSERT_EQ(fixed.commands - adaptive.skipped_reads, adaptive.commands);
+    ASSERT_EQ(fixed.heater_switches, adaptive.heater_switches);
+    ASSERT_DOUBLE_EQ(fixed.min_temperature, adaptive.min_temperature);
+    ASSERT_DOUBLE_EQ(fixed.max_temperature, adaptive.max_temperature);
+
+    // the temperature pushed: there are no requests to skip
+    config.subscribe = 1;
+    config.adaptive = 0;
+    ASSERT_EQ(0, sim_run(&config, &fixed));
+    config.adaptive = 1;
+    ASSERT_EQ(0, sim_run(&config, &adaptive));
+    ASSERT_EQ(0UL, adaptive.skipped_reads);
+    ASSERT_EQ(fixed.commands, adaptive.commands);
+    ASSERT_EQ(fixed.heater_switches, adaptive.heater_switches);
+}
+
+/**********************************************************
+ *  Test: sim_run -> heater_state
+ *********************************************************/
+TEST(test_sim_run, heater_state)
+{
+    struct sim_config config;
+    struct sim_stats stats;
+
+    // the heater set by SET_HEAT_CMD alone
+    sim_default_config(&config);
+    config.subscribe = 0;
+    config.batch = 0;
+    ASSERT_EQ(0, sim_run(&config, &stats));
+
+    // the master sees the heater on once the slave has done it
+    ASSERT_GT(stats.heater_switches, 0UL);
+    ASSERT_GT(stats.heater_confirmed, 0UL);
+    ASSERT_EQ(0UL, stats.failed_commands);
+}
+
+/**********************************************************
+ *  Test: sim_run -> batch
+ *********************************************************/
+TEST(test_sim_run, batch)
+{
+    struct sim_config config;
+    struct sim_stats separate;
+    struct sim_stats batched;
+
+    sim_default_config(&config);
+    config.max_baud_rate = 0.0;
+    config.subscribe = 0;
+    config.batch = 0;
+    ASSERT_EQ(0, sim_run(&config, &separate));
+    config.batch = 1;
+    ASSERT_EQ(0, sim_run(&config, &batched));
+
+    // a single request and answer for the requests waiting together
+    ASSERT_LT(batched.commands, separate.commands / 2);
+    ASSERT_LT(batched.max_response, separate.max_response);
+    ASSERT_LT(batched.bytes_to_slave, separate.bytes_to_slave);
+    ASSERT_EQ(0UL, batched.failed_commands);
+    ASSERT_GT(batched.heater_switches, 0UL);
+    ASSERT_GT(batched.heater_confirmed, 0UL);
+}
+
+/**********************************************************
+ *  Test: sim_run -> subscribe
+ *********************************************************/
+TEST(test_sim_run, subscribe)
+{
+    struct sim_config config;
+    struct sim_stats polled;
+    struct sim_stats pushed;
+
+    sim_default_config(&config);
+    config.subscribe = 0;
+    ASSERT_EQ(0, sim_run(&config, &polled));
+    config.subscribe = 1;
+    ASSERT_EQ(0, sim_run(&config, &pushed));
+
+    // the readings come without requests, at least once per period and
+    // at once on a large change, and only the heater is set by the tasks
+    ASSERT_EQ(0UL, polled.pushes);
+    ASSERT_GE(pushed.pushes, 1800UL - 1);
+    ASSERT_EQ(0UL, pushed.frame_errors);
+    ASSERT_EQ(0UL, pushed.failed_commands);
+    ASSERT_LT(pushed.bytes_to_slave, polled.bytes_to_slave);
+    ASSERT_LT(pushed.max_temperature, polled.max_temperature);
+    ASSERT_GT(pushed.heater_switches, 0UL);
+}
+
+/**********************************************************
+ *  Test: sim_run -> adaptive_timeout
+ *********************************************************/
+TEST(test_sim_run, adaptive_timeout)
+{
+    struct sim_config config;
+    struct sim_stats stats;
+
+    sim_default_config(&config);
+    config.duration = 600.0;
+    ASSERT_EQ(0, sim_run(&config, &stats));
+
+    // the answer comes with the second slave loop after the request, the
+    // master reads it then and waits a little longer only when it is lost
+    ASSERT_GT(stats.srtt, 0.1);
+    ASSERT_LT(stats.srtt, 0.25);
+    ASSERT_GE(stats.rto, stats.srtt);
+    ASSERT_LT(stats.rto, 0.4);
+    ASSERT_GE(stats.commands, 600UL / 2);
+}
+
+/**********************************************************
+ *  Test: sim_run -> handshake
+ *********************************************************/
+TEST(test_sim_run, handshake)
+{
+    struct sim_config config;
+    struct sim_stats stats;
+
+    // the fastest rate asked by the master
+    sim_default_config(&config);
+    config.duration = 60.0;
+    ASSERT_EQ(0, sim_run(&config, &stats));
+    ASSERT_DOUBLE_EQ(115200.0, stats.baud_rate);
+    ASSERT_EQ(0UL, stats.frame_errors);
+
+    // both ends go back to 9600 after each rate the line does not carry
+    config.line_baud_rate = 40000.0;
+    ASSERT_EQ(0, sim_run(&config, &stats));
+    ASSERT_DOUBLE_EQ(38400.0, stats.baud_rate);
+    ASSERT_GT(stats.commands, 20UL);
+
+    // without handshake the link stays at the first rate
+    config.max_baud_rate = 0.0;
+    ASSERT_EQ(0, sim_run(&config, &stats));
+    ASSERT_DOUBLE_EQ(9600.0, stats.baud_rate);
+
+    config.max_baud_rate = -1.0;
+    ASSERT_EQ(-1, sim_run(&config, &stats));
+}
+
+/**********************************************************
+ *  Test: sim_run -> deterministic
+ *********************************************************/
+TEST(test_sim_run, deterministic)
+{
+    struct sim_config config;
+    struct sim_stats first;
+    struct sim_stats second;
+
+    sim_default_config(&config);
+    config.duration = 86400.0;
+    ASSERT_EQ(0, sim_run(&config, &first));
+    ASSERT_EQ(0, sim_run(&config, &second));
+
+    ASSERT_EQ(0, memcmp(&first, &second, sizeof(struct sim_stats)));
+}
+
+/**********************************************************
+ *  Test: sim_run -> paced_as_unpaced
+ *********************************************************/
+TEST(test_sim_run, paced_as_unpaced)
+{
+    struct sim_config config;
+    struct sim_stats fast;
+    struct sim_stats paced;
+
+    // the pacing on the wall clock changes nothing: the run is compared
+    // with itself as fast as possible, not with a real time master
+    sim_default_config(&config);
+    config.duration = 20.0;
+    ASSERT_EQ(0, sim_run(&config, &fast));
+    config.speed = 40.0;
+    ASSERT_EQ(0, sim_run(&config, &paced));
+
+    ASSERT_EQ(0, memcmp(&fast, &paced, sizeof(struct sim_stats)));
+}
+
+/**********************************************************
+ *  Function: main
+ *********************************************************/
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -6,10 +6,16 @@
 #include <time.h>
 #include <math.h>
 
+// messages and codecs generated from Part A/code/protocol.schema
+#include "protocol.h"
+
 // --------------------------------------
 // CONSTANTS
 // --------------------------------------
 
+#define NS_PER_S 1000000000LL
+#define NS_PER_US 1000LL
+
 #define SHIP_SPECIFC_HEAT 0.9
 #define SHIP_MASS 10.0         // Kg
 #define HEATER_POWER 150.0     // J/sec
@@ -18,45 +24,23 @@
 
 #define ORBIT_POINTS_SIZE 20
 #define ORBIT_TIME 300.0 // sec
-
-// --------------------------------------
-// Types
-// --------------------------------------
-
-// structture of a position on the orbit
-struct position
-{
-  float x;
-  float y;
-  float z;
-};
-
-// list of commands to be send
-enum command
-{
-  NO_CMD = 0,
-  SET_HEAT_CMD = 1,
-  READ_SUN_CMD = 2,
-  READ_TEMP_CMD = 3,
-  READ_POS_CMD = 4
-};
-
-// structure of command message
-struct cmd_msg
-{
-  short int cmd;        // command to execute
-  short int set_heater; // boolean to set or unset the heater
-};
-
-// structure of response message
-struct res_msg
-{
-  short int cmd;            // command to respond to
-  short int status;         // boolean to state if execution went well
-  short int sunlight_on;    // boolean to state if sunlight is on
-  float temperature;        // value of the temperature
-  struct position position; // value of the position
-};
+#define ORBIT_TIME_NS (300LL * NS_PER_S)
+
+// parts of the state a BATCH_CMD can execute
+#define BATCH_PARTS (BATCH_SET_HEAT | BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS)
+// optional parts of the protocol this firmware has
+#define SLAVE_FEATURES (FEATURE_BATCH | FEATURE_WINDOW | FEATURE_PUSH)
+// readings a SUBSCRIBE_CMD can push
+#define PUSH_PARTS (BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS)
+// rates of the UART agreed in a HELLO_CMD, slowest (the one at startup) first
+#define HELLO_RATES_SIZE 8
+
+#define CMD_QUEUE_SIZE 8 // commands answered in one loop
+// address of this slave on the link, a different one for every slave
+// sharing it (enum address)
+#define NODE_ADDR DEFAULT_ADDR
+// time at a new rate without a good frame before going back to the first
+#define HELLO_CONFIRM_TIMEOUT 2000 // ms
 
 // --------------------------------------
 // PUBLIC STATUS (GLOBAL VARIABLES)
@@ -67,25 +51,28 @@ int heater_on = 0;
 int sunlight_on = 0;
 // Save the actual temperature of the ship
 double temperature = 0.0;
-// save the last time temperature was computed
-double time_temperature = 0.0;
-// inital time of the orbit
-double init_time_orbit = 0.0;
+// save the last time temperature was computed (ns)
+int64_t time_temperature = 0;
+// inital time of the orbit (ns)
+int64_t init_time_orbit = 0;
 // actual position of the ship
 struct position position = {0.0, 0.0, 0.0};
 
-bool command_in_process = false;
 bool response_ready = false;
 
 // last command message received
-struct cmd_msg last_cmd_msg = {NO_CMD, 0};
+struct cmd_msg last_cmd_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
 // next response message to be send
-struct res_msg next_res_msg = {NO_CMD, 0};
+struct res_msg next_res_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
 
 // --------------------------------------
 // PRIVATE STATUS (STATIC GLOBAL VARIABLES)
 // --------------------------------------
 
+// rates of the UART agreed in a HELLO_CMD (bits/sec)
+static const uint32_t hello_rates[HELLO_RATES_SIZE] = {
+    9600, 19200, 38400, 57600, 115200, 250000, 500000, 1000000};
+
 // position data for the orbit
 static struct position orbit_points[ORBIT_POINTS_SIZE] = {
     {3000.00, 0, 12000.0},
@@ -109,19 +96,74 @@ static struct position orbit_points[ORBIT_POINTS_SIZE] = {
     {2427.050983124840, -3526.711513754840, 9708.203932499370},
     {2853.169548885460, -1854.101966249690, 11412.678195541800}};
 
-// Command message parity
-unsigned char cmd_parity = (unsigned char)0;
+// Command frame being received
+struct frame_parser cmd_parser = {{0}, {0}, 0, 0, 0};
+
+// commands received in the last loop and their answers, in order
+struct cmd_msg cmd_queue[CMD_QUEUE_SIZE];
+struct res_msg res_queue[CMD_QUEUE_SIZE];
+int queue_count = 0;
+// boolean to state if the last good frame was addressed to this slave:
+// the wrong frames of a master talking to another slave are not NACKed
+bool addressed = true;
+
+// rate of the UART, and boolean to state if a good frame came at that rate
+uint32_t baud_rate = 9600;
+bool baud_confirmed = true;
+// time of the last change of rate (ms)
+unsigned long baud_time = 0;
+
+// readings pushed without a request
+struct subscription subscription = {0, 0, 0.0};
+// boolean to push at once, time of the last push (ms) and its readings
+bool push_now = false;
+unsigned long push_time = 0;
+struct batch_data pushed;
 
 //---------------------------------------------------------------------------
 //                           AUXILIAR FUNCTIONS
 //---------------------------------------------------------------------------
 
+// --------------------------------------
+// Function: set_baud_rate
+// --------------------------------------
+void set_baud_rate(uint32_t rate)
+{
+  // the answers still in the buffer go out at the old rate
+  Serial.flush();
+  Serial.begin(rate);
+  baud_rate = rate;
+  baud_confirmed = (rate == hello_rates[0]);
+  baud_time = millis();
+  cmd_parser.count = 0;
+}
+
+// --------------------------------------
+// Function: clock_now_ns
+// --------------------------------------
+// monotonic time in ns. micros() wraps every ~71 minutes, so the wraps
+// are accumulated here (loop() calls it much more often than that)
+int64_t clock_now_ns()
+{
+  static unsigned long last_us = 0;
+  static int64_t wrap_us = 0;
+  unsigned long now_us = micros();
+
+  if (now_us < last_us)
+  {
+    wrap_us += 0x100000000LL;
+  }
+  last_us = now_us;
+
+  return (wrap_us + (int64_t)now_us) * NS_PER_US;
+}
+
 // --------------------------------------
 // Function: getClock
 // --------------------------------------
 double getClock()
 {
-  return ((double)millis()) / 1000.0;
+  return ((double)clock_now_ns()) / ((double)NS_PER_S);
 }
 
 // --------------------------------------
@@ -140,81 +182,135 @@ void delayClock(double time)
 // --------------------------------------
 int comm_server()
 {
-  static int count = 0;
   unsigned char car_aux;
-
-  // If there were a received msg, send the processed answer or ERROR if none.
-  // then reset for the next request.
-  // NOTE: this requires that between two calls of com_server all possible
-  //       answers have been processed.
-  if (command_in_process)
+  uint32_t next_rate = baud_rate;
+  int ret;
+
+  // Send the answers of the commands received in the last loop, in the
+  // order of the requests, then queue the commands received since.
+  // NOTE: this requires that between two calls of com_server all the
+  //       queued commands have been processed (exec_cmd_queue).
+  for (int i = 0; i < queue_count; i++)
   {
-    // if there is an answer send it, else error
-    if (!response_ready)
+    // a broadcast is executed but never answered
+    if (res_queue[i].addr == BROADCAST_ADDR)
     {
-      next_res_msg.cmd = NO_CMD;
-      next_res_msg.status = 1;
+      continue;
     }
-    // compute parity
-    unsigned char res_parity = (unsigned char)0;
-    for (int i = 0; i < sizeof(struct res_msg); i++)
+    // send the answer in a frame: only the answered field goes on the wire
+    unsigned char frame[FRAME_MAX_SIZE];
+    int size = frame_close(frame, encode_res_msg(&res_queue[i], frame + 1));
+    Serial.write(frame, size);
+
+    // the rate agreed in a HELLO_CMD is taken once its answer is sent
+    if (res_queue[i].cmd == HELLO_CMD && res_queue[i].status == STATUS_DONE)
     {
-      // compute parity (xor)
-      res_parity = res_parity ^ ((unsigned char *)(&next_res_msg))[i];
+      next_rate = res_queue[i].data.hello.baud;
     }
-    Serial.write((unsigned char *)(&next_res_msg), sizeof(struct res_msg));
-    Serial.write((unsigned char *)(&res_parity), 1);
-    // reset flags and buffers
-    command_in_process = false;
-    response_ready = false;
-    memset((unsigned char *)(&last_cmd_msg), 0, sizeof(struct cmd_msg));
-    memset((unsigned char *)(&next_res_msg), 0, sizeof(struct res_msg));
+  }
+  queue_count = 0;
+  if (next_rate != baud_rate)
+  {
+    set_baud_rate(next_rate);
+  }
+  // back to the first rate if the master never came to the new one
+  else if (!baud_confirmed && millis() - baud_time > HELLO_CONFIRM_TIMEOUT)
+  {
+    set_baud_rate(hello_rates[0]);
   }
 
-  while (Serial.available())
+  while (Serial.available() && queue_count < CMD_QUEUE_SIZE)
   {
     // read one character
     car_aux = Serial.read();
-    if ((count == 0) && (car_aux > 4))
+    ret = frame_parse_byte(&cmd_parser, car_aux);
+    if (ret == FRAME_INCOMPLETE)
     {
       continue;
     }
-    // Check if it is the last byte of the msg or not.
-    if (count == sizeof(struct cmd_msg))
+    // the address is the first byte of the message: a frame for another
+    // slave is dropped without decoding it
+    if (ret == FRAME_COMPLETE && cmd_parser.message[0] != NODE_ADDR &&
+        cmd_parser.message[0] != BROADCAST_ADDR)
     {
-      // check parity error
-      if (cmd_parity != car_aux)
-      {
-        // set error answer
-        last_cmd_msg.cmd = NO_CMD;
-        last_cmd_msg.set_heater = 0;
-        command_in_process = true;
-        next_res_msg.cmd = NO_CMD;
-        next_res_msg.status = 2;
-        response_ready = true;
-        cmd_parity = (unsigned char)0;
-        count = 0;
-        // end loop
-        break;
-      }
-      // finish reading msg
-      cmd_parity = (unsigned char)0;
-      count = 0;
-      command_in_process = true;
-
-      break;
+      addressed = false;
+      continue;
+    }
+    if (ret == FRAME_WRONG && !addressed)
+    {
+      continue;
+    }
+    memset((unsigned char *)(&res_queue[queue_count]), 0, sizeof(struct res_msg));
+    // check parity error or wrong message
+    if (ret == FRAME_WRONG ||
+        decode_cmd_msg(cmd_parser.message, cmd_parser.size, &cmd_queue[queue_count]) < 0)
+    {
+      // set error answer
+      memset((unsigned char *)(&cmd_queue[queue_count]), 0, sizeof(struct cmd_msg));
+      res_queue[queue_count].addr = NODE_ADDR;
+      res_queue[queue_count].cmd = NO_CMD;
+      res_queue[queue_count].status = STATUS_NACK;
     }
     else
     {
-      // Store the character
-      ((unsigned char *)(&last_cmd_msg))[count] = car_aux;
-      // compute parity (xor)
-      cmd_parity = cmd_parity ^ car_aux;
+      // the master talks at this rate
+      baud_confirmed = true;
+      addressed = (cmd_queue[queue_count].addr == NODE_ADDR);
     }
+    queue_count++;
+  }
+}
 
-    // Increment the count
-    count++;
+// --------------------------------------
+// Function: push_server
+// --------------------------------------
+// pushes the readings subscribed when its period has elapsed, the sunlight
+// has changed or the temperature has moved more than its delta
+void push_server()
+{
+  bool due = push_now;
+
+  if (subscription.parts == 0)
+  {
+    return;
+  }
+  if (subscription.period > 0 && millis() - push_time >= subscription.period)
+  {
+    due = true;
+  }
+  if ((subscription.parts & BATCH_READ_SUN) && sunlight_on != pushed.sunlight_on)
+  {
+    due = true;
   }
+  if ((subscription.parts & BATCH_READ_TEMP) && subscription.delta > 0 &&
+      fabs(temperature - pushed.temperature) > subscription.delta)
+  {
+    due = true;
+  }
+  if (!due)
+  {
+    return;
+  }
+
+  // the push is an answer without request: seq 0 and TELEMETRY_CMD
+  struct res_msg push;
+  memset((unsigned char *)(&push), 0, sizeof(struct res_msg));
+  push.addr = NODE_ADDR;
+  push.cmd = TELEMETRY_CMD;
+  push.status = 1;
+  push.data.batch.batch = subscription.parts;
+  push.data.batch.heater_on = heater_on;
+  push.data.batch.sunlight_on = sunlight_on;
+  push.data.batch.temperature = temperature;
+  push.data.batch.position = position;
+
+  unsigned char frame[FRAME_MAX_SIZE];
+  int size = frame_close(frame, encode_res_msg(&push, frame + 1));
+  Serial.write(frame, size);
+
+  pushed = push.data.batch;
+  push_time = millis();
+  push_now = false;
 }
 
 /**********************************************************
@@ -223,8 +319,9 @@ int comm_server()
 void get_temperature()
 {
   // Calculate the elapsed time since the last temperature update
-  double current_time = getClock();
-  double elapsed_time = current_time - time_temperature;
+  // (difference taken in ns so no precision is lost in the float of the AVR)
+  int64_t current_time = clock_now_ns();
+  double elapsed_time = ((double)(current_time - time_temperature)) / ((double)NS_PER_S);
 
   // Calculate the total power gained or lost by the satellite
   double total_power = HEAT_POWER_LOSS;
@@ -255,9 +352,9 @@ void get_temperature()
 void get_position()
 {
   // Calculate the time elapsed since the last orbit started (relative time)
-  // fmod is used to get the division module of the result and the time for a single orbit
-  double current_time = getClock();
-  double relative_time = fmod(current_time - init_time_orbit, ORBIT_TIME);
+  // the module with the time for a single orbit is taken in ns so no precision is lost
+  int64_t current_time = clock_now_ns();
+  double relative_time = ((double)((current_time - init_time_orbit) % ORBIT_TIME_NS)) / ((double)NS_PER_S);
 
   // Calculate the indices of the two consecutive positions in the orbit_points array
   int previous_position_index = (int)((relative_time * ORBIT_POINTS_SIZE) / ORBIT_TIME);
@@ -281,8 +378,16 @@ void get_position()
 
 void exec_cmd_msg()
 {
-  // Initialize the response message with default values
-  last_cmd_msg.cmd = last_cmd_msg.cmd;
+  // a NACK prepared by comm_server goes out as it is
+  if (next_res_msg.status == STATUS_NACK)
+  {
+    return;
+  }
+
+  // Initialize the response message with default values, addressed as
+  // the request: the answer to a broadcast is never sent
+  next_res_msg.addr = last_cmd_msg.addr;
+  next_res_msg.seq = last_cmd_msg.seq;
   next_res_msg.status = 0; // Default status is failure (0)
 
   switch (last_cmd_msg.cmd)
@@ -307,7 +412,7 @@ void exec_cmd_msg()
     // Set the status in the response message to indicate success
     next_res_msg.status = 1;
     // Set the sunlight_on value in the response message
-    next_res_msg.sunlight_on = sunlight_on;
+    next_res_msg.data.sunlight_on = sunlight_on;
     break;
 
   case READ_TEMP_CMD:
@@ -316,7 +421,7 @@ void exec_cmd_msg()
     next_res_msg.cmd = READ_TEMP_CMD;
     // Set the status in the response message to indicate success
     next_res_msg.status = 1;
-    next_res_msg.temperature = temperature;
+    next_res_msg.data.temperature = temperature;
     break;
 
   case READ_POS_CMD:
@@ -325,7 +430,71 @@ void exec_cmd_msg()
     next_res_msg.cmd = READ_POS_CMD;
     // Set the status in the response message to indicate success
     next_res_msg.status = 1;
-    next_res_msg.position = position;
+    next_res_msg.data.position = position;
+    break;
+
+  case BATCH_CMD:
+    // Execute every part of the state requested in a single answer
+    next_res_msg.cmd = BATCH_CMD;
+    next_res_msg.data.batch.batch = last_cmd_msg.batch & BATCH_PARTS;
+    if (last_cmd_msg.batch & BATCH_SET_HEAT)
+    {
+      // Update the heater status as SET_HEAT_CMD
+      if (last_cmd_msg.set_heater == 1)
+      {
+        heater_on = 1;
+      }
+      else if (last_cmd_msg.set_heater == 0)
+      {
+        heater_on = 0;
+      }
+    }
+    if (last_cmd_msg.batch & BATCH_READ_TEMP)
+    {
+      get_temperature();
+    }
+    if (last_cmd_msg.batch & BATCH_READ_POS)
+    {
+      get_position();
+    }
+    next_res_msg.data.batch.heater_on = heater_on;
+    next_res_msg.data.batch.sunlight_on = sunlight_on;
+    next_res_msg.data.batch.temperature = temperature;
+    next_res_msg.data.batch.position = position;
+    // Set the status in the response message to indicate success
+    next_res_msg.status = 1;
+    break;
+
+  case HELLO_CMD:
+    // Agree on the features of both ends and on the fastest rate of the
+    // UART not above the one asked; a master of another version gets none
+    next_res_msg.cmd = HELLO_CMD;
+    next_res_msg.data.hello.version = PROTOCOL_VERSION;
+    next_res_msg.data.hello.features = 0;
+    next_res_msg.data.hello.baud = hello_rates[0];
+    if (last_cmd_msg.data.hello.version == PROTOCOL_VERSION)
+    {
+      next_res_msg.data.hello.features = last_cmd_msg.data.hello.features & SLAVE_FEATURES;
+      for (int i = 1; i < HELLO_RATES_SIZE; i++)
+      {
+        if (hello_rates[i] <= last_cmd_msg.data.hello.baud)
+        {
+          next_res_msg.data.hello.baud = hello_rates[i];
+        }
+      }
+    }
+    // Set the status in the response message to indicate success
+    next_res_msg.status = 1;
+    break;
+
+  case SUBSCRIBE_CMD:
+    // Keep the readings to push, the first push goes out at once
+    subscription = last_cmd_msg.data.subscription;
+    subscription.parts &= PUSH_PARTS;
+    push_now = true;
+    next_res_msg.cmd = SUBSCRIBE_CMD;
+    // Set the status in the response message to indicate success
+    next_res_msg.status = 1;
     break;
 
   default:
@@ -337,6 +506,23 @@ void exec_cmd_msg()
   }
 }
 
+/**********************************************************
+ *  Function: exec_cmd_queue
+ *********************************************************/
+void exec_cmd_queue()
+{
+  // answer the queued commands one after the other
+  for (int i = 0; i < queue_count; i++)
+  {
+    last_cmd_msg = cmd_queue[i];
+    next_res_msg = res_queue[i];
+    exec_cmd_msg();
+    res_queue[i] = next_res_msg;
+  }
+  memset((unsigned char *)(&last_cmd_msg), 0, sizeof(struct cmd_msg));
+  memset((unsigned char *)(&next_res_msg), 0, sizeof(struct res_msg));
+}
+
 /**********************************************************
  *  Function: read_sun_sensor
  *********************************************************/
@@ -384,7 +570,7 @@ void set_heater()
 void setup()
 {
   // Setup Serial Monitor
-  Serial.begin(9600);
+  Serial.begin(baud_rate);
   pinMode(13, OUTPUT);
 }
 
@@ -394,10 +580,11 @@ void setup()
 void loop()
 {
   comm_server();
-  exec_cmd_msg();
+  exec_cmd_queue();
   get_temperature();
   get_position();
   read_sun_sensor();
+  push_server();
   set_heater();
   delay(100);
 }
@@ -0,0 +1,759 @@
+/**********************************************************
+ *  Generated by protogen from protocol.schema, do not edit:
+ *  change the schema and run protogen again
+ *********************************************************/
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+/**********************************************************
+ *  INCLUDES
+ *********************************************************/
+
+#include <stdint.h>
+#include <string.h>
+
+/**********************************************************
+ *  CONSTANTS
+ *********************************************************/
+
+// largest size of each message on the wire (little endian, no padding)
+#define POSITION_WIRE_SIZE 9
+#define HELLO_WIRE_SIZE 6
+#define SUBSCRIPTION_WIRE_SIZE 7
+#define CMD_MSG_WIRE_SIZE 12
+#define BATCH_DATA_WIRE_SIZE 13
+#define RES_MSG_WIRE_SIZE 17
+#define PROTOCOL_MAX_WIRE_SIZE 17
+
+// frame: code byte, message, CRC and delimiter
+#define FRAME_CRC_SIZE 2
+#define FRAME_OVERHEAD (FRAME_CRC_SIZE + 2)
+#define FRAME_MAX_SIZE (PROTOCOL_MAX_WIRE_SIZE + FRAME_OVERHEAD)
+
+// results of frame_parse_byte
+#define FRAME_INCOMPLETE 0
+#define FRAME_COMPLETE 1
+#define FRAME_WRONG -1
+
+/**********************************************************
+ *  TYPES
+ *********************************************************/
+
+// list of commands to be send
+enum command
+{
+    NO_CMD = 0,
+    SET_HEAT_CMD = 1,
+    READ_SUN_CMD = 2,
+    READ_TEMP_CMD = 3,
+    READ_POS_CMD = 4,
+    BATCH_CMD = 5,
+    HELLO_CMD = 6,
+    SUBSCRIBE_CMD = 7,
+    TELEMETRY_CMD = 8  // pushed by the slave, never requested
+};
+
+// value of hello.version
+enum version
+{
+    PROTOCOL_VERSION = 3  // messages addressed to one slave of the link
+};
+
+// values of cmd_msg.addr and res_msg.addr
+enum address
+{
+    BROADCAST_ADDR = 0, // every slave executes it and none answers
+    DEFAULT_ADDR = 8    // slave alone on its link
+};
+
+// bits of cmd_msg.batch, 1 << (command - 1)
+enum batch
+{
+    BATCH_SET_HEAT = 1,  // set the heater as cmd_msg.set_heater
+    BATCH_READ_SUN = 2,  // read the sunlight
+    BATCH_READ_TEMP = 4, // read the temperature
+    BATCH_READ_POS = 8   // read the position
+};
+
+// bits of hello.features, optional parts of the protocol
+enum feature
+{
+    FEATURE_BATCH = 1,  // BATCH_CMD is executed
+    FEATURE_WINDOW = 2, // up to 8 requests are answered in one loop
+    FEATURE_PUSH = 4    // SUBSCRIBE_CMD makes the slave push TELEMETRY_CMD
+};
+
+// values of res_msg.status
+enum status
+{
+    STATUS_FAILED = 0, // command not executed
+    STATUS_DONE = 1,   // command executed
+    STATUS_NACK = 2    // request received wrong, send it again
+};
+
+// structture of a position on the orbit
+struct position
+{
+    float x; // m, the orbit stays within +-12000
+    float y;
+    float z;
+};
+
+// capabilities of one end, HELLO_CMD at startup
+struct hello
+{
+    unsigned char version;  // PROTOCOL_VERSION of the sender
+    unsigned char features; // optional parts of the protocol (enum feature)
+    uint32_t baud;          // rate asked by the master, agreed by the slave
+};
+
+// readings the slave pushes, SUBSCRIBE_CMD
+struct subscription
+{
+    unsigned char parts;       // readings pushed (enum batch, 0 = none)
+    unsigned short int period; // time between pushes (ms, 0 = only on change)
+    float delta;               // change of temperature pushed at once (0 = none)
+};
+
+// structure of command message
+struct cmd_msg
+{
+    unsigned char addr;       // slave that executes it, first on the wire
+    unsigned char seq;        // sequence number, echoed in the answer
+    unsigned char cmd;        // command to execute
+    unsigned char set_heater; // boolean to set or unset the heater
+    unsigned char batch;      // parts of a BATCH_CMD (enum batch)
+    union
+    {
+        struct hello hello;               // capabilities of the master
+        struct subscription subscription; // readings to push
+    } data;
+};
+
+// state of the satellite, answer to BATCH_CMD
+struct batch_data
+{
+    unsigned char batch;       // parts executed (enum batch)
+    unsigned char heater_on;   // boolean to state if the heater is on
+    unsigned char sunlight_on; // boolean to state if sunlight is on
+    float temperature;         // value of the temperature (up to +-327 C)
+    struct position position;  // value of the position
+};
+
+// structure of response message
+struct res_msg
+{
+    unsigned char addr;   // slave that answers, first on the wire
+    unsigned char seq;    // sequence number of the request
+    unsigned char cmd;    // command to respond to
+    unsigned char status; // status of the execution (enum status)
+    union
+    {
+        unsigned char sunlight_on; // boolean to state if sunlight is on
+        float temperature;         // value of the temperature
+        struct position position;  // value of the position
+        struct batch_data batch;   // parts of the state requested or pushed
+        struct hello hello;        // capabilities agreed by the slave
+    } data;
+};
+
+// receiver of frames byte by byte
+struct frame_parser
+{
+    unsigned char frame[FRAME_MAX_SIZE];   // frame being received
+    unsigned char message[FRAME_MAX_SIZE]; // message (and CRC) of the last frame
+    int count;                             // bytes of the frame received
+    int length;                            // bytes of the last frame
+    int size;                              // size of the last message
+};
+
+/**********************************************************
+ *  COMPILE TIME CHECKS
+ *********************************************************/
+
+#if defined(__cplusplus)
+#define PROTOCOL_ASSERT(cond, msg) static_assert(cond, msg)
+#else
+#define PROTOCOL_ASSERT(cond, msg) _Static_assert(cond, msg)
+#endif
+
+PROTOCOL_ASSERT(sizeof(float) == 4, "f32 fields need 32 bit floats");
+PROTOCOL_ASSERT(PROTOCOL_MAX_WIRE_SIZE <= 252, "frames must fit a single COBS block");
+PROTOCOL_ASSERT(POSITION_WIRE_SIZE <= sizeof(struct position), "position is padded on the wire");
+PROTOCOL_ASSERT(HELLO_WIRE_SIZE <= sizeof(struct hello), "hello is padded on the wire");
+PROTOCOL_ASSERT(SUBSCRIPTION_WIRE_SIZE <= sizeof(struct subscription), "subscription is padded on the wire");
+PROTOCOL_ASSERT(CMD_MSG_WIRE_SIZE <= sizeof(struct cmd_msg), "cmd_msg is padded on the wire");
+PROTOCOL_ASSERT(BATCH_DATA_WIRE_SIZE <= sizeof(struct batch_data), "batch_data is padded on the wire");
+PROTOCOL_ASSERT(RES_MSG_WIRE_SIZE <= sizeof(struct res_msg), "res_msg is padded on the wire");
+
+//---------------------------------------------------------------------------
+//                           CODECS
+//---------------------------------------------------------------------------
+
+/**********************************************************
+ *  Function: protocol_put_u8 ... protocol_get_f32
+ *********************************************************/
+// little endian whatever the host, floats as their IEEE 754 bits
+static inline void protocol_put_u32(unsigned char *buffer, uint32_t value)
+{
+    buffer[0] = (unsigned char)value;
+    buffer[1] = (unsigned char)(value >> 8);
+    buffer[2] = (unsigned char)(value >> 16);
+    buffer[3] = (unsigned char)(value >> 24);
+}
+
+static inline uint32_t protocol_get_u32(const unsigned char *buffer)
+{
+    return (((uint32_t)buffer[0]) | (((uint32_t)buffer[1]) << 8) |
+            (((uint32_t)buffer[2]) << 16) | (((uint32_t)buffer[3]) << 24));
+}
+
+static inline void protocol_put_u16(unsigned char *buffer, uint16_t value)
+{
+    buffer[0] = (unsigned char)value;
+    buffer[1] = (unsigned char)(value >> 8);
+}
+
+static inline uint16_t protocol_get_u16(const unsigned char *buffer)
+{
+    return ((uint16_t)(((uint16_t)buffer[0]) | (((uint16_t)buffer[1]) << 8)));
+}
+
+static inline void protocol_put_u8(unsigned char *buffer, unsigned char value)
+{
+    buffer[0] = value;
+}
+
+static inline unsigned char protocol_get_u8(const unsigned char *buffer)
+{
+    return (buffer[0]);
+}
+
+static inline void protocol_put_i16(unsigned char *buffer, short int value)
+{
+    protocol_put_u16(buffer, (uint16_t)value);
+}
+
+static inline short int protocol_get_i16(const unsigned char *buffer)
+{
+    return ((short int)protocol_get_u16(buffer));
+}
+
+static inline void protocol_put_i32(unsigned char *buffer, int32_t value)
+{
+    protocol_put_u32(buffer, (uint32_t)value);
+}
+
+static inline int32_t protocol_get_i32(const unsigned char *buffer)
+{
+    return ((int32_t)protocol_get_u32(buffer));
+}
+
+static inline void protocol_put_f32(unsigned char *buffer, float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, 4);
+    protocol_put_u32(buffer, bits);
+}
+
+static inline float protocol_get_f32(const unsigned char *buffer)
+{
+    uint32_t bits = protocol_get_u32(buffer);
+    float value;
+
+    memcpy(&value, &bits, 4);
+    return (value);
+}
+
+/**********************************************************
+ *  Function: protocol_put_bit ... protocol_get_q24
+ *********************************************************/
+// bit fields share a byte, the first one clears it
+static inline void protocol_put_bit(unsigned char *buffer, int bit, unsigned char value)
+{
+    if (bit == 0)
+    {
+        buffer[0] = 0;
+    }
+    buffer[0] |= (unsigned char)((value ? 1 : 0) << bit);
+}
+
+static inline unsigned char protocol_get_bit(const unsigned char *buffer, int bit)
+{
+    return ((unsigned char)((buffer[0] >> bit) & 1));
+}
+
+// fixed point: value rounded to a whole number of steps, saturated at the
+// limits of the field (NaN goes as 0)
+static inline long protocol_quantize(float value, float step, long limit)
+{
+    float steps = value / step;
+
+    if (steps != steps)
+    {
+        return (0);
+    }
+    if (steps >= (float)limit)
+    {
+        return (limit);
+    }
+    if (steps <= (float)-limit)
+    {
+        return (-limit);
+    }
+    return ((long)(steps + ((steps < 0.0f) ? -0.5f : 0.5f)));
+}
+
+static inline void protocol_put_q16(unsigned char *buffer, float value, float step)
+{
+    protocol_put_u16(buffer, (uint16_t)protocol_quantize(value, step, 32767L));
+}
+
+static inline float protocol_get_q16(const unsigned char *buffer, float step)
+{
+    return ((float)(int16_t)protocol_get_u16(buffer) * step);
+}
+
+static inline void protocol_put_q24(unsigned char *buffer, float value, float step)
+{
+    uint32_t steps = (uint32_t)protocol_quantize(value, step, 8388607L);
+
+    buffer[0] = (unsigned char)steps;
+    buffer[1] = (unsigned char)(steps >> 8);
+    buffer[2] = (unsigned char)(steps >> 16);
+}
+
+static inline float protocol_get_q24(const unsigned char *buffer, float step)
+{
+    uint32_t steps = ((uint32_t)buffer[0]) | (((uint32_t)buffer[1]) << 8) |
+                     (((uint32_t)buffer[2]) << 16);
+
+    // sign of the 24 bits
+    return ((float)((int32_t)(steps ^ 0x800000UL) - 0x800000L) * step);
+}
+
+/**********************************************************
+ *  Function: encode_position
+ *********************************************************/
+// returns the bytes written on buffer
+static inline int encode_position(const struct position *msg, unsigned char *buffer)
+{
+    protocol_put_q24(buffer + 0, msg->x, 0.1);
+    protocol_put_q24(buffer + 3, msg->y, 0.1);
+    protocol_put_q24(buffer + 6, msg->z, 0.1);
+    return (POSITION_WIRE_SIZE);
+}
+
+/**********************************************************
+ *  Function: decode_position
+ *********************************************************/
+// returns the bytes read from buffer, or -1 if size does not match the message
+static inline int decode_position(const unsigned char *buffer, int size, struct position *msg)
+{
+    if (size != POSITION_WIRE_SIZE)
+    {
+        return (-1);
+    }
+    msg->x = protocol_get_q24(buffer + 0, 0.1);
+    msg->y = protocol_get_q24(buffer + 3, 0.1);
+    msg->z = protocol_get_q24(buffer + 6, 0.1);
+    return (POSITION_WIRE_SIZE);
+}
+
+/**********************************************************
+ *  Function: encode_hello
+ *********************************************************/
+// returns the bytes written on buffer
+static inline int encode_hello(const struct hello *msg, unsigned char *buffer)
+{
+    protocol_put_u8(buffer + 0, msg->version);
+    protocol_put_u8(buffer + 1, msg->features);
+    protocol_put_u32(buffer + 2, msg->baud);
+    return (HELLO_WIRE_SIZE);
+}
+
+/**********************************************************
+ *  Function: decode_hello
+ *********************************************************/
+// returns the bytes read from buffer, or -1 if size does not match the message
+static inline int decode_hello(const unsigned char *buffer, int size, struct hello *msg)
+{
+    if (size != HELLO_WIRE_SIZE)
+    {
+        return (-1);
+    }
+    msg->version = protocol_get_u8(buffer + 0);
+    msg->features = protocol_get_u8(buffer + 1);
+    msg->baud = protocol_get_u32(buffer + 2);
+    return (HELLO_WIRE_SIZE);
+}
+
+/**********************************************************
+ *  Function: encode_subscription
+ *********************************************************/
+// returns the bytes written on buffer
+static inline int encode_subscription(const struct subscription *msg, unsigned char *buffer)
+{
+    protocol_put_u8(buffer + 0, msg->parts);
+    protocol_put_u16(buffer + 1, msg->period);
+    protocol_put_f32(buffer + 3, msg->delta);
+    return (SUBSCRIPTION_WIRE_SIZE);
+}
+
+/**********************************************************
+ *  Function: decode_subscription
+ *********************************************************/
+// returns the bytes read from buffer, or -1 if size does not match the message
+static inline int decode_subscription(const unsigned char *buffer, int size, struct subscription *msg)
+{
+    if (size != SUBSCRIPTION_WIRE_SIZE)
+    {
+        return (-1);
+    }
+    msg->parts = protocol_get_u8(buffer + 0);
+    msg->period = protocol_get_u16(buffer + 1);
+    msg->delta = protocol_get_f32(buffer + 3);
+    return (SUBSCRIPTION_WIRE_SIZE);
+}
+
+/**********************************************************
+ *  Function: wire_size_cmd_msg
+ *********************************************************/
+static inline int wire_size_cmd_msg(int cmd)
+{
+    switch (cmd)
+    {
+    case HELLO_CMD:
+        return (11);
+    case SUBSCRIBE_CMD:
+        return (12);
+    default:
+        return (5);
+    }
+}
+
+/**********************************************************
+ *  Function: encode_cmd_msg
+ *********************************************************/
+// returns the bytes written on buffer
+static inline int encode_cmd_msg(const struct cmd_msg *msg, unsigned char *buffer)
+{
+    protocol_put_u8(buffer + 0, msg->addr);
+    protocol_put_u8(buffer + 1, msg->seq);
+    protocol_put_u8(buffer + 2, msg->cmd);
+    protocol_put_u8(buffer + 3, msg->set_heater);
+    protocol_put_u8(buffer + 4, msg->batch);
+
+    // only the member selected by cmd goes on the wire
+    switch (msg->cmd)
+    {
+    case HELLO_CMD:
+        encode_hello(&msg->data.hello, buffer + 5);
+        break;
+    case SUBSCRIBE_CMD:
+        encode_subscription(&msg->data.subscription, buffer + 5);
+        break;
+    default:
+        break;
+    }
+    return (wire_size_cmd_msg(msg->cmd));
+}
+
+/**********************************************************
+ *  Function: decode_cmd_msg
+ *********************************************************/
+// returns the bytes read from buffer, or -1 if size does not match the message
+static inline int decode_cmd_msg(const unsigned char *buffer, int size, struct cmd_msg *msg)
+{
+    if (size < 5 || size != wire_size_cmd_msg(protocol_get_u8(buffer + 2)))
+    {
+        return (-1);
+    }
+    memset(msg, 0, sizeof(struct cmd_msg));
+    msg->addr = protocol_get_u8(buffer + 0);
+    msg->seq = protocol_get_u8(buffer + 1);
+    msg->cmd = protocol_get_u8(buffer + 2);
+    msg->set_heater = protocol_get_u8(buffer + 3);
+    msg->batch = protocol_get_u8(buffer + 4);
+
+    // only the member selected by cmd goes on the wire
+    switch (msg->cmd)
+    {
+    case HELLO_CMD:
+        decode_hello(buffer + 5, HELLO_WIRE_SIZE, &msg->data.hello);
+        break;
+    case SUBSCRIBE_CMD:
+        decode_subscription(buffer + 5, SUBSCRIPTION_WIRE_SIZE, &msg->data.subscription);
+        break;
+    default:
+        break;
+    }
+    return (wire_size_cmd_msg(msg->cmd));
+}
+
+/**********************************************************
+ *  Function: encode_batch_data
+ *********************************************************/
+// returns the bytes written on buffer
+static inline int encode_batch_data(const struct batch_data *msg, unsigned char *buffer)
+{
+    protocol_put_u8(buffer + 0, msg->batch);
+    protocol_put_bit(buffer + 1, 0, msg->heater_on);
+    protocol_put_bit(buffer + 1, 1, msg->sunlight_on);
+    protocol_put_q16(buffer + 2, msg->temperature, 0.01);
+    encode_position(&msg->position, buffer + 4);
+    return (BATCH_DATA_WIRE_SIZE);
+}
+
+/**********************************************************
+ *  Function: decode_batch_data
+ *********************************************************/
+// returns the bytes read from buffer, or -1 if size does not match the message
+static inline int decode_batch_data(const unsigned char *buffer, int size, struct batch_data *msg)
+{
+    if (size != BATCH_DATA_WIRE_SIZE)
+    {
+        return (-1);
+    }
+    msg->batch = protocol_get_u8(buffer + 0);
+    msg->heater_on = protocol_get_bit(buffer + 1, 0);
+    msg->sunlight_on = protocol_get_bit(buffer + 1, 1);
+    msg->temperature = protocol_get_q16(buffer + 2, 0.01);
+    decode_position(buffer + 4, POSITION_WIRE_SIZE, &msg->position);
+    return (BATCH_DATA_WIRE_SIZE);
+}
+
+/**********************************************************
+ *  Function: wire_size_res_msg
+ *********************************************************/
+static inline int wire_size_res_msg(int cmd)
+{
+    switch (cmd)
+    {
+    case READ_SUN_CMD:
+        return (5);
+    case READ_TEMP_CMD:
+        return (6);
+    case READ_POS_CMD:
+        return (13);
+    case BATCH_CMD:
+        return (17);
+    case TELEMETRY_CMD:
+        return (17);
+    case HELLO_CMD:
+        return (10);
+    default:
+        return (4);
+    }
+}
+
+/**********************************************************
+ *  Function: encode_res_msg
+ *********************************************************/
+// returns the bytes written on buffer
+static inline int encode_res_msg(const struct res_msg *msg, unsigned char *buffer)
+{
+    protocol_put_u8(buffer + 0, msg->addr);
+    protocol_put_u8(buffer + 1, msg->seq);
+    protocol_put_u8(buffer + 2, msg->cmd);
+    protocol_put_u8(buffer + 3, msg->status);
+
+    // only the member selected by cmd goes on the wire
+    switch (msg->cmd)
+    {
+    case READ_SUN_CMD:
+        protocol_put_u8(buffer + 4, msg->data.sunlight_on);
+        break;
+    case READ_TEMP_CMD:
+        protocol_put_q16(buffer + 4, msg->data.temperature, 0.01);
+        break;
+    case READ_POS_CMD:
+        encode_position(&msg->data.position, buffer + 4);
+        break;
+    case BATCH_CMD:
+        encode_batch_data(&msg->data.batch, buffer + 4);
+        break;
+    case TELEMETRY_CMD:
+        encode_batch_data(&msg->data.batch, buffer + 4);
+        break;
+    case HELLO_CMD:
+        encode_hello(&msg->data.hello, buffer + 4);
+        break;
+    default:
+        break;
+    }
+    return (wire_size_res_msg(msg->cmd));
+}
+
+/**********************************************************
+ *  Function: decode_res_msg
+ *********************************************************/
+// returns the bytes read from buffer, or -1 if size does not match the message
+static inline int decode_res_msg(const unsigned char *buffer, int size, struct res_msg *msg)
+{
+    if (size < 4 || size != wire_size_res_msg(protocol_get_u8(buffer + 2)))
+    {
+        return (-1);
+    }
+    memset(msg, 0, sizeof(struct res_msg));
+    msg->addr = protocol_get_u8(buffer + 0);
+    msg->seq = protocol_get_u8(buffer + 1);
+    msg->cmd = protocol_get_u8(buffer + 2);
+    msg->status = protocol_get_u8(buffer + 3);
+
+    // only the member selected by cmd goes on the wire
+    switch (msg->cmd)
+    {
+    case READ_SUN_CMD:
+        msg->data.sunlight_on = protocol_get_u8(buffer + 4);
+        break;
+    case READ_TEMP_CMD:
+        msg->data.temperature = protocol_get_q16(buffer + 4, 0.01);
+        break;
+    case READ_POS_CMD:
+        decode_position(buffer + 4, POSITION_WIRE_SIZE, &msg->data.position);
+        break;
+    case BATCH_CMD:
+        decode_batch_data(buffer + 4, BATCH_DATA_WIRE_SIZE, &msg->data.batch);
+        break;
+    case TELEMETRY_CMD:
+        decode_batch_data(buffer + 4, BATCH_DATA_WIRE_SIZE, &msg->data.batch);
+        break;
+    case HELLO_CMD:
+        decode_hello(buffer + 4, HELLO_WIRE_SIZE, &msg->data.hello);
+        break;
+    default:
+        break;
+    }
+    return (wire_size_res_msg(msg->cmd));
+}
+
+//---------------------------------------------------------------------------
+//                           FRAMES
+//---------------------------------------------------------------------------
+// every message goes on the wire in a frame: message and CRC-16 (little
+// endian) stuffed with COBS so no byte is 0, then the delimiter 0. A receiver
+// that lost bytes is in sync again as soon as it sees the next delimiter
+
+// CRC of every value of the 4 high bits
+static const uint16_t protocol_crc_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+
+/**********************************************************
+ *  Function: protocol_crc16
+ *********************************************************/
+static inline uint16_t protocol_crc16(const unsigned char *data, int size)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (int i = 0; i < size; i++)
+    {
+        crc = (uint16_t)((crc << 4) ^ protocol_crc_table[((crc >> 12) ^ (data[i] >> 4)) & 0x0F]);
+        crc = (uint16_t)((crc << 4) ^ protocol_crc_table[((crc >> 12) ^ data[i]) & 0x0F]);
+    }
+    return (crc);
+}
+
+/**********************************************************
+ *  Function: frame_close
+ *********************************************************/
+// frame holds the message from frame[1], returns the bytes of the frame
+static inline int frame_close(unsigned char *frame, int size)
+{
+    int end = size + FRAME_CRC_SIZE + 1; // position of the delimiter
+    int code = 0;                        // position of the last code byte
+
+    protocol_put_u16(frame + size + 1, protocol_crc16(frame + 1, size));
+
+    // every 0 becomes the distance to the next 0 (or to the delimiter)
+    for (int i = 1; i < end; i++)
+    {
+        if (frame[i] == 0)
+        {
+            frame[code] = (unsigned char)(i - code);
+            code = i;
+        }
+    }
+    frame[code] = (unsigned char)(end - code);
+    frame[end] = 0;
+    return (size + FRAME_OVERHEAD);
+}
+
+/**********************************************************
+ *  Function: frame_open
+ *********************************************************/
+// frame holds size bytes up to the delimiter included, leaves the message
+// (and its CRC) in message, returns its size or -1 on a wrong frame
+static inline int frame_open(const unsigned char *frame, int size, unsigned char *message)
+{
+    int code = 0; // position of the next code byte
+
+    if (size < FRAME_OVERHEAD + 1 || size > FRAME_MAX_SIZE || frame[size - 1] != 0)
+    {
+        return (-1);
+    }
+    size = size - 1;
+
+    for (int i = 0; i < size; i++)
+    {
+        if (i == code)
+        {
+            if (frame[i] == 0 || i + frame[i] > size)
+            {
+                return (-1);
+            }
+            code = i + frame[i];
+            if (i > 0)
+            {
+                message[i - 1] = 0;
+            }
+            continue;
+        }
+        if (frame[i] == 0)
+        {
+            return (-1);
+        }
+        message[i - 1] = frame[i];
+    }
+    if (code != size)
+    {
+        return (-1);
+    }
+
+    size = size - 1 - FRAME_CRC_SIZE;
+    return ((protocol_crc16(message, size) == protocol_get_u16(message + size)) ? size : -1);
+}
+
+/**********************************************************
+ *  Function: frame_parse_byte
+ *********************************************************/
+// feeds one received byte, returns FRAME_COMPLETE with the message of a
+// whole frame in parser->message, FRAME_WRONG or FRAME_INCOMPLETE
+static inline int frame_parse_byte(struct frame_parser *parser, unsigned char car)
+{
+    // bytes past FRAME_MAX_SIZE are dropped, so a frame too long never
+    // ends with its delimiter and is taken as wrong
+    if (parser->count < FRAME_MAX_SIZE)
+    {
+        parser->frame[parser->count++] = car;
+    }
+    if (car != 0)
+    {
+        return (FRAME_INCOMPLETE);
+    }
+
+    // a delimiter always ends the frame, right or wrong
+    parser->length = parser->count;
+    parser->count = 0;
+    if (parser->length == 1)
+    {
+        return (FRAME_INCOMPLETE);
+    }
+    parser->size = frame_open(parser->frame, parser->length, parser->message);
+    return ((parser->size < 0) ? FRAME_WRONG : FRAME_COMPLETE);
+}
+
+#endif
@@ -5,49 +5,13 @@
 #include <stdio.h>
 #include <time.h>
 
-// --------------------------------------
-// CONSTANTS
-// --------------------------------------
+// messages and codecs generated from Part A/code/protocol.schema
+#include "protocol.h"
 
 // --------------------------------------
-// Types
+// CONSTANTS
 // --------------------------------------
 
-// structture of a position on the orbit
-struct position
-{
-    float x;
-    float y;
-    float z;
-};
-
-// list of commands to be send
-enum command
-{
-    NO_CMD = 0,
-    SET_HEAT_CMD = 1,
-    READ_SUN_CMD = 2,
-    READ_TEMP_CMD = 3,
-    READ_POS_CMD = 4
-};
-
-// structure of command message
-struct cmd_msg
-{
-    short int cmd;        // command to execute
-    short int set_heater; // boolean to set or unset the heater
-};
-
-// structure of response message
-struct res_msg
-{
-    short int cmd;            // command to respond to
-    short int status;         // boolean to state if execution went well
-    long int sunlight_on;     // boolean to state if sunlight is on
-    float temperature;        // value of the temperature
-    struct position position; // value of the position
-};
-
 // --------------------------------------
 // PUBLIC STATUS (GLOBAL VARIABLES)
 // --------------------------------------
@@ -56,9 +20,9 @@ struct res_msg
 int heater_on = 0;
 
 // last command message received
-struct cmd_msg last_cmd_msg = {NO_CMD, 0};
+struct cmd_msg last_cmd_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
 // next response message to be send
-struct res_msg next_res_msg = {NO_CMD, 0};
+struct res_msg next_res_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
 
 //---------------------------------------------------------------------------
 //                           AUXILIAR FUNCTIONS
@@ -71,28 +35,17 @@ void send_msg()
 {
 
     Serial.print("MSG: (");
-    // compute parity
-    unsigned char res_parity = (unsigned char)0;
+    // put the message in a frame, ended by the delimiter
+    unsigned char frame[FRAME_MAX_SIZE];
+    int size = frame_close(frame, encode_cmd_msg(&last_cmd_msg, frame + 1));
     int ret = 0;
 
-    for (int i = 0; i < sizeof(struct cmd_msg); i++)
-    {
-        // compute parity (xor)
-        res_parity = res_parity ^ ((unsigned char *)(&last_cmd_msg))[i];
-    }
-
-    // send message to slave
-    ret = Serial.write((char *)&last_cmd_msg, sizeof(struct cmd_msg));
-    if (ret < sizeof(struct cmd_msg))
+    // send frame to slave
+    ret = Serial.write(frame, size);
+    if (ret < size)
     {
         Serial.println("ERROR: write Request");
     }
-    // send parity to slave
-    ret = Serial.write((char *)&res_parity, 1);
-    if (ret < 1)
-    {
-        Serial.println("ERROR: write parity");
-    }
     Serial.println(")");
 }
 
@@ -101,36 +54,19 @@ void send_msg()
 // --------------------------------------
 void recv_msg()
 {
-
-    // compute parity
-    unsigned char res_parity = (unsigned char)0;
-    unsigned char parity = (unsigned char)0;
+    unsigned char frame[FRAME_MAX_SIZE];
+    unsigned char message[FRAME_MAX_SIZE];
     int ret = 0;
 
-    // send message to slave
-    ret = Serial.readBytes((char *)&next_res_msg, sizeof(struct res_msg));
-    if (ret < sizeof(struct res_msg))
-    {
-        Serial.println("ERROR: read Response");
-    }
-
-    for (int i = 0; i < sizeof(struct res_msg); i++)
-    {
-        // compute parity (xor)
-        res_parity = res_parity ^ ((unsigned char *)(&next_res_msg))[i];
-    }
-
-    // send parity to slave
-    ret = Serial.readBytes((char *)&parity, 1);
-    if (ret < 1)
-    {
-        Serial.println("ERROR: read parity");
-    }
-    else if (parity != res_parity)
+    // read up to the delimiter, which readBytesUntil leaves out
+    ret = Serial.readBytesUntil(0, (char *)frame, FRAME_MAX_SIZE - 1);
+    frame[ret] = 0;
+    ret = frame_open(frame, ret + 1, message);
+    if (ret < 0 || decode_res_msg(message, ret, &next_res_msg) < 0)
     {
-        Serial.println("ERROR: read wrong parity");
+        Serial.println("ERROR: read wrong frame");
         next_res_msg.cmd = NO_CMD;
-        next_res_msg.status = 2;
+        next_res_msg.status = STATUS_NACK;
     }
 }
 
@@ -172,6 +108,15 @@ void send_cmd_msg(int cmd)
     else if (cmd == READ_POS_CMD)
     {
         last_cmd_msg.cmd = READ_POS_CMD;
+
+        // set batch command msg: heater and every read at once
+    }
+    else if (cmd == BATCH_CMD)
+    {
+        heater_on = 1 - heater_on;
+        last_cmd_msg.cmd = BATCH_CMD;
+        last_cmd_msg.set_heater = heater_on;
+        last_cmd_msg.batch = BATCH_SET_HEAT | BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS;
     }
 }
 
@@ -210,7 +155,7 @@ void recv_res_msg()
         Serial.println("Ans: READ_SUN_CMD");
         sprintf(buffer, "Stat: %d", next_res_msg.status);
         Serial.println(buffer);
-        sprintf(buffer, "Sun: %d", next_res_msg.sunlight_on);
+        sprintf(buffer, "Sun: %d", next_res_msg.data.sunlight_on);
         Serial.println(buffer);
 
         // unpack read temperature response msg
@@ -220,7 +165,7 @@ void recv_res_msg()
         Serial.println("Ans: READ_TEMP_CMD");
         sprintf(buffer, "Stat: %d", next_res_msg.status);
         Serial.println(buffer);
-        dtostrf(next_res_msg.temperature, 9, 2, num_str1);
+        dtostrf(next_res_msg.data.temperature, 9, 2, num_str1);
         sprintf(buffer, "Temp: %s", num_str1);
         Serial.println(buffer);
 
@@ -231,9 +176,29 @@ void recv_res_msg()
         Serial.println("Ans: READ_POS_CMD");
         sprintf(buffer, "Stat: %d", next_res_msg.status);
         Serial.println(buffer);
-        dtostrf(next_res_msg.position.x, 9, 2, num_str1);
-        dtostrf(next_res_msg.position.y, 9, 2, num_str2);
-        dtostrf(next_res_msg.position.z, 9, 2, num_str3);
+        dtostrf(next_res_msg.data.position.x, 9, 2, num_str1);
+        dtostrf(next_res_msg.data.position.y, 9, 2, num_str2);
+        dtostrf(next_res_msg.data.position.z, 9, 2, num_str3);
+        sprintf(buffer, "Pos: %s, %s, %s", num_str1, num_str2, num_str3);
+        Serial.println(buffer);
+
+        // unpack batch response msg
+    }
+    else if (next_res_msg.cmd == BATCH_CMD)
+    {
+        Serial.println("Ans: BATCH_CMD");
+        sprintf(buffer, "Stat: %d", next_res_msg.status);
+        Serial.println(buffer);
+        sprintf(buffer, "Heat: %d", next_res_msg.data.batch.heater_on);
+        Serial.println(buffer);
+        sprintf(buffer, "Sun: %d", next_res_msg.data.batch.sunlight_on);
+        Serial.println(buffer);
+        dtostrf(next_res_msg.data.batch.temperature, 9, 2, num_str1);
+        sprintf(buffer, "Temp: %s", num_str1);
+        Serial.println(buffer);
+        dtostrf(next_res_msg.data.batch.position.x, 9, 2, num_str1);
+        dtostrf(next_res_msg.data.batch.position.y, 9, 2, num_str2);
+        dtostrf(next_res_msg.data.batch.position.z, 9, 2, num_str3);
         sprintf(buffer, "Pos: %s, %s, %s", num_str1, num_str2, num_str3);
         Serial.println(buffer);
     }
@@ -276,6 +241,9 @@ void loop()
     case 4:
         Serial.println("Send: Read position");
         break;
+    case 5:
+        Serial.println("Send: Batch of all");
+        break;
     }
 
     // wait 1000 ms
@@ -295,5 +263,5 @@ void loop()
     // wait 1000 ms
     delay(2000);
 
-    option = (option + 1) % 5;
+    option = (option + 1) % 6;
 }
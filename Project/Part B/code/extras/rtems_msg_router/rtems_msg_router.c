@@ -22,50 +22,14 @@
 #include <rtems/termiostypes.h>
 #include <bsp.h>
 
+// messages and codecs generated from Part A/code/protocol.schema
+#include "protocol.h"
+
 // --------------------------------------
 // Constants
 // --------------------------------------
 #define SLAVE_ADDR 0x8
 
-// --------------------------------------
-// Types
-// --------------------------------------
-
-// list of commands to be send
-enum command
-{
-    NO_CMD = 0,
-    SET_HEAT_CMD = 1,
-    READ_SUN_CMD = 2,
-    READ_TEMP_CMD = 3,
-    READ_POS_CMD = 4
-};
-
-// structture of a position on the orbit
-struct position
-{
-    float x;
-    float y;
-    float z;
-};
-
-// structure of command message
-struct cmd_msg
-{
-    short int cmd;        // command to execute
-    short int set_heater; // boolean to set or unset the heater
-};
-
-// structure of response message
-struct res_msg
-{
-    short int cmd;            // command to respond to
-    short int status;         // boolean to state if execution went well
-    short int sunlight_on;    // boolean to state if sunlight is on
-    float temperature;        // value of the temperature
-    struct position position; // value of the position
-};
-
 // --------------------------------------
 // Global Variables
 // --------------------------------------
@@ -75,9 +39,9 @@ int file_desc;
 // heater state
 int heater_on = 0;
 // next command message to be send
-struct cmd_msg next_cmd_msg = {NO_CMD, 0};
+struct cmd_msg next_cmd_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
 // last response message received
-struct res_msg last_res_msg = {NO_CMD, 0};
+struct res_msg last_res_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
 
 // ---------------------------------------------------------
 // AUXILIAR FUNCTIONS
@@ -85,80 +49,48 @@ struct res_msg last_res_msg = {NO_CMD, 0};
 
 void send_msg()
 {
-
-    // compute parity
-    unsigned char res_parity = (unsigned char)0;
+    // put the message in a frame, ended by the delimiter
+    unsigned char frame[FRAME_MAX_SIZE];
+    int size = frame_close(frame, encode_cmd_msg(&next_cmd_msg, frame + 1));
     int ret = 0;
 
-    for (int i = 0; i < sizeof(struct cmd_msg); i++)
-    {
-        // compute parity (xor)
-        res_parity = res_parity ^ ((unsigned char *)(&next_cmd_msg))[i];
-    }
-
-    // send message to slave
-    ret = write(file_desc, (char *)&next_cmd_msg, sizeof(struct cmd_msg));
-    if (ret < sizeof(struct cmd_msg))
+    // send frame to slave
+    ret = write(file_desc, (char *)frame, size);
+    if (ret < size)
     {
         printf("ERROR: write Request: ret=%d \n", ret);
         sleep(5);
         exit(-1);
     }
-    // send parity to slave
-    ret = write(file_desc, (char *)&res_parity, 1);
-    if (ret < 1)
-    {
-        printf("ERROR: write parity: ret=%d \n", ret);
-        sleep(5);
-        exit(-1);
-    }
 }
 
 void recv_msg()
 {
+    struct frame_parser parser;
+    unsigned char car_aux;
+    int ret = FRAME_INCOMPLETE;
 
-    // compute parity
-    unsigned char res_parity = (unsigned char)0;
-    unsigned char parity = (unsigned char)0;
-    int ret = 0;
-
-    // send message to slave
-    int leido = 0;
-    while (leido < sizeof(struct res_msg))
+    // read up to the delimiter of a frame
+    memset(&parser, 0, sizeof(struct frame_parser));
+    while (ret == FRAME_INCOMPLETE)
     {
-        ret = read(file_desc, ((char *)(&last_res_msg)) + leido, sizeof(struct res_msg) - leido);
+        ret = read(file_desc, (char *)&car_aux, 1);
         if (ret <= 0)
         {
             printf("ERROR: read Request: ret=%d \n", ret);
             sleep(5);
             exit(-1);
         }
-        leido = leido + ret;
+        ret = frame_parse_byte(&parser, car_aux);
     }
 
-    for (int i = 0; i < sizeof(struct res_msg); i++)
-    {
-        // compute parity (xor)
-        res_parity = res_parity ^ ((unsigned char *)(&last_res_msg))[i];
-    }
-
-    // send parity to slave
-    ret = 0;
-    while (ret <= 0)
-    {
-        ret = read(file_desc, (char *)&parity, 1);
-        if (ret < 1)
-        {
-            printf("ERROR: read parity: ret=%d \n", ret);
-            sleep(5);
-            exit(-1);
-        }
-    }
-    if (parity != res_parity)
+    // check the frame and decode the message
+    if (ret == FRAME_WRONG ||
+        decode_res_msg(parser.message, parser.size, &last_res_msg) < 0)
     {
-        printf("ERROR: received wrong parity\n");
+        printf("ERROR: received wrong frame\n");
         last_res_msg.cmd = NO_CMD;
-        last_res_msg.status = 2;
+        last_res_msg.status = STATUS_NACK;
     }
 }
 // ---------------------------------------------------------
@@ -200,6 +132,15 @@ void send_cmd_msg(int cmd)
     else if (cmd == READ_POS_CMD)
     {
         next_cmd_msg.cmd = READ_POS_CMD;
+
+        // set batch command msg: heater and every read at once
+    }
+    else if (cmd == BATCH_CMD)
+    {
+        heater_on = 1 - heater_on;
+        next_cmd_msg.cmd = BATCH_CMD;
+        next_cmd_msg.set_heater = heater_on;
+        next_cmd_msg.batch = BATCH_SET_HEAT | BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS;
     }
 }
 
@@ -225,7 +166,7 @@ void recv_res_msg()
     {
         printf("Answer: READ_SUN_CMD\n");
         printf("Status: %d\n", last_res_msg.status);
-        printf("Sun Sensor: %d\n", last_res_msg.sunlight_on);
+        printf("Sun Sensor: %d\n", last_res_msg.data.sunlight_on);
 
         // unpack read temperature response msg
     }
@@ -233,7 +174,7 @@ void recv_res_msg()
     {
         printf("Answer: READ_TEMP_CMD\n");
         printf("Status: %d\n", last_res_msg.status);
-        printf("Temperature: %f\n", last_res_msg.temperature);
+        printf("Temperature: %f\n", last_res_msg.data.temperature);
 
         // unpack read position response msg
     }
@@ -241,9 +182,23 @@ void recv_res_msg()
     {
         printf("Answer: READ_POS_CMD\n");
         printf("Status: %d\n", last_res_msg.status);
-        printf("Position: %f, %f, %f\n", last_res_msg.position.x,
-               last_res_msg.position.y,
-               last_res_msg.position.z);
+        printf("Position: %f, %f, %f\n", last_res_msg.data.position.x,
+               last_res_msg.data.position.y,
+               last_res_msg.data.position.z);
+
+        // unpack batch response msg
+    }
+    else if (last_res_msg.cmd == BATCH_CMD)
+    {
+        printf("Answer: BATCH_CMD\n");
+        printf("Status: %d\n", last_res_msg.status);
+        printf("Parts: 0x%02X\n", last_res_msg.data.batch.batch);
+        printf("Heater: %d\n", last_res_msg.data.batch.heater_on);
+        printf("Sun Sensor: %d\n", last_res_msg.data.batch.sunlight_on);
+        printf("Temperature: %f\n", last_res_msg.data.batch.temperature);
+        printf("Position: %f, %f, %f\n", last_res_msg.data.batch.position.x,
+               last_res_msg.data.batch.position.y,
+               last_res_msg.data.batch.position.z);
     }
 
     // set response to no command
@@ -268,7 +223,8 @@ void loop()
     printf("1: Set heater on/off\n");
     printf("2: Read sun sensor\n");
     printf("3: Read temperature\n");
-    printf("4: Read Position\n\n");
+    printf("4: Read Position\n");
+    printf("5: Batch of all\n\n");
     printf("Enter your option: \n");
     int option = getchar() - '0';
     getchar();
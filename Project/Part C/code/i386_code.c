@@ -1,12 +1,15 @@
 
 //-Uncomment to compile with arduino support
 #define ARDUINO
+//-Uncomment to capture the serial traffic (same format as Part A replay)
+//#define CAPTURE
 
 /**********************************************************
  *  INCLUDES
  *********************************************************/
 #include <termios.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,76 +17,126 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <stdint.h>
 #include <time.h>
 #include <sys/errno.h>
+#include <sys/mman.h>
+#include <sys/select.h>
 #include <sys/stat.h>
 
 #include <rtems.h>
 #include <rtems/termiostypes.h>
 #include <bsp.h>
 
+// messages and codecs generated from Part A/code/protocol.schema
+#include "protocol.h"
+// periods, priorities and releases generated from Part A/code/tasks.schedule
+#include "schedule.h"
+
+// modules shared with the host models of Part A/code, where they are
+// tested, and built into this file: clock, capture of the serial traffic,
+// timeout of the answers, latency histograms, binary log, versions of the
+// state, queue of the requests of the link, choice of the slave of every
+// window and period of the readings of the temperature
+#include "../../Part A/code/clock.c"
+#include "../../Part A/code/capture.c"
+#include "../../Part A/code/rto.c"
+#include "../../Part A/code/histogram.c"
+#include "../../Part A/code/binlog.c"
+#include "../../Part A/code/seqlock.c"
+#include "../../Part A/code/request_queue.c"
+#include "../../Part A/code/poll_scheduler.c"
+#include "../../Part A/code/adaptive_sampler.c"
+
 // --------------------------------------
 // Constants
 // --------------------------------------
-#define SLAVE_ADDR 0x8
-#define NS_PER_S 1000000000
+#define CAPTURE_PATH "/capture.scap"
 
 #define MAX_TEMPERATURE 90.
 #define MIN_TEMPERATURE -10.0
 #define AVG_TEMPERATURE 40.0
 
-// Define task periods and execution times
-#define TASK_A_PERIOD 5000
-#define TASK_B_PERIOD 2000
-#define TASK_C_PERIOD 2000
-#define TASK_D_PERIOD 2000
-#define TASK_E_PERIOD 4000
-#define TASK_F_PERIOD 4000
+// requests sent again at once after a NACK or a wrong answer
+#define MAX_RETRANSMITS 2
+// requests sent before reading their answers (1 to the queue of the slave, 8)
+#define SEND_WINDOW 4
+_Static_assert(SEND_WINDOW >= SCHEDULE_LINK_WINDOW, "the response times take more requests per exchange");
 
-#define TASK_A_EXECUTION_TIME 10
-#define TASK_B_EXECUTION_TIME 10
-#define TASK_C_EXECUTION_TIME 400
-#define TASK_D_EXECUTION_TIME 400
-#define TASK_E_EXECUTION_TIME 400
-#define TASK_F_EXECUTION_TIME 400
+// handshake of the link: rates tried, fastest first, the wait until the
+// slave takes the rate agreed and until it goes back to the first one
+#define MASTER_RATES_SIZE 4
+#define MASTER_FEATURES (FEATURE_BATCH | FEATURE_WINDOW | FEATURE_PUSH)
+#define HELLO_SWITCH_WAIT (300 * NS_PER_MS)
+#define HELLO_FALLBACK_WAIT (2500 * NS_PER_MS)
 
-// --------------------------------------
-// Types
-// --------------------------------------
+// readings pushed by the slave: period of the pushes (ms), change of
+// temperature pushed at once and silence before subscribing again
+#define PUSH_PERIOD 2000
+#define PUSH_DELTA 5.0
+#define PUSH_TIMEOUT (3 * PUSH_PERIOD * NS_PER_MS)
 
-// list of commands to be send
-enum command
-{
-    NO_CMD = 0,
-    SET_HEAT_CMD = 1,
-    READ_SUN_CMD = 2,
-    READ_TEMP_CMD = 3,
-    READ_POS_CMD = 4
-};
+// stack of every task thread and the part touched before the first release
+#define TASK_STACK_SIZE (32 * 1024)
+#define TASK_STACK_PREFAULT (16 * 1024)
+// first minor frame after the threads are created
+#define TASK_START_DELAY (100 * NS_PER_MS)
 
-// structture of a position on the orbit
-struct position
-{
-    float x;
-    float y;
-    float z;
-};
+// what the dispatcher does with a release that finds the last one of its
+// task still running: it is lost, it runs as soon as the last one ends
+// (up to OVERRUN_CATCH_UP_MAX of them), or it is lost and the lowest
+// priority tasks are shed (A, F and E at most, never the temperature and
+// the heater), one more after every overrun and one less after a
+// hyperperiod without any
+#define OVERRUN_SKIP 0
+#define OVERRUN_CATCH_UP 1
+#define OVERRUN_DEGRADE 2
+#define OVERRUN_POLICY OVERRUN_SKIP
+#define OVERRUN_CATCH_UP_MAX 4
+#define OVERRUN_SHED_MAX 3
+
+// period of the thread that prints the binary log of the tasks
+#define LOG_DRAIN_PERIOD (500 * NS_PER_MS)
+
+// wait of the owner of the link for a request while it applies the
+// readings pushed
+#define LINK_IDLE_WAIT (100 * NS_PER_MS)
+
+// slaves sharing the link, one address each in node_addrs: with more than
+// one the master is the only one to start a talk (no handshake, no pushes)
+// and it addresses a single slave per window, so the answers never collide;
+// every slave has its own state and heater, and the tasks poll them in turns
+#define NODES 1
+_Static_assert(NODES <= POLL_MAX_NODES, "more slaves than the poll scheduler takes");
 
-// structure of command message
-struct cmd_msg
+// temperature polled only when it could cross AVG_TEMPERATURE (not while
+// it is pushed, with a slave without FEATURE_PUSH): powers and heat
+// capacity of the slave (Part B), and longest time without a reading,
+// which bounds a change of the sunlight unseen
+#define SLAVE_HEATER_POWER 150.0  // J/sec
+#define SLAVE_SUNLIGHT_POWER 50.0 // J/sec
+#define SLAVE_POWER_LOSS 100.0    // J/sec
+#define SLAVE_HEAT_CAPACITY 9.0   // J/C
+#define TEMP_MAX_PERIOD (4 * TASK_C_PERIOD * NS_PER_MS)
+
+// --------------------------------------
+// Types
+// --------------------------------------
+// periodic task of the controller, run by its own thread
+struct periodic_task
 {
-    short int cmd;        // command to execute
-    short int set_heater; // boolean to set or unset the heater
+    const char *name;                 // name of the task
+    int period;                       // time between releases and deadline (ms)
+    enum command cmd;                 // command sent every release (NO_CMD for none)
+    void (*body)();                   // work of every release (NULL for none)
+    struct adaptive_sampler *sampler; // releases that run (NULL for all)
 };
 
-// structure of response message
-struct res_msg
+// lines of the log of the tasks
+enum log_format
 {
-    short int cmd;            // command to respond to
-    short int status;         // boolean to state if execution went well
-    long int sunlight_on;     // boolean to state if sunlight is on
-    float temperature;        // value of the temperature
-    struct position position; // value of the position
+    LOG_POSITION, // x, y, z
+    LOG_STATE     // temperature, sunlight, heater, address of the slave
 };
 
 // --------------------------------------
@@ -92,138 +145,192 @@ struct res_msg
 // file descriptor for I2C
 int file_desc;
 
-// boolean with the status of the heater
-int heater_on = 0;
-// boolean with the status of the sunlight
-int sunlight_on = 0;
-// Save the actual temperature of the ship
-double temperature = 0.0;
-// actual position of the ship
-struct position position = {0.0, 0.0, 0.0};
+// boolean with the heater of every slave decided by task B, and the one
+// last sent
+int heater_request[NODES];
+int heater_sent = 0;
+// state of every slave, updated by the holder of the link only, and the
+// versions of it published to the tasks
+struct spacecraft_state state[NODES];
+struct state_seqlock state_lock[NODES];
 
 // next command message to be send
-struct cmd_msg next_cmd_msg = {NO_CMD, 0};
+struct cmd_msg next_cmd_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
+// sequence number of the next request
+unsigned char next_seq = 0;
 // last response message received
-struct res_msg last_res_msg = {NO_CMD, 0};
+struct res_msg last_res_msg = {.addr = DEFAULT_ADDR, .cmd = NO_CMD};
 
-//---------------------------------------------------------------------------
-//                           AUXILIAR FUNCTIONS
-//---------------------------------------------------------------------------
+// bytes read from the serial port and not parsed yet
+unsigned char recv_buffer[FRAME_MAX_SIZE];
+int recv_head = 0;
+int recv_tail = 0;
+// receiver of the frame being read
+struct frame_parser recv_parser;
 
-// --------------------------------------
-// Function: getClock
-// --------------------------------------
-double getClock()
-{
-    struct timespec tp;
-    double reloj;
+// time to wait for an answer, from the round trip times measured
+struct rto_estimator link_rto;
 
-    clock_gettime(CLOCK_REALTIME, &tp);
-    reloj = ((double)tp.tv_sec) +
-            ((double)tp.tv_nsec) / ((double)NS_PER_S);
+// rates tried in the handshake, as termios speeds and in bits/sec
+const speed_t master_speeds[MASTER_RATES_SIZE] = {B115200, B57600, B38400, B19200};
+const uint32_t master_rates[MASTER_RATES_SIZE] = {115200, 57600, 38400, 19200};
+// capabilities in the last HELLO answer, and features agreed with the slave
+struct hello link_hello;
+int link_features = MASTER_FEATURES;
+// boolean to state if the slave pushes the readings (read by the tasks),
+// and time of the last push received (ns)
+int subscribed = 0;
+int64_t push_time = 0;
 
-    return (reloj);
-}
+// releases of task C that read the temperature, by its thread only
+struct adaptive_sampler temp_sampler;
 
-// --------------------------------------
-// Function: delayClock
-// --------------------------------------
-void delayClock(double time)
-{
-    struct timespec sleep_time;
+// addresses of the slaves on the link, and the choice of the one of every
+// window, by the holder of the link only
+const unsigned char node_addrs[NODES] = {DEFAULT_ADDR};
+struct poll_scheduler poller;
+// slave of the window being exchanged, by the holder of the link only
+int link_node = 0;
 
-    // set double into struct timespec
-    double floor_time = (double)((unsigned long)time);
-    sleep_time.tv_sec = (unsigned long)time;
-    sleep_time.tv_nsec = (unsigned long)((time - floor_time) * (double)(NS_PER_S));
+// link owned by a single thread: the tasks push their requests and wait
+// for them, the owner is woken up by every push (link_posted, on a
+// condition of the monotonic clock)
+struct request_queue link_queue;
+struct link_request task_request[TASKS];
+// posted by the owner once the request of the task is done
+sem_t task_done[TASKS];
+pthread_mutex_t link_mutex;
+pthread_cond_t link_cond;
+int link_posted = 0;
+// releases of every task, posted by the dispatcher, and boolean to state
+// if the task has not ended its last release
+sem_t task_release[TASKS];
+int task_active[TASKS];
+pthread_mutex_t task_mutex;
+// start of the first minor frame and last release of every task (ns)
+int64_t task_start = 0;
+int64_t task_release_time[TASKS];
+// releases of every task kept to catch up and the time of the first of
+// them (ns), tasks shed and time of the last overrun (ns), by task_mutex
+int task_late[TASKS];
+int64_t task_late_release[TASKS];
+int shed_tasks = 0;
+int64_t last_overrun = 0;
+// releases that found the last one still running, that ended after their
+// deadline and that were shed, by task_mutex
+unsigned long task_misses[TASKS];
+unsigned long task_overruns[TASKS];
+unsigned long task_shed[TASKS];
 
-    // sleep
-    nanosleep(&sleep_time, NULL);
-}
+// latencies of every task: from the release to the start and to the end,
+// of its exchange with the slave and CPU time of the release
+struct histogram task_jitter[TASKS];
+struct histogram task_response[TASKS];
+struct histogram task_round_trip[TASKS];
+struct histogram task_cpu[TASKS];
+// log of every task, printed by the drain thread
+struct binlog_ring task_log[TASKS];
+
+//---------------------------------------------------------------------------
+//                           AUXILIAR FUNCTIONS
+//---------------------------------------------------------------------------
 
 // --------------------------------------
 // Function: send_msg
 // --------------------------------------
-void send_msg()
+int send_msg()
 {
-
-    // compute parity
-    unsigned char res_parity = (unsigned char)0;
+    // put the message in a frame, ended by the delimiter
+    unsigned char frame[FRAME_MAX_SIZE];
+    int size = frame_close(frame, encode_cmd_msg(&next_cmd_msg, frame + 1));
     int ret = 0;
 
-    for (int i = 0; i < sizeof(struct cmd_msg); i++)
-    {
-        // compute parity (xor)
-        res_parity = res_parity ^ ((unsigned char *)(&next_cmd_msg))[i];
-    }
-
-    // send message to slave
-    ret = write(file_desc, (char *)&next_cmd_msg, sizeof(struct cmd_msg));
-    if (ret < sizeof(struct cmd_msg))
+    // send frame to slave
+    ret = write(file_desc, (char *)frame, size);
+    if (ret < size)
     {
         printf("ERROR: write Request: ret=%d \n", ret);
-        sleep(5);
-        exit(-1);
-    }
-    // send parity to slave
-    ret = write(file_desc, (char *)&res_parity, 1);
-    if (ret < 1)
-    {
-        printf("ERROR: write parity: ret=%d \n", ret);
-        sleep(5);
-        exit(-1);
+        return (-1);
     }
+#if defined(CAPTURE)
+    capture_frame(CAPTURE_TO_SLAVE, 0, frame, size);
+#endif
+    return (0);
 }
 
 // --------------------------------------
-// Function: recv_msg
+// Function: wait_readable
 // --------------------------------------
-void recv_msg()
+// returns 1 as soon as the serial port has bytes, 0 at the deadline
+int wait_readable(int64_t deadline)
 {
+    fd_set read_set;
+    struct timeval timeout;
+    int64_t left;
+    int ret;
 
-    // compute parity
-    unsigned char res_parity = (unsigned char)0;
-    unsigned char parity = (unsigned char)0;
-    int ret = 0;
-
-    // send message to slave
-    int leido = 0;
-    while (leido < sizeof(struct res_msg))
+    do
     {
-        ret = read(file_desc, ((char *)(&last_res_msg)) + leido, sizeof(struct res_msg) - leido);
-        if (ret <= 0)
+        left = deadline - clock_now_ns();
+        if (left < 0)
         {
-            printf("ERROR: read Request: ret=%d \n", ret);
-            sleep(5);
-            exit(-1);
+            left = 0;
         }
-        leido = leido + ret;
-    }
+        timeout.tv_sec = (time_t)(left / NS_PER_S);
+        timeout.tv_usec = (long)((left % NS_PER_S) / NS_PER_US);
+        FD_ZERO(&read_set);
+        FD_SET(file_desc, &read_set);
+        ret = select(file_desc + 1, &read_set, NULL, NULL, &timeout);
+    } while (ret < 0 && errno == EINTR);
 
-    for (int i = 0; i < sizeof(struct res_msg); i++)
-    {
-        // compute parity (xor)
-        res_parity = res_parity ^ ((unsigned char *)(&last_res_msg))[i];
-    }
+    return (ret > 0);
+}
+
+// --------------------------------------
+// Function: recv_msg
+// --------------------------------------
+int recv_msg(int64_t deadline)
+{
+    int ret = FRAME_INCOMPLETE;
 
-    // send parity to slave
-    ret = 0;
-    while (ret <= 0)
+    // read up to the delimiter of a frame: after lost bytes the next
+    // delimiter brings the link back in sync (the bytes of a frame cut by
+    // the deadline stay in the parser)
+    while (ret == FRAME_INCOMPLETE)
     {
-        ret = read(file_desc, (char *)&parity, 1);
-        if (ret < 1)
+        // wait for bytes only when all those read are parsed
+        if (recv_head == recv_tail)
         {
-            printf("ERROR: read parity: ret=%d \n", ret);
-            sleep(5);
-            exit(-1);
+            if (!wait_readable(deadline))
+            {
+                return (-1);
+            }
+            ret = read(file_desc, (char *)recv_buffer, sizeof(recv_buffer));
+            if (ret < 0)
+            {
+                printf("ERROR: read Response: ret=%d \n", ret);
+                return (-1);
+            }
+            recv_head = 0;
+            recv_tail = ret;
+            ret = FRAME_INCOMPLETE;
+            continue;
         }
+        ret = frame_parse_byte(&recv_parser, recv_buffer[recv_head++]);
     }
-    if (parity != res_parity)
+#if defined(CAPTURE)
+    capture_frame(CAPTURE_TO_MASTER, 0, recv_parser.frame, recv_parser.length);
+#endif
+
+    // check the frame and decode the message
+    if (ret == FRAME_WRONG ||
+        decode_res_msg(recv_parser.message, recv_parser.size, &last_res_msg) < 0)
     {
-        printf("ERROR: received wrong parity\n");
+        printf("ERROR: received wrong frame\n");
         last_res_msg.cmd = NO_CMD;
-        last_res_msg.status = 2;
+        last_res_msg.status = STATUS_NACK;
     }
+    return (0);
 }
 
 // --------------------------------------
@@ -234,11 +341,12 @@ void send_cmd_msg(enum command cmd)
     // set the command to send
     next_cmd_msg.cmd = cmd;
 
-    // if command is to set the heater
-    if (cmd == SET_HEAT_CMD)
+    // if command is to set the heater (alone or in a batch)
+    if (cmd == SET_HEAT_CMD || cmd == BATCH_CMD)
     {
-        // set the heater
-        next_cmd_msg.set_heater = heater_on;
+        // set the heater of the slave of the window
+        heater_sent = __atomic_load_n(&heater_request[link_node], __ATOMIC_RELAXED);
+        next_cmd_msg.set_heater = heater_sent;
     }
 }
 
@@ -249,33 +357,118 @@ void recv_res_msg()
 {
     // read the last received commmand
     enum command cmd = last_res_msg.cmd;
+    // the state of the slave that answers, none for an unknown one
+    int node = poll_scheduler_find(&poller, last_res_msg.addr);
+
+    if (node < 0)
+    {
+        last_res_msg.cmd = NO_CMD;
+        return;
+    }
 
     // update the state of the subsystems
-    if (cmd == SET_HEAT_CMD && last_res_msg.status == 0)
+    if (cmd == SET_HEAT_CMD && last_res_msg.status == STATUS_DONE)
     {
         // update the state of the heater
-        heater_on = last_res_msg.status;
+        state[node].heater_on = heater_sent;
     }
     else if (cmd == READ_SUN_CMD)
     {
         // update the state of the sunlight
-        sunlight_on = last_res_msg.sunlight_on;
+        state[node].sunlight_on = last_res_msg.data.sunlight_on;
     }
     else if (cmd == READ_TEMP_CMD)
     {
         // update the state of the temperature
-        temperature = last_res_msg.temperature;
+        state[node].temperature = last_res_msg.data.temperature;
     }
     else if (cmd == READ_POS_CMD)
     {
         // update the state of the position
-        position = last_res_msg.position;
+        state[node].position = last_res_msg.data.position;
+    }
+    else if (cmd == HELLO_CMD)
+    {
+        // capabilities agreed by the slave
+        link_hello = last_res_msg.data.hello;
+    }
+    else if (cmd == SUBSCRIBE_CMD)
+    {
+        // the readings are pushed from now on
+        __atomic_store_n(&subscribed, (last_res_msg.status == STATUS_DONE), __ATOMIC_RELAXED);
+        push_time = clock_now_ns();
+    }
+    else if (cmd == BATCH_CMD || cmd == TELEMETRY_CMD)
+    {
+        // update the state of every part executed or pushed
+        const struct batch_data *batch = &last_res_msg.data.batch;
+
+        if (cmd == TELEMETRY_CMD)
+        {
+            push_time = clock_now_ns();
+        }
+
+        // the answer carries the heater the slave has
+        if ((batch->batch & BATCH_SET_HEAT) && last_res_msg.status == STATUS_DONE)
+        {
+            state[node].heater_on = batch->heater_on;
+        }
+        if (batch->batch & BATCH_READ_SUN)
+        {
+            state[node].sunlight_on = batch->sunlight_on;
+        }
+        if (batch->batch & BATCH_READ_TEMP)
+        {
+            state[node].temperature = batch->temperature;
+        }
+        if (batch->batch & BATCH_READ_POS)
+        {
+            state[node].position = batch->position;
+        }
+    }
+
+    // the tasks see the new state whole
+    if (cmd == SET_HEAT_CMD || cmd == READ_SUN_CMD || cmd == READ_TEMP_CMD || cmd == READ_POS_CMD ||
+        cmd == BATCH_CMD || cmd == TELEMETRY_CMD)
+    {
+        seqlock_publish(&state_lock[node], &state[node]);
     }
 
     // set the last response to no command to clean it up
     last_res_msg.cmd = NO_CMD;
 }
 
+// --------------------------------------
+// Function: recv_answer
+// --------------------------------------
+// reads frames up to the next answer, the readings pushed on the way are
+// applied as they come
+int recv_answer(int64_t deadline)
+{
+    while (recv_msg(deadline) == 0)
+    {
+        if (last_res_msg.cmd != TELEMETRY_CMD)
+        {
+            return (0);
+        }
+        recv_res_msg();
+    }
+    return (-1);
+}
+
+// --------------------------------------
+// Function: recv_pending
+// --------------------------------------
+// applies the readings pushed up to the given time, the answers that came
+// too late for their request are dropped
+void recv_pending(int64_t until)
+{
+    while (recv_answer(until) == 0)
+    {
+        last_res_msg.cmd = NO_CMD;
+    }
+}
+
 //---------------------------------------------------------------------------
 //                           MAIN FUNCTIONS
 //---------------------------------------------------------------------------
@@ -283,30 +476,204 @@ void recv_res_msg()
 // --------------------------------------
 // Function: control_temperature
 // --------------------------------------
-void control_temperature()
+void control_temperature(int node, const struct spacecraft_state *state)
 {
     // check if temperature is lower or higher
-    if (temperature < AVG_TEMPERATURE)
+    if (state->temperature < AVG_TEMPERATURE)
     {
         // set heater
-        heater_on = 1;
+        __atomic_store_n(&heater_request[node], 1, __ATOMIC_RELAXED);
     }
-    else if (temperature >= AVG_TEMPERATURE)
+    else if (state->temperature >= AVG_TEMPERATURE)
     {
         // unset heater
-        heater_on = 0;
+        __atomic_store_n(&heater_request[node], 0, __ATOMIC_RELAXED);
     }
 }
 
+// --------------------------------------
+// Function: format_position
+// --------------------------------------
+void format_position(FILE *file, const struct binlog_record *record)
+{
+    fprintf(file, "Position: (%.2f, %.2f, %.2f)\n", record->args[0], record->args[1], record->args[2]);
+}
+
+// --------------------------------------
+// Function: format_state
+// --------------------------------------
+void format_state(FILE *file, const struct binlog_record *record)
+{
+    if (NODES > 1)
+    {
+        fprintf(file, "Slave: 0x%02X\n", (unsigned int)record->args[3]);
+    }
+    fprintf(file, "Temperature: %.2f\n", record->args[0]);
+    fprintf(file, "Sunlight: %s\n", (record->args[1] != 0.0 ? "ON" : "OFF"));
+    fprintf(file, "Heater: %s\n", (record->args[2] != 0.0 ? "ON" : "OFF"));
+}
+
+// by enum log_format
+const binlog_formatter log_formatters[] = {
+    [LOG_POSITION] = format_position,
+    [LOG_STATE] = format_state};
+
 // --------------------------------------
 // Function: print_state
 // --------------------------------------
-void print_state()
+// the values only, the console is written by drain_thread
+void print_state(struct binlog_ring *log, int node, const struct spacecraft_state *state)
+{
+    int64_t now = clock_now_ns();
+
+    binlog_write(log, now, LOG_POSITION, state->position.x, state->position.y, state->position.z, 0.0);
+    binlog_write(log, now, LOG_STATE, state->temperature, state->sunlight_on, state->heater_on, node_addrs[node]);
+}
+
+// --------------------------------------
+// Function: execute_window
+// --------------------------------------
+void execute_window(const enum command *cmds, int count)
+{
+#ifdef ARDUINO
+    struct cmd_msg window[SEND_WINDOW];
+    int answered[SEND_WINDOW];
+    int sends[SEND_WINDOW];
+    int64_t sent_time[SEND_WINDOW];
+    int pending = count;
+    int node = poll_scheduler_next(&poller, clock_now_ns());
+
+    // the whole window goes to one slave, its heater is the one sent
+    if (node < 0)
+    {
+        printf("ERROR: no slave takes %d commands\n", count);
+        return;
+    }
+    link_node = node;
+
+    // prepare request buffers
+    for (int i = 0; i < count; i++)
+    {
+        send_cmd_msg(cmds[i]);
+        next_cmd_msg.addr = poller.nodes[node].addr;
+        next_cmd_msg.seq = next_seq++;
+        window[i] = next_cmd_msg;
+        answered[i] = 0;
+        sends[i] = 0;
+    }
+
+    // a request or an answer received wrong costs one more round trip,
+    // every command can be sent again safely to the same slave
+    for (int attempt = 0; attempt <= MAX_RETRANSMITS && pending > 0; attempt++)
+    {
+        int64_t deadline;
+        int sent = 0;
+
+        recv_pending(clock_now_ns());
+
+        // send the requests still without answer one after the other
+        for (int i = 0; i < count; i++)
+        {
+            if (answered[i])
+            {
+                continue;
+            }
+            if (attempt > 0)
+            {
+                printf("WARNING: retransmit %d of command %d\n", attempt, window[i].cmd);
+            }
+            next_cmd_msg = window[i];
+            if (send_msg() == 0)
+            {
+                poll_scheduler_sent(&poller, node);
+                sent_time[i] = clock_now_ns();
+                sends[i]++;
+                sent++;
+            }
+        }
+
+        // the answers (or NACKs) come back in order, one per request, and
+        // are read as soon as they arrive; a late answer of an earlier
+        // request does not count
+        deadline = clock_now_ns() + link_rto.rto;
+        while (sent > 0)
+        {
+            if (recv_answer(deadline) < 0)
+            {
+                printf("ERROR: no Response of slave 0x%02X in %lld ms\n", poller.nodes[node].addr,
+                       (long long)(link_rto.rto / NS_PER_MS));
+                rto_backoff(&link_rto);
+                break;
+            }
+            // the slave is there but got a request wrong: it goes again
+            // on the next attempt, without a rest of the slave
+            if (last_res_msg.status == STATUS_NACK)
+            {
+                poll_scheduler_answered(&poller, node);
+                sent--;
+                continue;
+            }
+            for (int i = 0; i < count; i++)
+            {
+                if (!answered[i] && window[i].seq == last_res_msg.seq && window[i].addr == last_res_msg.addr)
+                {
+                    // parse response
+                    poll_scheduler_answered(&poller, node);
+                    answered[i] = 1;
+                    pending--;
+                    sent--;
+                    if (sends[i] == 1)
+                    {
+                        rto_sample(&link_rto, clock_now_ns() - sent_time[i]);
+                    }
+                    recv_res_msg();
+                    break;
+                }
+            }
+        }
+        if (poller.nodes[node].outstanding > 0)
+        {
+            poll_scheduler_failed(&poller, node, clock_now_ns());
+        }
+    }
+
+    // the data is missing until the next period
+    if (pending > 0)
+    {
+        printf("ERROR: no answer to %d commands\n", pending);
+    }
+    last_res_msg.cmd = NO_CMD;
+#else
+    // prepare request buffers
+    for (int i = 0; i < count; i++)
+    {
+        send_cmd_msg(cmds[i]);
+    }
+
+    // wait until answers are ready
+    clock_sleep(400 * NS_PER_MS);
+
+    // parse response
+    recv_res_msg();
+#endif
+}
+
+// --------------------------------------
+// Function: execute_cmds
+// --------------------------------------
+// sends up to SEND_WINDOW requests before reading their answers, which
+// are matched by sequence number
+void execute_cmds(const enum command *cmds, int count)
 {
-    printf("Position: (%.2f, %.2f, %.2f)\n", position.x, position.y, position.z);
-    printf("Temperature: %.2f\n", temperature);
-    printf("Sunlight: %s\n", (sunlight_on ? "ON" : "OFF"));
-    printf("Heater: %s\n", (heater_on ? "ON" : "OFF"));
+    // a slave without the queue answers a single request per loop
+    int window = (link_features & FEATURE_WINDOW) ? SEND_WINDOW : 1;
+
+    for (int first = 0; first < count; first += window)
+    {
+        int size = count - first;
+
+        execute_window(cmds + first, (size < window) ? size : window);
+    }
 }
 
 // --------------------------------------
@@ -314,88 +681,562 @@ void print_state()
 // --------------------------------------
 void execute_cmd(enum command cmd)
 {
-    // prepare request buffer
-    send_cmd_msg(cmd);
+    execute_cmds(&cmd, 1);
+}
+
+// --------------------------------------
+// Function: execute_batch
+// --------------------------------------
+// executes all the commands in a single BATCH_CMD, one round trip (a
+// single command goes as it is, its answer is shorter)
+void execute_batch(const enum command *cmds, int count)
+{
+    if (count <= 1)
+    {
+        execute_cmds(cmds, count);
+        return;
+    }
+
+    // the bit of each command is 1 << (command - 1)
+    next_cmd_msg.batch = 0;
+    for (int i = 0; i < count; i++)
+    {
+        next_cmd_msg.batch |= (unsigned char)(1 << (cmds[i] - 1));
+    }
+    execute_cmd(BATCH_CMD);
+}
 
 #ifdef ARDUINO
-    // send message to slave
-    send_msg();
+// --------------------------------------
+// Function: set_link_speed
+// --------------------------------------
+void set_link_speed(speed_t speed)
+{
+    struct termios portSettings;
+
+    // the requests still in the buffer go out at the old rate
+    tcgetattr(file_desc, &portSettings);
+    cfsetispeed(&portSettings, speed);
+    cfsetospeed(&portSettings, speed);
+    tcsetattr(file_desc, TCSADRAIN, &portSettings);
+    recv_parser.count = 0;
+}
+
+// --------------------------------------
+// Function: send_hello
+// --------------------------------------
+// returns 0 if the slave answered the HELLO_CMD, -1 otherwise
+int send_hello(uint32_t rate)
+{
+    next_cmd_msg.data.hello.version = PROTOCOL_VERSION;
+    next_cmd_msg.data.hello.features = MASTER_FEATURES;
+    next_cmd_msg.data.hello.baud = rate;
+    memset(&link_hello, 0, sizeof(struct hello));
+    execute_cmd(HELLO_CMD);
+
+    return (link_hello.version == PROTOCOL_VERSION) ? 0 : -1;
+}
+
+// --------------------------------------
+// Function: negotiate_link
+// --------------------------------------
+// agrees with the slave on the features and on the fastest rate that
+// works: each rate is taken by both ends and checked with another HELLO,
+// on errors both go back to 9600 and try the next one
+void negotiate_link()
+{
+    link_features = 0;
+    for (int i = 0; i < MASTER_RATES_SIZE; i++)
+    {
+        // a slave without the handshake stays at 9600
+        if (send_hello(master_rates[i]) < 0)
+        {
+            printf("WARNING: no HELLO from the slave, 9600 baud\n");
+            return;
+        }
+        link_features = link_hello.features;
+
+        // the slave may agree on a slower rate
+        while (i < MASTER_RATES_SIZE && master_rates[i] > link_hello.baud)
+        {
+            i++;
+        }
+        if (i == MASTER_RATES_SIZE || master_rates[i] != link_hello.baud)
+        {
+            return;
+        }
+
+        // both ends take the new rate, a good answer confirms it
+        set_link_speed(master_speeds[i]);
+        clock_sleep(HELLO_SWITCH_WAIT);
+        if (send_hello(master_rates[i]) == 0 && link_hello.baud == master_rates[i])
+        {
+            printf("Link at %lu baud, features 0x%02X\n", (unsigned long)master_rates[i], link_features);
+            return;
+        }
+        printf("WARNING: errors at %lu baud, back to 9600\n", (unsigned long)master_rates[i]);
+        set_link_speed(B9600);
+        clock_sleep(HELLO_FALLBACK_WAIT);
+    }
+}
+
+// --------------------------------------
+// Function: subscribe
+// --------------------------------------
+// asks the slave to push the readings of the tasks A, C, E and F, which
+// are not polled while the pushes keep coming
+void subscribe()
+{
+    next_cmd_msg.data.subscription.parts = BATCH_READ_SUN | BATCH_READ_TEMP | BATCH_READ_POS;
+    next_cmd_msg.data.subscription.period = PUSH_PERIOD;
+    next_cmd_msg.data.subscription.delta = PUSH_DELTA;
+    __atomic_store_n(&subscribed, 0, __ATOMIC_RELAXED);
+    execute_cmd(SUBSCRIBE_CMD);
+}
 #endif
 
-    // wait until answer is ready
-    delayClock(0.400);
+// --------------------------------------
+// Function: pushed_cmd
+// --------------------------------------
+// boolean to state if the reading of a command is pushed by the slave,
+// and so not requested
+int pushed_cmd(enum command cmd)
+{
+    return (__atomic_load_n(&subscribed, __ATOMIC_RELAXED) && cmd != SET_HEAT_CMD);
+}
 
+// --------------------------------------
+// Function: link_update
+// --------------------------------------
+// subscribes again if the pushes stopped (the slave was reset) and applies
+// the readings pushed so far
+void link_update()
+{
 #ifdef ARDUINO
-    // receive the answer from the slave
-    recv_msg();
+    if ((link_features & FEATURE_PUSH) &&
+        (!subscribed || clock_now_ns() - push_time > PUSH_TIMEOUT))
+    {
+        subscribe();
+    }
+    recv_pending(clock_now_ns());
 #endif
+}
 
-    // parse response
-    recv_res_msg();
+// --------------------------------------
+// Function: link_wait
+// --------------------------------------
+// the owner of the link waits for a push up to the time given (ns), on
+// the monotonic clock: a step of the wall clock neither stalls it nor
+// makes it spin
+void link_wait(int64_t until)
+{
+    struct timespec wake;
+
+    wake.tv_sec = until / NS_PER_S;
+    wake.tv_nsec = until % NS_PER_S;
+    pthread_mutex_lock(&link_mutex);
+    while (!link_posted && pthread_cond_timedwait(&link_cond, &link_mutex, &wake) == 0)
+    {
+    }
+    link_posted = 0;
+    pthread_mutex_unlock(&link_mutex);
+}
+
+// --------------------------------------
+// Function: link_execute
+// --------------------------------------
+// sends the command of a task through the owner of the link and returns
+// once it is answered, in order of the deadline of the release (ns)
+void link_execute(int task, enum command cmd, int64_t deadline)
+{
+    struct link_request *request = &task_request[task];
+
+    request->task = task;
+    request->cmd = cmd;
+    request->deadline = deadline;
+    request->done = 0;
+    request_queue_push(&link_queue, request);
+    pthread_mutex_lock(&link_mutex);
+    link_posted = 1;
+    pthread_cond_signal(&link_cond);
+    pthread_mutex_unlock(&link_mutex);
+    while (!request_done(request))
+    {
+        sem_wait(&task_done[task]);
+    }
+}
+
+// --------------------------------------
+// Function: control_task
+// --------------------------------------
+// task B decides the heater from the last temperature read, on a copy of
+// the state taken once
+void control_task()
+{
+    struct spacecraft_state snapshot;
+
+    for (int node = 0; node < NODES; node++)
+    {
+        seqlock_read(&state_lock[node], &snapshot);
+        control_temperature(node, &snapshot);
+        print_state(&task_log[TASK_B], node, &snapshot);
+    }
+}
+
+// --------------------------------------
+// Function: temperature_task
+// --------------------------------------
+// task C sets its next reading from the one just taken: below the
+// setpoint the heater is on, above it off, and the sunlight as last read
+// (with a lone slave, the slaves of a shared link are read in turns)
+void temperature_task()
+{
+    struct spacecraft_state snapshot;
+    double sunlight;
+
+    seqlock_read(&state_lock[link_node], &snapshot);
+    sunlight = snapshot.sunlight_on ? SLAVE_SUNLIGHT_POWER : 0.0;
+    adaptive_sampler_update(&temp_sampler, snapshot.temperature,
+                            (SLAVE_HEATER_POWER + sunlight - SLAVE_POWER_LOSS) / SLAVE_HEAT_CAPACITY,
+                            (SLAVE_POWER_LOSS - sunlight) / SLAVE_HEAT_CAPACITY, task_release_time[TASK_C]);
+}
+
+// tasks by priority, as numbered in schedule.h
+const struct periodic_task tasks[TASKS] = {
+    [TASK_A] = {"A", TASK_A_PERIOD, READ_SUN_CMD, NULL, NULL},
+    [TASK_B] = {"B", TASK_B_PERIOD, NO_CMD, control_task, NULL},
+    [TASK_C] = {"C", TASK_C_PERIOD, READ_TEMP_CMD, (NODES == 1) ? temperature_task : NULL,
+                (NODES == 1) ? &temp_sampler : NULL},
+    [TASK_D] = {"D", TASK_D_PERIOD, SET_HEAT_CMD, NULL, NULL},
+    [TASK_E] = {"E", TASK_E_PERIOD, READ_SUN_CMD, NULL, NULL},
+    [TASK_F] = {"F", TASK_F_PERIOD, READ_POS_CMD, NULL, NULL}};
+
+// --------------------------------------
+// Function: prefault_stack
+// --------------------------------------
+// touches the stack of the thread so its pages are in memory before the
+// first release
+void prefault_stack()
+{
+    volatile unsigned char stack[TASK_STACK_PREFAULT];
+
+    for (int i = 0; i < TASK_STACK_PREFAULT; i += 64)
+    {
+        stack[i] = 0;
+    }
+    (void)stack[0];
 }
 
 //-------------------------------------
-//-  Function: controller
+//-  Function: note_overrun
 //-------------------------------------
-void *controller(void *arg)
+// a task ran late: to degrade, one more of the lowest priority tasks is
+// shed (with task_mutex)
+void note_overrun(int64_t time)
 {
-    unsigned long current_time = 0;
+    last_overrun = time;
+    if (OVERRUN_POLICY == OVERRUN_DEGRADE && shed_tasks < OVERRUN_SHED_MAX)
+    {
+        shed_tasks++;
+    }
+}
+
+//-------------------------------------
+//-  Function: task_thread
+//-------------------------------------
+void *task_thread(void *arg)
+{
+    int task = (int)(intptr_t)arg;
+
+    prefault_stack();
 
     while (1)
     {
-        unsigned long start_time = getClock(); // Get current time in milliseconds
+        // released by the dispatcher
+        while (sem_wait(&task_release[task]) < 0)
+        {
+        }
+        int64_t release = task_release_time[task];
+        int64_t cpu_start = clock_thread_cpu_ns();
+        histogram_record(&task_jitter[task], clock_now_ns() - release);
 
-        // Check which tasks are ready to execute based on their periods
-        if (current_time % TASK_A_PERIOD == 0)
+        // a release its sampler skips does nothing; a reading pushed costs
+        // no request, so the sampler only works while it is polled
+        if (tasks[task].sampler == NULL || pushed_cmd(tasks[task].cmd) ||
+            adaptive_sampler_due(tasks[task].sampler, release))
         {
-            execute_cmd(READ_SUN_CMD);
+            if (tasks[task].cmd != NO_CMD)
+            {
+                link_execute(task, tasks[task].cmd, release + tasks[task].period * NS_PER_MS);
+            }
+            if (tasks[task].body != NULL)
+            {
+                tasks[task].body();
+            }
         }
-        if (current_time % TASK_B_PERIOD == 0)
+        int64_t end = clock_now_ns();
+        histogram_record(&task_cpu[task], clock_thread_cpu_ns() - cpu_start);
+        histogram_record(&task_response[task], end - release);
+
+        // to catch up the releases lost meanwhile run at once, one after other
+        pthread_mutex_lock(&task_mutex);
+        if (end > release + tasks[task].period * NS_PER_MS)
         {
-            control_temperature();
+            task_overruns[task]++;
+            note_overrun(end);
         }
-        if (current_time % TASK_C_PERIOD == 0)
+        if (task_late[task] > 0)
         {
-            execute_cmd(READ_TEMP_CMD);
-            usleep(TASK_C_EXECUTION_TIME);
+            task_late[task]--;
+            task_release_time[task] = task_late_release[task];
+            task_late_release[task] += tasks[task].period * NS_PER_MS;
+            sem_post(&task_release[task]);
         }
-        if (current_time % TASK_D_PERIOD == 0)
+        else
         {
-            execute_cmd(SET_HEAT_CMD);
-            usleep(TASK_D_EXECUTION_TIME);
+            task_active[task] = 0;
         }
-        if (current_time % TASK_E_PERIOD == 0)
+        pthread_mutex_unlock(&task_mutex);
+    }
+}
+
+//-------------------------------------
+//-  Function: link_owner
+//-------------------------------------
+// the only thread on the link: sends the requests with the earliest
+// deadlines, all of them in a single batch or a window of them, so a
+// request released meanwhile goes before the routine ones still waiting;
+// with none it applies the readings pushed
+void *link_owner(void *arg)
+{
+    struct link_request *served[REQUEST_QUEUE_SIZE];
+    enum command cmds[REQUEST_QUEUE_SIZE];
+
+    (void)arg;
+
+    prefault_stack();
+
+    while (1)
+    {
+        int count = 0;
+        int waiting;
+        int batch = (link_features & FEATURE_BATCH);
+        int window = (link_features & FEATURE_WINDOW) ? SEND_WINDOW : 1;
+
+        if (request_queue_collect(&link_queue) == 0)
+        {
+            link_wait(clock_now_ns() + LINK_IDLE_WAIT);
+        }
+
+        if (request_queue_collect(&link_queue) == 0)
+        {
+#ifdef ARDUINO
+            recv_pending(clock_now_ns());
+#endif
+            continue;
+        }
+
+        // the readings pushed are not requested
+        int64_t start = clock_now_ns();
+        link_update();
+        for (waiting = 0; link_queue.count > 0 && (batch || waiting < window); waiting++)
         {
-            execute_cmd(READ_SUN_CMD);
-            usleep(TASK_E_EXECUTION_TIME);
+            served[waiting] = request_queue_pop(&link_queue);
+            if (!pushed_cmd(served[waiting]->cmd))
+            {
+                cmds[count++] = served[waiting]->cmd;
+            }
         }
-        if (current_time % TASK_F_PERIOD == 0)
+        if (batch)
+        {
+            execute_batch(cmds, count);
+        }
+        else
+        {
+            execute_cmds(cmds, count);
+        }
+
+        // the owner is the only writer of these histograms
+        for (int i = 0; i < waiting; i++)
+        {
+            histogram_record(&task_round_trip[served[i]->task], clock_now_ns() - start);
+            request_complete(served[i]);
+            sem_post(&task_done[served[i]->task]);
+        }
+    }
+}
+
+//-------------------------------------
+//-  Function: dispatcher
+//-------------------------------------
+// releases the tasks of every minor frame on absolute times, as the table
+// of schedule.h says; a task still in its last release misses the new one,
+// which is lost or kept as OVERRUN_POLICY says
+void *dispatcher(void *arg)
+{
+    int64_t frame_time = task_start;
+    int frame = 0;
+
+    (void)arg;
+
+    prefault_stack();
+
+    while (1)
+    {
+        clock_sleep_until(frame_time);
+
+        pthread_mutex_lock(&task_mutex);
+
+        // the tasks shed come back one by one while there are no overruns
+        if (shed_tasks > 0 && frame_time - last_overrun >= SCHEDULE_HYPERPERIOD * NS_PER_MS)
+        {
+            shed_tasks--;
+            last_overrun = frame_time;
+        }
+        for (int i = 0; i < TASKS; i++)
+        {
+            if (!(schedule_releases[frame] & (1 << i)))
+            {
+                continue;
+            }
+            if (i >= TASKS - shed_tasks)
+            {
+                task_shed[i]++;
+                continue;
+            }
+            if (task_active[i])
+            {
+                task_misses[i]++;
+                note_overrun(frame_time);
+                if (OVERRUN_POLICY == OVERRUN_CATCH_UP && task_late[i] < OVERRUN_CATCH_UP_MAX)
+                {
+                    task_late_release[i] = (task_late[i] == 0) ? frame_time : task_late_release[i];
+                    task_late[i]++;
+                }
+                continue;
+            }
+            task_active[i] = 1;
+            task_release_time[i] = frame_time;
+            sem_post(&task_release[i]);
+        }
+        pthread_mutex_unlock(&task_mutex);
+
+        // the time of the frames does not drift with the work of the tasks
+        frame_time += SCHEDULE_MINOR_FRAME * NS_PER_MS;
+        frame = (frame + 1 == SCHEDULE_FRAMES) ? 0 : frame + 1;
+    }
+}
+
+//-------------------------------------
+//-  Function: drain_thread
+//-------------------------------------
+// prints the logs of the tasks in batches, below every task
+void *drain_thread(void *arg)
+{
+    uint32_t dropped[TASKS] = {0};
+
+    (void)arg;
+
+    while (1)
+    {
+        clock_sleep(LOG_DRAIN_PERIOD);
+        for (int i = 0; i < TASKS; i++)
         {
-            execute_cmd(READ_POS_CMD);
-            usleep(TASK_F_EXECUTION_TIME);
+            uint32_t lost = __atomic_load_n(&task_log[i].dropped, __ATOMIC_RELAXED);
+
+            binlog_drain(&task_log[i], log_formatters, stdout);
+            if (lost != dropped[i])
+            {
+                printf("WARNING: task %s dropped %u log records\n", tasks[i].name, (unsigned)(lost - dropped[i]));
+                dropped[i] = lost;
+            }
         }
+        fflush(stdout);
+    }
+}
+
+// --------------------------------------
+// Function: print_latency
+// --------------------------------------
+// one latency of a task, named after it
+void print_latency(int task, const char *latency, const struct histogram *histogram)
+{
+    char name[32];
 
-        print_state();
+    snprintf(name, sizeof(name), "Task %s %s", tasks[task].name, latency);
+    histogram_print(stdout, name, histogram);
+}
 
-        // Calculate time taken by tasks and sleep to maintain the period
-        unsigned long end_time = getClock();
-        unsigned long execution_time = end_time - start_time;
-        if (execution_time < TASK_A_PERIOD)
+//-------------------------------------
+//-  Function: stats_thread
+//-------------------------------------
+// dumps the overrun counters and the latencies of the tasks every time
+// Enter is pressed on the console, at the lowest priority and while the
+// tasks go on
+void *stats_thread(void *arg)
+{
+    (void)arg;
+
+    while (1)
+    {
+        int car = getchar();
+
+        if (car == EOF)
         {
-            usleep(TASK_A_PERIOD - execution_time);
+            clock_sleep(NS_PER_S);
+            continue;
         }
+        if (car != '\n')
+        {
+            continue;
+        }
+        for (int i = 0; i < TASKS; i++)
+        {
+            pthread_mutex_lock(&task_mutex);
+            unsigned long misses = task_misses[i];
+            unsigned long overruns = task_overruns[i];
+            unsigned long shed = task_shed[i];
+            pthread_mutex_unlock(&task_mutex);
 
-        // Update current_time
-        current_time += TASK_A_PERIOD;
+            printf("Task %s misses %lu  overruns %lu  shed %lu\n", tasks[i].name, misses, overruns, shed);
+            print_latency(i, "jitter", &task_jitter[i]);
+            print_latency(i, "response", &task_response[i]);
+            print_latency(i, "round trip", &task_round_trip[i]);
+            print_latency(i, "cpu", &task_cpu[i]);
+        }
     }
 }
 
+// --------------------------------------
+// Function: start_thread
+// --------------------------------------
+// creates a thread of fixed priority with its own stack
+void start_thread(pthread_t *thread, void *(*start)(void *), int arg, int priority)
+{
+    pthread_attr_t attr;
+    struct sched_param param;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = priority;
+    pthread_attr_setschedparam(&attr, &param);
+    pthread_attr_setstacksize(&attr, TASK_STACK_SIZE);
+    if (pthread_create(thread, &attr, start, (void *)(intptr_t)arg) != 0)
+    {
+        printf("pthread_create: error creating thread %d\n", arg);
+        exit(-1);
+    }
+    pthread_attr_destroy(&attr);
+}
+
 //-------------------------------------
 //-  Function: Init
 //-------------------------------------
 rtems_task Init(rtems_task_argument ignored)
 {
-    pthread_t thread_ctrl;
+    pthread_t threads[TASKS + 4];
+    pthread_condattr_t link_cond_attr;
     sigset_t alarm_sig;
     int i;
 
@@ -410,6 +1251,17 @@ rtems_task Init(rtems_task_argument ignored)
     }
     sigprocmask(SIG_BLOCK, &alarm_sig, NULL);
 
+    // keep every page in memory, a page fault would delay the tasks
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+    {
+        printf("WARNING: memory not locked\n");
+    }
+
+    // the slaves on the link and the wait for their answers, before the
+    // first request
+    poll_scheduler_init(&poller, node_addrs, NODES, SEND_WINDOW);
+    rto_init(&link_rto);
+
 #if defined(ARDUINO)
     /* Open serial port */
     char serial_dev[] = "/dev/com1";
@@ -428,12 +1280,50 @@ rtems_task Init(rtems_task_argument ignored)
     cfsetispeed(&portSettings, speed);
     cfsetospeed(&portSettings, speed);
     cfmakeraw(&portSettings);
+    // read returns the bytes already received, select waits for them
+    portSettings.c_cc[VMIN] = 0;
+    portSettings.c_cc[VTIME] = 0;
     tcsetattr(file_desc, TCSANOW, &portSettings);
+
+    // agree on a faster rate and on the features with a lone slave; the
+    // slaves of a shared link stay at 9600 and speak only when addressed
+    if (NODES == 1)
+    {
+        negotiate_link();
+    }
+    else
+    {
+        link_features = MASTER_FEATURES & ~FEATURE_PUSH;
+    }
 #endif
 
-    /* Create first thread */
-    pthread_create(&thread_ctrl, NULL, controller, NULL);
-    pthread_join(thread_ctrl, NULL);
+#if defined(CAPTURE)
+    capture_start(CAPTURE_PATH);
+#endif
+
+    // one thread per task, with a fixed priority by rate, below the owner
+    // of the link that serves them and the dispatcher that releases them
+    pthread_mutex_init(&task_mutex, NULL);
+    pthread_mutex_init(&link_mutex, NULL);
+    pthread_condattr_init(&link_cond_attr);
+    pthread_condattr_setclock(&link_cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&link_cond, &link_cond_attr);
+    adaptive_sampler_init(&temp_sampler, AVG_TEMPERATURE, TASK_C_PERIOD * NS_PER_MS, TEMP_MAX_PERIOD);
+    task_start = clock_now_ns() + TASK_START_DELAY;
+    for (i = 0; i < TASKS; i++)
+    {
+        sem_init(&task_release[i], 0, 0);
+        sem_init(&task_done[i], 0, 0);
+        start_thread(&threads[i], task_thread, i, sched_get_priority_max(SCHED_FIFO) - 2 - i);
+    }
+    start_thread(&threads[TASKS], dispatcher, TASKS, sched_get_priority_max(SCHED_FIFO));
+    start_thread(&threads[TASKS + 1], link_owner, TASKS + 1, sched_get_priority_max(SCHED_FIFO) - 1);
+    start_thread(&threads[TASKS + 2], drain_thread, TASKS + 2, sched_get_priority_min(SCHED_FIFO) + 1);
+    start_thread(&threads[TASKS + 3], stats_thread, TASKS + 3, sched_get_priority_min(SCHED_FIFO));
+    for (i = 0; i < TASKS + 4; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
     exit(0);
 }
 
@@ -447,6 +1337,10 @@ rtems_task Init(rtems_task_argument ignored)
 #define CONFIGURE_MAXIMUM_DIRVER 10
 #define CONFIGURE_MAXIMUM_POSIX_THREADS 10
 #define CONFIGURE_MAXIMUM_POSIX_TIMERS 10
+#define CONFIGURE_MAXIMUM_POSIX_MUTEXES 10
+#define CONFIGURE_MAXIMUM_POSIX_CONDITION_VARIABLES 10
+#define CONFIGURE_MAXIMUM_POSIX_SEMAPHORES 20
+#define CONFIGURE_EXTRA_TASK_STACKS ((TASKS + 4) * TASK_STACK_SIZE)
 
 #define CONFIGURE_INIT
 #include <rtems/confdefs.h>